@@ -398,6 +398,11 @@ struct AuxStatus {
   uint8_t analog_bit_active = 0;
   std::array<float, 5> analog_inputs = { {} };
 
+  // Free running sums of the raw 12 bit samples of each analog input,
+  // one per control cycle, so that readers can average over any
+  // interval.  These wrap.
+  std::array<uint32_t, 5> analog_sums = { {} };
+
   template <typename Archive>
   void Serialize(Archive* a) {
     a->Visit(MJ_NVP(i2c));
@@ -219,6 +219,7 @@ class AuxPort {
       if (analog_input_active_[i]) {
         status_.analog_inputs[i] =
             static_cast<float>(adc_info_.value[i]) / 4096.0f;
+        status_.analog_sums[i] += adc_info_.value[i];
       }
     }
 
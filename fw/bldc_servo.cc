@@ -29,6 +29,7 @@
 #include "fw/foc.h"
 #include "fw/math.h"
 #include "fw/moteus_hw.h"
+#include "fw/seqlock.h"
 #include "fw/stm32g4_adc.h"
 #include "fw/torque_model.h"
 
@@ -373,10 +374,19 @@ class BldcServo::Impl {
     if (std::isnan(next->accel_limit)) {
       next->accel_limit = config_.default_accel_limit;
     }
+    if (std::isnan(next->jerk_limit)) {
+      next->jerk_limit = config_.default_jerk_limit;
+    }
+    if (next->arrival_time_us) {
+      // Arrival timed moves choose a new velocity limit every cycle,
+      // which a jerk limited plan cannot follow.
+      next->jerk_limit = std::numeric_limits<float>::quiet_NaN();
+    }
     // If we are going to limit at all, ensure that we have a velocity
     // limit, and that is is no more than the configured maximum
     // velocity.
-    if (!std::isnan(next->velocity_limit) || !std::isnan(next->accel_limit)) {
+    if (!std::isnan(next->velocity_limit) || !std::isnan(next->accel_limit) ||
+        next->arrival_time_us) {
       if (std::isnan(next->velocity_limit)) {
         next->velocity_limit = config_.max_velocity;
       } else {
@@ -424,6 +434,14 @@ class BldcServo::Impl {
            1.0f : -1.0f);
     }
 
+    // Any jerk limited trajectory is planned anew from the current
+    // state on the next control cycle, unless this command repeats
+    // the one being followed.  If the ISR finishes or abandons that
+    // plan in the meantime, it notices and plans again itself.
+    next->jerk_trajectory_planned =
+        status_.mode == kPosition &&
+        BldcServoPosition::ContinuesJerkPlan(*next, *current_data_);
+
     telemetry_data_ = *next;
 
     if (!!next->stop_position_relative_raw &&
@@ -441,6 +459,49 @@ class BldcServo::Impl {
   }
 
   const Status& status() const { return status_; }
+  uint32_t isr_cycles() const { return isr_cycles_; }
+
+  uint32_t ReadMaxIsrCycles() {
+    // An ISR which completes between these two statements may be
+    // missed, which only ever under-reports by a single sample.
+    const uint32_t result = max_isr_cycles_;
+    max_isr_cycles_ = 0;
+    return result;
+  }
+
+  uint32_t ReadMaxJerkPlanCycles() {
+    const uint32_t result = max_jerk_plan_cycles_;
+    max_jerk_plan_cycles_ = 0;
+    return result;
+  }
+  StatusSnapshot status_snapshot() const { return snapshot_.Read(); }
+
+  uint32_t status_sequence() const { return snapshot_.sequence(); }
+
+  void Heartbeat() {
+    heartbeat_count_ = heartbeat_count_ + 1;
+  }
+
+  void SetSharedTime(uint32_t time_us, uint32_t rx_cycles) {
+    // The ISR only looks at the values once the flag is set.
+    shared_time_set_ = false;
+    shared_time_set_us_ = time_us;
+    shared_time_set_cycles_ = rx_cycles;
+    shared_time_set_ = true;
+  }
+
+  Statistics ReadStatistics() const {
+    // The ISR only ever accumulates into statistics_active_, and
+    // cannot be pre-empted by us, so once the pointer is switched the
+    // old window is ours.
+    Statistics* const completed = statistics_active_;
+    Statistics* const next =
+        completed == &statistics_[0] ? &statistics_[1] : &statistics_[0];
+    *next = {};
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    statistics_active_ = next;
+    return *completed;
+  }
   const Config& config() const { return config_; }
   const Control& control() const { return control_; }
   const AuxPort::Status& aux1() const { return *aux1_port_->status(); }
@@ -500,6 +561,9 @@ class BldcServo::Impl {
         (static_cast<float>(config_.pwm_rate_hz) / 40000.0f);
     adjusted_pwm_comp_off_ = config_.pwm_comp_off * pwm_derate;
     adjusted_max_power_W_ = config_.max_power_W * pwm_derate;
+
+    load_observer_.UpdateConfig(rate_config_.period_s);
+    thermal_model_.UpdateConfig(kThermalPeriodMs * 0.001f);
   }
 
   void PollMillisecond() {
@@ -532,6 +596,38 @@ class BldcServo::Impl {
     if (desired_debug_uart != debug_uart_) {
       debug_uart_ = desired_debug_uart;
     }
+
+    thermal_ms_++;
+    if (thermal_ms_ >= kThermalPeriodMs) {
+      thermal_ms_ = 0;
+      UpdateThermalModel();
+    }
+  }
+
+  void UpdateThermalModel() {
+    // As with the statistics, the ISR only accumulates into
+    // thermal_active_, so the old window is complete once switched.
+    ThermalWindow* const completed = thermal_active_;
+    ThermalWindow* const next =
+        completed == &thermal_[0] ? &thermal_[1] : &thermal_[0];
+    *next = {};
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    thermal_active_ = next;
+
+    if (completed->count == 0) { return; }
+
+    ThermalModel::Inputs inputs;
+    inputs.current2_A2 = completed->current2_sum / completed->count;
+    inputs.motor_resistance_ohm = motor_.resistance_ohm;
+    inputs.fet_temp_C = status_.filt_fet_temp_C;
+    inputs.fet_derate_C = config_.derate_temperature;
+    if (config_.enable_motor_temperature) {
+      inputs.motor_temp_C = status_.filt_motor_temp_C;
+    }
+    if (std::isfinite(config_.motor_fault_temperature)) {
+      inputs.motor_derate_C = config_.motor_derate_temperature;
+    }
+    thermal_model_.Update(inputs);
   }
 
   void SetOutputPositionNearest(float position) {
@@ -856,6 +952,8 @@ class BldcServo::Impl {
       status_.velocity = 0.0f;
       status_.torque_Nm = 0.0f;
       status_.torque_error_Nm = 0.0f;
+    } else {
+      ISR_UpdateLoadObserver();
     }
 
 #ifdef MOTEUS_PERFORMANCE_MEASURE
@@ -870,6 +968,12 @@ class BldcServo::Impl {
 
     ISR_MaybeEmitDebug();
 
+    // Everything done each cycle must come before the timer is read
+    // below, so that it is included in the ISR timing.
+    ISR_PublishSnapshot();
+    ISR_UpdateStatistics();
+    ISR_UpdateThermal();
+
 #ifdef MOTEUS_PERFORMANCE_MEASURE
     status_.dwt.done = DWT->CYCCNT;
 #endif
@@ -881,11 +985,87 @@ class BldcServo::Impl {
         (pwm_counts_ + cnt);
     status_.total_timer = 2 * pwm_counts_ * rate_config_.interrupt_divisor;
 
+    // The PWM timer runs at the CPU clock with no prescaler, so this
+    // is the number of cycles since the period started, i.e. how long
+    // we pre-empted the main loop for.
+    isr_cycles_ = isr_cycles_ + status_.final_timer;
+    if (status_.final_timer > max_isr_cycles_) {
+      max_isr_cycles_ = status_.final_timer;
+    }
+
 #ifdef MOTEUS_DEBUG_OUT
     debug_out_ = 0;
 #endif
   }
 
+  void ISR_PublishSnapshot() __attribute__((always_inline)) MOTEUS_CCM_ATTRIBUTE {
+    snapshot_.Update([&](StatusSnapshot* snapshot) {
+        snapshot->cycle++;
+        snapshot->mode = status_.mode;
+        snapshot->fault = status_.fault;
+        snapshot->position = status_.position;
+        snapshot->velocity = status_.velocity;
+        snapshot->torque_Nm = status_.torque_Nm;
+        snapshot->d_A = status_.d_A;
+        snapshot->q_A = status_.q_A;
+        snapshot->bus_V = status_.bus_V;
+        snapshot->fet_temp_C = status_.fet_temp_C;
+        snapshot->motor_temp_C = status_.motor_temp_C;
+        snapshot->trajectory_done = status_.trajectory_done;
+        snapshot->control_position = status_.control_position;
+        snapshot->control_velocity = status_.control_velocity.value_or(
+            std::numeric_limits<float>::quiet_NaN());
+        snapshot->control_torque_Nm = control_.torque_Nm;
+        snapshot->torque_error_Nm = status_.torque_error_Nm;
+        snapshot->load_torque_Nm = status_.load_observer.load_Nm;
+        snapshot->pid_position_p = status_.pid_position.p;
+        snapshot->pid_position_integral = status_.pid_position.integral;
+        snapshot->pid_position_d = status_.pid_position.d;
+        snapshot->pid_position_error = status_.pid_position.error;
+        snapshot->pid_position_error_rate = status_.pid_position.error_rate;
+
+        const auto& position = motor_position_->status();
+        snapshot->homed = static_cast<uint8_t>(position.homed);
+        for (size_t i = 0; i < snapshot->encoders.size(); i++) {
+          const auto& source = position.sources[i];
+          auto& encoder = snapshot->encoders[i];
+          encoder.filtered_value = source.filtered_value;
+          encoder.velocity = source.velocity;
+          encoder.active_theta = source.active_theta;
+          encoder.active_velocity = source.active_velocity;
+        }
+
+        const auto& aux1 = *aux1_port_->status();
+        const auto& aux2 = *aux2_port_->status();
+        snapshot->aux1_pins = aux1.pins;
+        snapshot->aux2_pins = aux2.pins;
+        snapshot->aux1_analog_inputs = aux1.analog_inputs;
+        snapshot->aux2_analog_inputs = aux2.analog_inputs;
+        snapshot->aux1_analog_sums = aux1.analog_sums;
+        snapshot->aux2_analog_sums = aux2.analog_sums;
+      });
+  }
+
+  void ISR_UpdateStatistics() __attribute__((always_inline)) MOTEUS_CCM_ATTRIBUTE {
+    const auto& config = config_.statistics;
+    if (!config.any()) { return; }
+
+    Statistics* const statistics = statistics_active_;
+    statistics->count++;
+    if (config.q_current) { statistics->q_A.Add(status_.q_A); }
+    if (config.torque) { statistics->torque_Nm.Add(status_.torque_Nm); }
+    if (config.velocity) { statistics->velocity.Add(status_.velocity); }
+  }
+
+  void ISR_UpdateThermal() __attribute__((always_inline)) MOTEUS_CCM_ATTRIBUTE {
+    if (!config_.thermal_model.enabled()) { return; }
+
+    ThermalWindow* const window = thermal_active_;
+    window->count++;
+    window->current2_sum +=
+        status_.d_A * status_.d_A + status_.q_A * status_.q_A;
+  }
+
   void ISR_DoSenseCritical() __attribute__((always_inline)) MOTEUS_CCM_ATTRIBUTE {
     // Wait for sampling to complete.
     while ((ADC3->ISR & ADC_ISR_EOS) == 0);
@@ -923,6 +1103,10 @@ class BldcServo::Impl {
         current_data_->timeout_s != 0.0f) {
       status_.timeout_s = current_data_->timeout_s;
       current_data_->timeout_s = 0.0;
+
+      // Every command is also a heartbeat.
+      status_.watchdog.consecutive_misses = 0;
+      status_.watchdog.since_heartbeat_s = 0.0f;
     }
 
     // And now, wait for the entire conversion to complete.  We
@@ -1077,6 +1261,28 @@ class BldcServo::Impl {
     ISR_UpdateFilteredValue(status_.bus_V, filtered, period_s);
   }
 
+  void ISR_UpdateLoadObserver() MOTEUS_CCM_ATTRIBUTE {
+    if (!load_observer_.enabled()) { return; }
+
+    if (!position_.position_relative_valid ||
+        position_.error != MotorPosition::Status::kNone) {
+      status_.load_observer.active = false;
+      return;
+    }
+
+    const int64_t position_raw = position_.position_relative_raw;
+    if (!status_.load_observer.active) {
+      load_observer_.Reset(position_.velocity);
+    } else {
+      // The position is measured in the output frame, which includes
+      // the output sign, so the torque must be too.
+      load_observer_.Update(
+          MotorPosition::IntToFloat(position_raw - load_observer_position_raw_),
+          motor_position_config()->output.sign * status_.torque_Nm);
+    }
+    load_observer_position_raw_ = position_raw;
+  }
+
   // This is called from the ISR.
   void ISR_CalculateCurrentState(const SinCos& sin_cos) MOTEUS_CCM_ATTRIBUTE {
     status_.cur1_A = (status_.adc_cur1_raw - status_.adc_cur1_offset) * adc_scale_;
@@ -1255,6 +1461,9 @@ class BldcServo::Impl {
               status_.meas_ind_integrator = 0.0f;
               status_.meas_ind_old_d_A = status_.d_A;
             }
+            if (data->mode == kPositionTimeout) {
+              ISR_EnterPositionTimeout();
+            }
 
             return;
           }
@@ -1380,6 +1589,8 @@ class BldcServo::Impl {
 
     control_.Clear();
 
+    ISR_UpdateSharedTime();
+
     if (!std::isnan(status_.timeout_s) && status_.timeout_s > 0.0f) {
       status_.timeout_s =
           std::max(0.0f, status_.timeout_s - rate_config_.period_s);
@@ -1420,10 +1631,8 @@ class BldcServo::Impl {
       }
     }
 
-    if ((status_.mode == kPosition || status_.mode == kStayWithinBounds) &&
-        !std::isnan(status_.timeout_s) &&
-        status_.timeout_s <= 0.0f) {
-      status_.mode = kPositionTimeout;
+    if (status_.mode == kPosition || status_.mode == kStayWithinBounds) {
+      ISR_CheckWatchdog();
     }
 
     // Ensure unused PID controllers have zerod state.
@@ -1838,21 +2047,93 @@ class BldcServo::Impl {
     ISR_DoBalancedVoltageControl(ISR_CalculatePhaseVoltage(sin_cos, d_V, q_V));
   }
 
+  void ISR_UpdateSharedTime() MOTEUS_CCM_ATTRIBUTE {
+    const uint32_t cycles_per_us = SystemCoreClock / 1000000;
+
+    if (shared_time_set_) {
+      // Account for the time since the frame which set it was
+      // received.
+      const uint32_t elapsed_cycles = DWT->CYCCNT - shared_time_set_cycles_;
+      status_.shared_time_us =
+          shared_time_set_us_ + elapsed_cycles / cycles_per_us;
+      shared_time_cycles_ = elapsed_cycles % cycles_per_us;
+      shared_time_set_ = false;
+      return;
+    }
+
+    // total_timer is the length of one control period in CPU cycles.
+    shared_time_cycles_ += status_.total_timer;
+    const uint32_t us = shared_time_cycles_ / cycles_per_us;
+    status_.shared_time_us += us;
+    shared_time_cycles_ -= us * cycles_per_us;
+  }
+
+  void ISR_CheckWatchdog() MOTEUS_CCM_ATTRIBUTE {
+    auto& watchdog = status_.watchdog;
+
+    if (!std::isnan(status_.timeout_s) &&
+        status_.timeout_s <= 0.0f) {
+      watchdog.cause = BldcServoTimeoutCause::kCommand;
+      watchdog.command_timeouts++;
+      ISR_EnterPositionTimeout();
+      return;
+    }
+
+    if (config_.heartbeat_period_s <= 0.0f) { return; }
+
+    const uint32_t heartbeat_count = heartbeat_count_;
+    if (heartbeat_count != watchdog.heartbeat_count) {
+      watchdog.heartbeat_count = heartbeat_count;
+      watchdog.consecutive_misses = 0;
+      watchdog.since_heartbeat_s = 0.0f;
+      return;
+    }
+
+    watchdog.since_heartbeat_s += rate_config_.period_s;
+    if (watchdog.since_heartbeat_s < config_.heartbeat_period_s) { return; }
+
+    watchdog.since_heartbeat_s -= config_.heartbeat_period_s;
+    watchdog.missed_heartbeats++;
+    if (watchdog.consecutive_misses < 65535) {
+      watchdog.consecutive_misses++;
+    }
+
+    if (watchdog.consecutive_misses > config_.heartbeat_misses) {
+      watchdog.cause = BldcServoTimeoutCause::kHeartbeat;
+      watchdog.heartbeat_timeouts++;
+      ISR_EnterPositionTimeout();
+    }
+  }
+
+  void ISR_EnterPositionTimeout() MOTEUS_CCM_ATTRIBUTE {
+    status_.mode = kPositionTimeout;
+
+    // The "decelerate to 0" fallback is planned here, once, from the
+    // state at the time of the timeout, so that it is not disturbed
+    // by anything the host sends afterwards.
+    timeout_data_ = {};
+    timeout_data_.mode = kPosition;
+    timeout_data_.position = std::numeric_limits<float>::quiet_NaN();
+    timeout_data_.velocity_limit = config_.default_velocity_limit;
+    timeout_data_.accel_limit =
+        std::isnan(config_.timeout_accel_limit) ?
+        config_.default_accel_limit :
+        config_.timeout_accel_limit;
+    timeout_data_.jerk_limit =
+        std::isnan(config_.timeout_jerk_limit) ?
+        config_.default_jerk_limit :
+        config_.timeout_jerk_limit;
+    timeout_data_.timeout_s = std::numeric_limits<float>::quiet_NaN();
+  }
+
   void ISR_DoPositionTimeout(const SinCos& sin_cos, CommandData* data) MOTEUS_CCM_ATTRIBUTE {
     if (config_.timeout_mode == kStopped) {
       ISR_DoStopped(sin_cos);
     } else if (config_.timeout_mode == kPosition) {
-      CommandData timeout_data;
-      timeout_data.mode = kPosition;
-      timeout_data.position = std::numeric_limits<float>::quiet_NaN();
-      timeout_data.velocity_limit = config_.default_velocity_limit;
-      timeout_data.accel_limit = config_.default_accel_limit;
-      timeout_data.timeout_s = std::numeric_limits<float>::quiet_NaN();
-
       PID::ApplyOptions apply_options;
       ISR_DoPositionCommon(
-          sin_cos, &timeout_data, apply_options,
-          timeout_data.max_torque_Nm,
+          sin_cos, &timeout_data_, apply_options,
+          timeout_data_.max_torque_Nm,
           0.0f,
           0.0f);
     } else if (config_.timeout_mode == kZeroVelocity) {
@@ -1901,6 +2182,9 @@ class BldcServo::Impl {
         static_cast<int64_t>(
             motor_position_->absolute_relative_delta.load()) << 32ll;
 
+    const bool jerk_planned = data->jerk_trajectory_planned;
+    const uint32_t start_cycles = DWT->CYCCNT;
+
     const float velocity_command =
         BldcServoPosition::UpdateCommand(
             &status_,
@@ -1912,6 +2196,13 @@ class BldcServo::Impl {
             data,
             velocity);
 
+    if (!jerk_planned && data->jerk_trajectory_planned) {
+      const uint32_t plan_cycles = DWT->CYCCNT - start_cycles;
+      if (plan_cycles > max_jerk_plan_cycles_) {
+        max_jerk_plan_cycles_ = plan_cycles;
+      }
+    }
+
     // At this point, our control position and velocity are known.
 
     if (config_.fixed_voltage_mode ||
@@ -1959,9 +2250,24 @@ class BldcServo::Impl {
       return;
     }
 
+    const bool load_observer_active = status_.load_observer.active;
+    const float estimated_velocity =
+        (load_observer_active && config_.load_observer.use_velocity) ?
+        status_.load_observer.velocity :
+        position_.velocity;
+    const float load_feedforward_Nm =
+        load_observer_active ?
+        config_.load_observer.feedforward * status_.load_observer.load_Nm :
+        0.0f;
+    status_.feedforward_model_Nm =
+        FeedforwardModel::Calculate(
+            config_.feedforward_model,
+            velocity_command,
+            status_.control_acceleration);
+
     const float measured_velocity = velocity_command +
         Threshold(
-            position_.velocity - velocity_command, -config_.velocity_threshold,
+            estimated_velocity - velocity_command, -config_.velocity_threshold,
             config_.velocity_threshold);
 
     // We always control relative to the control position of 0, so
@@ -1978,7 +2284,9 @@ class BldcServo::Impl {
             measured_velocity, velocity_command,
             rate_config_.rate_hz,
             pid_options) +
-         feedforward_Nm);
+         feedforward_Nm +
+         load_feedforward_Nm +
+         status_.feedforward_model_Nm);
 
     const float limited_torque_Nm =
         Limit(unlimited_torque_Nm, -max_torque_Nm, max_torque_Nm);
@@ -2282,6 +2590,29 @@ class BldcServo::Impl {
   // These values should only be modified from within the ISR.
   Status status_;
   Control control_;
+  volatile uint32_t isr_cycles_ = 0;
+  volatile uint32_t max_isr_cycles_ = 0;
+  volatile uint32_t max_jerk_plan_cycles_ = 0;
+
+  // Incremented from the main loop for each host heartbeat.
+  volatile uint32_t heartbeat_count_ = 0;
+
+  // A new shared time, passed from the main loop to the ISR, along
+  // with the DWT cycle count at which it was valid.
+  volatile bool shared_time_set_ = false;
+  volatile uint32_t shared_time_set_us_ = 0;
+  volatile uint32_t shared_time_set_cycles_ = 0;
+  uint32_t shared_time_cycles_ = 0;
+
+  // The command used by the "decelerate to 0" timeout mode, which
+  // persists for as long as the timeout mode is active.
+  CommandData timeout_data_;
+  SeqLock<StatusSnapshot> snapshot_;
+
+  // Both windows are written from the ISR, and swapped from the main
+  // loop by ReadStatistics.
+  mutable Statistics statistics_[2] = {};
+  mutable Statistics* volatile statistics_active_ = &statistics_[0];
   uint32_t calibrate_adc1_ = 0;
   uint32_t calibrate_adc2_ = 0;
   uint32_t calibrate_adc3_ = 0;
@@ -2290,6 +2621,22 @@ class BldcServo::Impl {
   SimplePI pid_d_{&config_.pid_dq, &status_.pid_d};
   SimplePI pid_q_{&config_.pid_dq, &status_.pid_q};
   PID pid_position_{&config_.pid_position, &status_.pid_position};
+  LoadObserver load_observer_{
+    &config_.load_observer, &status_.load_observer};
+  int64_t load_observer_position_raw_ = 0;
+
+  // The thermal model is updated from the main loop, using the
+  // squared current accumulated by the ISR.
+  static constexpr int kThermalPeriodMs = 10;
+  struct ThermalWindow {
+    uint32_t count = 0;
+    float current2_sum = 0.0f;
+  };
+  ThermalWindow thermal_[2] = {};
+  ThermalWindow* volatile thermal_active_ = &thermal_[0];
+  int thermal_ms_ = 0;
+  ThermalModel thermal_model_{
+    &config_.thermal_model, &status_.thermal_model};
 
   USART_TypeDef* debug_uart_ = nullptr;
   USART_TypeDef* onboard_debug_uart_ = nullptr;
@@ -2358,6 +2705,38 @@ const BldcServo::Status& BldcServo::status() const {
   return impl_->status();
 }
 
+BldcServo::StatusSnapshot BldcServo::status_snapshot() const {
+  return impl_->status_snapshot();
+}
+
+uint32_t BldcServo::status_sequence() const {
+  return impl_->status_sequence();
+}
+
+BldcServo::Statistics BldcServo::ReadStatistics() const {
+  return impl_->ReadStatistics();
+}
+
+void BldcServo::Heartbeat() {
+  impl_->Heartbeat();
+}
+
+void BldcServo::SetSharedTime(uint32_t time_us, uint32_t rx_cycles) {
+  impl_->SetSharedTime(time_us, rx_cycles);
+}
+
+uint32_t BldcServo::isr_cycles() const {
+  return impl_->isr_cycles();
+}
+
+uint32_t BldcServo::ReadMaxIsrCycles() {
+  return impl_->ReadMaxIsrCycles();
+}
+
+uint32_t BldcServo::ReadMaxJerkPlanCycles() {
+  return impl_->ReadMaxJerkPlanCycles();
+}
+
 const BldcServo::Config& BldcServo::config() const {
   return impl_->config();
 }
@@ -80,6 +80,8 @@ class BldcServo {
 
   using Mode = BldcServoMode;
   using Status = BldcServoStatus;
+  using StatusSnapshot = BldcServoStatusSnapshot;
+  using Statistics = BldcServoStatistics;
   using CommandData = BldcServoCommandData;
   using Motor = BldcServoMotor;
   using Config = BldcServoConfig;
@@ -136,6 +138,21 @@ class BldcServo {
   void Command(const CommandData&);
 
   const Status& status() const;
+
+  /// A copy of the most recently published status, guaranteed to be
+  /// from a single control cycle.
+  StatusSnapshot status_snapshot() const;
+
+  /// Changes once each control cycle, when status_snapshot() is
+  /// published.  Every cycle which changes status() or control()
+  /// publishes a snapshot before the main loop can resume, so values
+  /// copied from them while this is unchanged are from one cycle.
+  uint32_t status_sequence() const;
+
+  /// The statistics accumulated since the previous call, which
+  /// starts a new accumulation window.  No control cycle is missed or
+  /// counted twice between windows.
+  Statistics ReadStatistics() const;
   const Config& config() const;
   const Control& control() const;
   const AuxPort::Status& aux1() const;
@@ -144,6 +161,26 @@ class BldcServo {
   MotorPosition::Config* motor_position_config();
   const MotorPosition::Config* motor_position_config() const;
 
+  /// A free running count of CPU cycles spent in the control
+  /// interrupt.
+  uint32_t isr_cycles() const;
+
+  /// The longest the control interrupt has taken to complete, as
+  /// measured from the start of its PWM period, since the last call.
+  uint32_t ReadMaxIsrCycles();
+
+  /// The longest a control cycle spent updating the position command
+  /// when it planned a new jerk limited move, since the last call.
+  uint32_t ReadMaxJerkPlanCycles();
+
+  /// Reset the host watchdog, as if a command had been received,
+  /// without otherwise changing the command.
+  void Heartbeat();
+
+  /// Set the shared clock, status().shared_time_us, to @p time_us as
+  /// of the DWT cycle count @p rx_cycles.
+  void SetSharedTime(uint32_t time_us, uint32_t rx_cycles);
+
   void SetOutputPositionNearest(float position);
   void SetOutputPosition(float position);
   void RequireReindex();
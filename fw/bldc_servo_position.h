@@ -27,14 +27,52 @@ namespace moteus {
 // them in the header and also have a section definition.
 class BldcServoPosition {
  public:
+  // When planning a jerk limited move, the cruise velocity is
+  // refined until the cruise phase lasts no longer than this, or the
+  // iteration limit is reached.
+  static constexpr int kJerkPlanIterations = 8;
+  static constexpr float kJerkPlanCruiseTolerance_s = 0.001f;
+
+  // Without a velocity limit, the estimated upper bound on the cruise
+  // velocity is doubled at most this many times.  If it is still
+  // reachable, it is used as the cruise velocity, which is a valid,
+  // if slower, plan.
+  //
+  // Planning happens in the control ISR, so these bound its cost to
+  // 2 + kJerkPlanDoublings + kJerkPlanIterations evaluations of the
+  // stopping distance.  system_info.jerk_plan_max_us reports what
+  // that costs on the target.
+  static constexpr int kJerkPlanDoublings = 4;
+
+  // A jerk limited move which ends further than this from its target,
+  // in revolutions, is planned again.  Equally, when planning, a stop
+  // which would end within this distance of the target is used as is.
+  static constexpr float kJerkPositionTolerance = 0.0001f;
+
+  // The integral positions wrap around at the extremes of their
+  // range, like the relative position they are compared against.
+  // Signed overflow is undefined, so do the math unsigned.
+  static int64_t WrappingAdd(int64_t a, int64_t b) MOTEUS_CCM_ATTRIBUTE {
+    return static_cast<int64_t>(
+        static_cast<uint64_t>(a) + static_cast<uint64_t>(b));
+  }
+
+  // Convert a per-cycle step in revolutions to the integral position
+  // scale, with 32 fractional bits of precision.  A left shift of a
+  // negative value is undefined, so scale by multiplication, which
+  // compiles to the same shift.
+  static int64_t StepToInt(float step) MOTEUS_CCM_ATTRIBUTE {
+    return static_cast<int64_t>(
+        static_cast<int32_t>(static_cast<float>(1ll << 32) * step)) *
+        (1ll << 16);
+  }
+
   static void DoVelocityModeLimits(
       BldcServoStatus* status,
       const BldcServoConfig* config,
-      float rate_hz,
+      float period_s,
       BldcServoCommandData* data,
       float velocity) MOTEUS_CCM_ATTRIBUTE {
-    const float period_s = 1.0f / rate_hz;
-
     if (!std::isnan(data->velocity_limit)) {
       if (velocity > data->velocity_limit) { velocity = data->velocity_limit; }
       if (velocity < -data->velocity_limit) { velocity = -data->velocity_limit; }
@@ -128,11 +166,9 @@ class BldcServoPosition {
   static void DoVelocityAndAccelLimits(
       BldcServoStatus* status,
       const BldcServoConfig* config,
-      float rate_hz,
+      float period_s,
       BldcServoCommandData* data,
       float velocity) MOTEUS_CCM_ATTRIBUTE {
-    const float period_s = 1.0f / rate_hz;
-
     // This is the most general case.  We decide whether to
     // accelerate, remain constant, or decelerate, then advance the
     // control velocity in an appropriate manner, and finally check
@@ -190,10 +226,415 @@ class BldcServoPosition {
     }
   }
 
-  static void UpdateTrajectory(
+  // The velocity limit which moves @p dx, starting at velocity @p v0
+  // and ending at rest, in exactly @p remaining_s, when accelerating
+  // at @p a.  This is the cruise velocity of the matching trapezoidal
+  // profile.  If no such profile exists, because we are late or are
+  // already certain to overshoot, then @p max_velocity is returned so
+  // that the move completes as soon as possible.
+  static float ArrivalVelocityLimit(
+      float dx, float v0, float a, float remaining_s,
+      float max_velocity) MOTEUS_CCM_ATTRIBUTE {
+    if (!(remaining_s > 0.0f)) { return max_velocity; }
+
+    // Work in the direction of travel.
+    const float d = std::abs(dx);
+    const float v = dx < 0.0f ? -v0 : v0;
+
+    if (!std::isfinite(a)) {
+      return std::min(d / remaining_s, max_velocity);
+    }
+
+    // If we first accelerate from v up to the cruise velocity u,
+    // then:
+    //
+    //  2 u^2 - 2 u (a T + v) + (v^2 + 2 a d) = 0
+    const float b = a * remaining_s + v;
+    const float discriminant = b * b - 2.0f * (v * v + 2.0f * a * d);
+    if (discriminant >= 0.0f) {
+      const float u = 0.5f * (b - std::sqrt(discriminant));
+      if (u >= v) { return std::min(u, max_velocity); }
+    }
+
+    // Otherwise we decelerate from v down to u, and:
+    //
+    //  d = u T + (v^2 - 2 u v) / (2 a)
+    const float cruise_s = remaining_s - v / a;
+    if (cruise_s > 0.0f) {
+      const float u = (d - 0.5f * v * v / a) / cruise_s;
+      if (u >= 0.0f && u <= v) { return std::min(u, max_velocity); }
+    }
+
+    return max_velocity;
+  }
+
+  static bool UseJerkLimit(const BldcServoCommandData* data) MOTEUS_CCM_ATTRIBUTE {
+    return std::isfinite(data->jerk_limit) && data->jerk_limit > 0.0f &&
+        std::isfinite(data->accel_limit);
+  }
+
+  // True if next only repeats current, whose jerk limited plan can
+  // then be followed without planning again.  Planning takes much
+  // longer than following a plan, and hosts often stream the same
+  // target at a high rate.
+  static bool ContinuesJerkPlan(const BldcServoCommandData& next,
+                                const BldcServoCommandData& current) {
+    auto same = [](float a, float b) {
+      return a == b || (std::isnan(a) && std::isnan(b));
+    };
+    return current.jerk_trajectory_planned &&
+        UseJerkLimit(&next) &&
+        next.mode == current.mode &&
+        next.position_relative_raw == current.position_relative_raw &&
+        same(next.velocity, current.velocity) &&
+        same(next.velocity_limit, current.velocity_limit) &&
+        same(next.accel_limit, current.accel_limit) &&
+        same(next.jerk_limit, current.jerk_limit);
+  }
+
+  struct JerkLimits {
+    float accel = 0.0f;
+    float jerk = 0.0f;
+    float inverse_jerk = 0.0f;
+  };
+
+  // Advance a constant jerk segment by t, returning the distance
+  // travelled.
+  static float Integrate(float* v, float* a, float jerk, float t) MOTEUS_CCM_ATTRIBUTE {
+    const float dx = t * (*v + t * (0.5f * *a + t * (jerk * (1.0f / 6.0f))));
+    *v += t * (*a + 0.5f * t * jerk);
+    *a += t * jerk;
+    return dx;
+  }
+
+  // Changing the velocity from v to vf, starting at acceleration a
+  // and ending at 0, takes three segments: ramp the acceleration to
+  // a peak, hold it, then ramp it back to 0.
+  struct VelocityChange {
+    float jerk = 0.0f;
+    float ramp_up_s = 0.0f;
+    float hold_s = 0.0f;
+    float ramp_down_s = 0.0f;
+  };
+
+  static VelocityChange CalculateVelocityChange(
+      float v, float a, float vf, const JerkLimits& limits) MOTEUS_CCM_ATTRIBUTE {
+    // Bringing the acceleration to 0 as quickly as possible would
+    // leave us here, which tells us which way we need to go.
+    const float v_settle = v + 0.5f * a * std::abs(a) * limits.inverse_jerk;
+    const float sign = (vf >= v_settle) ? 1.0f : -1.0f;
+    const float a0 = sign * a;
+    const float dv = sign * (vf - v);
+
+    // If the acceleration limit was lowered while we were
+    // accelerating harder than it, hold what we have rather than
+    // overshoot by ramping it down.
+    const float max_accel = std::max(limits.accel, a0);
+
+    VelocityChange result;
+    result.jerk = sign * limits.jerk;
+
+    float peak = 0.0f;
+    const float peak_squared = limits.jerk * dv + 0.5f * a0 * a0;
+    if (peak_squared > max_accel * max_accel) {
+      peak = max_accel;
+      result.hold_s = std::max(
+          0.0f,
+          (dv - (peak * peak - 0.5f * a0 * a0) * limits.inverse_jerk) / peak);
+    } else {
+      peak = std::sqrt(std::max(0.0f, peak_squared));
+    }
+    result.ramp_up_s = std::max(0.0f, (peak - a0) * limits.inverse_jerk);
+    result.ramp_down_s = peak * limits.inverse_jerk;
+    return result;
+  }
+
+  static float VelocityChangeDistance(
+      const VelocityChange& change, float v, float a) MOTEUS_CCM_ATTRIBUTE {
+    float dx = Integrate(&v, &a, change.jerk, change.ramp_up_s);
+    dx += Integrate(&v, &a, 0.0f, change.hold_s);
+    dx += Integrate(&v, &a, -change.jerk, change.ramp_down_s);
+    return dx;
+  }
+
+  // The distance travelled when changing velocity from (v, a) to
+  // cruise_velocity, then stopping.
+  static float CruiseStopDistance(
+      float v, float a, float cruise_velocity,
+      const JerkLimits& limits) MOTEUS_CCM_ATTRIBUTE {
+    return
+        VelocityChangeDistance(
+            CalculateVelocityChange(v, a, cruise_velocity, limits), v, a) +
+        VelocityChangeDistance(
+            CalculateVelocityChange(cruise_velocity, 0.0f, 0.0f, limits),
+            cruise_velocity, 0.0f);
+  }
+
+  static void AppendSegment(BldcServoJerkTrajectory* trajectory,
+                            float duration_s, float jerk) MOTEUS_CCM_ATTRIBUTE {
+    auto& segment = trajectory->segments[trajectory->num_segments++];
+    segment.duration_s = duration_s;
+    segment.jerk = jerk;
+  }
+
+  static void AppendVelocityChange(BldcServoJerkTrajectory* trajectory,
+                                   const VelocityChange& change,
+                                   float sign) MOTEUS_CCM_ATTRIBUTE {
+    AppendSegment(trajectory, change.ramp_up_s, sign * change.jerk);
+    AppendSegment(trajectory, change.hold_s, 0.0f);
+    AppendSegment(trajectory, change.ramp_down_s, -sign * change.jerk);
+  }
+
+  static void StartJerkTrajectory(BldcServoJerkTrajectory* trajectory,
+                                  float v, float a,
+                                  float final_velocity) MOTEUS_CCM_ATTRIBUTE {
+    trajectory->segment = 0;
+    trajectory->start_s = 0.0f;
+    trajectory->cycles = 0;
+    trajectory->time_s = 0.0f;
+    trajectory->velocity = v;
+    trajectory->acceleration = a;
+    trajectory->final_velocity = final_velocity;
+
+    // Record the state at the start of each segment, so that we do
+    // not accumulate error from one segment to the next.
+    for (int i = 0; i < trajectory->num_segments; i++) {
+      auto& segment = trajectory->segments[i];
+      segment.velocity = v;
+      segment.acceleration = a;
+      Integrate(&v, &a, segment.jerk, segment.duration_s);
+    }
+  }
+
+  // Plan a change from the relative velocity v and acceleration a to
+  // the relative velocity vf.
+  static void PlanJerkVelocity(
+      BldcServoJerkTrajectory* trajectory,
+      float v, float a, float vf,
+      const JerkLimits& limits) MOTEUS_CCM_ATTRIBUTE {
+    trajectory->num_segments = 0;
+    AppendVelocityChange(
+        trajectory, CalculateVelocityChange(v, a, vf, limits), 1.0f);
+    StartJerkTrajectory(trajectory, v, a, vf);
+  }
+
+  // Plan a move of dx from the relative velocity v and acceleration
+  // a, ending at rest.  The cruise velocity is limited to
+  // max_velocity in the positive direction and min_velocity in the
+  // negative direction.
+  static void PlanJerkPosition(
+      BldcServoJerkTrajectory* trajectory,
+      float v, float a, float dx,
+      float min_velocity, float max_velocity,
+      const JerkLimits& limits) MOTEUS_CCM_ATTRIBUTE {
+    // If we would overshoot by stopping now, we must cruise in the
+    // negative direction.  Either way, solve the problem as if the
+    // cruise velocity is positive.
+    const float stop_distance = CruiseStopDistance(v, a, 0.0f, limits);
+
+    // If stopping now would put us on the target, as it will when
+    // the same command is repeated while decelerating, then do that,
+    // rather than cruising a tiny distance one way or the other.
+    if (std::abs(dx - stop_distance) <= kJerkPositionTolerance) {
+      PlanJerkVelocity(trajectory, v, a, 0.0f, limits);
+      return;
+    }
+
+    const float sign = (dx >= stop_distance) ? 1.0f : -1.0f;
+    v *= sign;
+    a *= sign;
+    dx *= sign;
+    const float velocity_limit =
+        std::max(0.0f, (sign > 0.0f) ? max_velocity : -min_velocity);
+
+    // The remaining distance if we were to cruise at a given
+    // velocity, which must be non-negative for a valid plan.
+    auto remaining = [&](float cruise_velocity) MOTEUS_CCM_ATTRIBUTE {
+      return dx - CruiseStopDistance(v, a, cruise_velocity, limits);
+    };
+
+    // The remaining distance is positive at 0, so we search for the
+    // largest cruise velocity for which it remains so.
+    float lo = 0.0f;
+    float lo_remaining = dx - sign * stop_distance;
+    float hi = velocity_limit;
+    if (!std::isfinite(hi)) {
+      hi = std::abs(v) + std::sqrt(limits.accel * lo_remaining) +
+          limits.accel * limits.accel * limits.inverse_jerk;
+      for (int i = 0; i < kJerkPlanDoublings && remaining(hi) >= 0.0f; i++) {
+        hi *= 2.0f;
+      }
+    }
+    float hi_remaining = remaining(hi);
+
+    if (hi_remaining >= 0.0f) {
+      lo = hi;
+      lo_remaining = hi_remaining;
+    } else {
+      // This is the Illinois variant of regula falsi.  It usually
+      // converges in a few iterations.  Any lower bound makes a
+      // valid plan, as the cruise absorbs what distance remains, so
+      // we stop once the cruise is short.
+      float lo_weight = lo_remaining;
+      float hi_weight = hi_remaining;
+      int last_side = 0;
+      for (int i = 0;
+           i < kJerkPlanIterations &&
+               lo_remaining > kJerkPlanCruiseTolerance_s * lo;
+           i++) {
+        const float mid = lo + (hi - lo) * lo_weight / (lo_weight - hi_weight);
+        const float mid_remaining = remaining(mid);
+        if (mid_remaining >= 0.0f) {
+          lo = mid;
+          lo_remaining = lo_weight = mid_remaining;
+          if (last_side > 0) { hi_weight *= 0.5f; }
+          last_side = 1;
+        } else {
+          hi = mid;
+          hi_weight = mid_remaining;
+          if (last_side < 0) { lo_weight *= 0.5f; }
+          last_side = -1;
+        }
+      }
+    }
+
+    const float cruise_s =
+        (lo > 0.0f) ? (lo_remaining / lo) :
+        // We cannot move towards a target moving away from us at the
+        // velocity limit, so cruise alongside it forever.
+        (velocity_limit <= 0.0f) ? std::numeric_limits<float>::infinity() :
+        0.0f;
+
+    trajectory->num_segments = 0;
+    AppendVelocityChange(
+        trajectory, CalculateVelocityChange(v, a, lo, limits), sign);
+    AppendSegment(trajectory, cruise_s, 0.0f);
+    AppendVelocityChange(
+        trajectory, CalculateVelocityChange(lo, 0.0f, 0.0f, limits), sign);
+    StartJerkTrajectory(trajectory, sign * v, sign * a, 0.0f);
+  }
+
+  // Advance the trajectory by one period, returning the distance
+  // travelled relative to the frame.
+  static float AdvanceJerkTrajectory(
+      BldcServoJerkTrajectory* trajectory,
+      float period_s) MOTEUS_CCM_ATTRIBUTE {
+    float dx = 0.0f;
+    float remaining_s = period_s;
+    float t0 = trajectory->time_s;
+    while (trajectory->segment < trajectory->num_segments) {
+      // Evaluate the state from the start of the segment, rather than
+      // accumulating it, so that rounding errors do not build up.
+      const auto& segment = trajectory->segments[trajectory->segment];
+      float v = segment.velocity +
+          t0 * (segment.acceleration + 0.5f * t0 * segment.jerk);
+      float a = segment.acceleration + t0 * segment.jerk;
+
+      const float segment_remaining_s = segment.duration_s - t0;
+      if (segment_remaining_s > remaining_s) {
+        dx += Integrate(&v, &a, segment.jerk, remaining_s);
+        trajectory->velocity = v;
+        trajectory->acceleration = a;
+
+        // Likewise, count whole cycles rather than accumulating time.
+        trajectory->cycles++;
+        trajectory->time_s =
+            trajectory->start_s +
+            static_cast<float>(trajectory->cycles) * period_s;
+        return dx;
+      }
+
+      dx += Integrate(&v, &a, segment.jerk, segment_remaining_s);
+      remaining_s -= segment_remaining_s;
+      trajectory->segment++;
+      trajectory->start_s = remaining_s - period_s;
+      trajectory->cycles = 0;
+      trajectory->time_s = 0.0f;
+      t0 = 0.0f;
+    }
+
+    trajectory->velocity = trajectory->final_velocity;
+    trajectory->acceleration = 0.0f;
+    return dx + trajectory->velocity * remaining_s;
+  }
+
+  // Returns the distance to advance the control position this cycle.
+  static float DoJerkLimits(
+      BldcServoStatus* status,
+      float period_s,
+      BldcServoCommandData* data,
+      float velocity) MOTEUS_CCM_ATTRIBUTE {
+    auto* const trajectory = &status->jerk_trajectory;
+    const bool position_mode = !!data->position_relative_raw;
+
+    // In position mode, the target is at rest in this frame.
+    const float frame_velocity = position_mode ? velocity : 0.0f;
+
+    const float dx =
+        position_mode ?
+        MotorPosition::IntToFloat(
+            *data->position_relative_raw - *status->control_position_raw) :
+        0.0f;
+
+    if (!data->jerk_trajectory_planned) {
+      data->jerk_trajectory_planned = true;
+
+      JerkLimits limits;
+      limits.accel = data->accel_limit;
+      limits.jerk = data->jerk_limit;
+      limits.inverse_jerk = 1.0f / data->jerk_limit;
+
+      const float v = *status->control_velocity - frame_velocity;
+      const float a = status->control_acceleration;
+      trajectory->frame_velocity = frame_velocity;
+      if (position_mode) {
+        const float velocity_limit =
+            std::isnan(data->velocity_limit) ?
+            std::numeric_limits<float>::infinity() :
+            data->velocity_limit;
+        PlanJerkPosition(
+            trajectory, v, a, dx,
+            -velocity_limit - frame_velocity,
+            velocity_limit - frame_velocity,
+            limits);
+      } else {
+        PlanJerkVelocity(trajectory, v, a, velocity, limits);
+      }
+    }
+
+    const float step = AdvanceJerkTrajectory(trajectory, period_s);
+    const bool complete = trajectory->segment >= trajectory->num_segments;
+
+    if (complete && position_mode) {
+      if (std::abs(dx - step) > kJerkPositionTolerance) {
+        // Something, like a position slip limit, kept us from
+        // following the plan.  Make a new one.
+        data->jerk_trajectory_planned = false;
+      } else {
+        data->position = std::numeric_limits<float>::quiet_NaN();
+        data->position_relative_raw.reset();
+        status->trajectory_done = true;
+      }
+    } else if (complete) {
+      status->trajectory_done = true;
+    }
+
+    // The control velocity is the velocity at the end of the cycle,
+    // which is where we plan the next command from.  The control
+    // position advances by the exact integral over the cycle.
+    status->control_velocity =
+        trajectory->frame_velocity + trajectory->velocity;
+    status->control_acceleration = trajectory->acceleration;
+
+    return trajectory->frame_velocity * period_s + step;
+  }
+
+  // Returns the distance to advance the control position this cycle
+  // if it is not simply control_velocity * period_s, otherwise NaN.
+  static float UpdateTrajectory(
       BldcServoStatus* status,
       const BldcServoConfig* config,
-      float rate_hz,
+      float period_s,
       BldcServoCommandData* data,
       float velocity) MOTEUS_CCM_ATTRIBUTE {
     // Clamp the desired velocity to our limit if we have one.
@@ -202,13 +643,18 @@ class BldcServoPosition {
       if (velocity < -data->velocity_limit) { velocity = -data->velocity_limit; }
     }
 
+    if (UseJerkLimit(data)) {
+      return DoJerkLimits(status, period_s, data, velocity);
+    }
+
     if (!data->position_relative_raw) {
       DoVelocityModeLimits(
-          status, config, rate_hz, data, velocity);
+          status, config, period_s, data, velocity);
     } else {
       DoVelocityAndAccelLimits(
-          status, config, rate_hz, data, velocity);
+          status, config, period_s, data, velocity);
     }
+    return std::numeric_limits<float>::quiet_NaN();
   }
 
   static float UpdateCommand(
@@ -220,6 +666,9 @@ class BldcServoPosition {
       float rate_hz,
       BldcServoCommandData* data,
       float velocity) MOTEUS_CCM_ATTRIBUTE {
+    // Division is much slower than multiplication on the M4, so do
+    // it only once per cycle.
+    const float period_s = 1.0f / rate_hz;
 
     if (std::isnan(velocity)) {
       velocity = 0.0f;
@@ -250,6 +699,7 @@ class BldcServoPosition {
       status->control_velocity = velocity;
     } else if (!status->control_position_raw) {
       status->control_position_raw = position->position_relative_raw;
+      status->control_acceleration = 0.0f;
 
       if (std::abs(status->velocity_filt) <
           config->velocity_zero_capture_threshold) {
@@ -259,8 +709,36 @@ class BldcServoPosition {
       }
     }
 
-    if (!status->trajectory_done) {
-      UpdateTrajectory(status, config, rate_hz, data, velocity);
+    const float initial_velocity = status->control_velocity.value_or(0.0f);
+
+    if (data->arrival_time_us && data->position_relative_raw) {
+      // The shared time wraps, so only the difference is meaningful.
+      const float remaining_s = 1e-6f * static_cast<float>(
+          static_cast<int32_t>(
+              *data->arrival_time_us - status->shared_time_us));
+      data->velocity_limit = ArrivalVelocityLimit(
+          MotorPosition::IntToFloat(
+              *data->position_relative_raw - *status->control_position_raw),
+          *status->control_velocity,
+          data->accel_limit,
+          remaining_s,
+          config->max_velocity);
+    }
+
+    float step = std::numeric_limits<float>::quiet_NaN();
+    const bool trajectory_active = !status->trajectory_done;
+    if (trajectory_active) {
+      step = UpdateTrajectory(status, config, period_s, data, velocity);
+    }
+
+    if (!UseJerkLimit(data)) {
+      // The acceleration limited planner does not track acceleration
+      // itself, so recover it from the change in velocity.  Without
+      // an acceleration limit, velocity changes are instantaneous.
+      status->control_acceleration =
+          (trajectory_active && !std::isnan(data->accel_limit)) ?
+          (*status->control_velocity - initial_velocity) * rate_hz :
+          0.0f;
     }
 
     auto velocity_command = *status->control_velocity;
@@ -268,20 +746,18 @@ class BldcServoPosition {
     // This limits our usable velocity to 20kHz modulo the position
     // scale at a 40kHz switching frequency.  1.2 million RPM should
     // be enough for anybody?
-    const float step = velocity_command / rate_hz;
-    const int64_t int64_step =
-        (static_cast<int64_t>(
-            static_cast<int32_t>((static_cast<float>(1ll << 32) * step))) <<
-         16);
-    status->control_position_raw = *status->control_position_raw + int64_step;
+    if (std::isnan(step)) {
+      step = velocity_command * period_s;
+    }
+    const int64_t int64_step = StepToInt(step);
+    status->control_position_raw =
+        WrappingAdd(*status->control_position_raw, int64_step);
 
     if (data->position_relative_raw && !std::isnan(velocity)) {
-      const float tstep = velocity / rate_hz;
-      const int64_t tint64_step =
-        (static_cast<int64_t>(
-            static_cast<int32_t>((static_cast<float>(1ll << 32) * tstep))) <<
-         16);
-      data->position_relative_raw = *data->position_relative_raw + tint64_step;
+      const float tstep = velocity * period_s;
+      const int64_t tint64_step = StepToInt(tstep);
+      data->position_relative_raw =
+          WrappingAdd(*data->position_relative_raw, tint64_step);
     }
 
     if (std::isfinite(config->max_position_slip)) {
@@ -341,6 +817,7 @@ class BldcServoPosition {
       // We have hit a limit.  Assume a velocity of 0.
       velocity_command = 0.0f;
       status->control_velocity = 0.0f;
+      status->control_acceleration = 0.0f;
     }
 
     status->control_position =
@@ -14,12 +14,17 @@
 
 #pragma once
 
+#include <array>
 #include <cstdint>
+#include <limits>
 #include <optional>
 
 #include "mjlib/base/visitor.h"
 
 #include "fw/error.h"
+#include "fw/feedforward_model.h"
+#include "fw/load_observer.h"
+#include "fw/thermal_model.h"
 #include "fw/measured_hw_rev.h"
 #include "fw/pid.h"
 #include "fw/simple_pi.h"
@@ -39,6 +44,60 @@ struct Vec3 {
   }
 };
 
+// A jerk limited trajectory.  It is planned as a sequence of
+// constant jerk segments when a command is received, then advanced
+// once per control cycle.
+struct BldcServoJerkTrajectory {
+  // At most: 3 to reach the cruise velocity, 1 to cruise, and 3 to
+  // stop.
+  static constexpr int kMaxSegments = 7;
+
+  struct Segment {
+    float duration_s = 0.0f;
+    float jerk = 0.0f;
+
+    // The state at the start of the segment, relative to the frame.
+    float velocity = 0.0f;
+    float acceleration = 0.0f;
+  };
+
+  std::array<Segment, kMaxSegments> segments = {};
+  int8_t num_segments = 0;
+
+  // The trajectory is planned in a frame moving at this velocity.
+  // For position commands, this is the command velocity, so that the
+  // trajectory ends at rest relative to the moving target.
+  float frame_velocity = 0.0f;
+
+  // The velocity relative to the frame once complete.
+  float final_velocity = 0.0f;
+
+  // The index of the current segment, equal to num_segments when
+  // complete.
+  int8_t segment = 0;
+
+  // The time within the current segment at the start of the next
+  // cycle, which is start_s + cycles * period.
+  float start_s = 0.0f;
+  int32_t cycles = 0;
+  float time_s = 0.0f;
+
+  // The current state, relative to the frame.
+  float velocity = 0.0f;
+  float acceleration = 0.0f;
+
+  template <typename Archive>
+  void Serialize(Archive* a) {
+    a->Visit(MJ_NVP(num_segments));
+    a->Visit(MJ_NVP(frame_velocity));
+    a->Visit(MJ_NVP(final_velocity));
+    a->Visit(MJ_NVP(segment));
+    a->Visit(MJ_NVP(time_s));
+    a->Visit(MJ_NVP(velocity));
+    a->Visit(MJ_NVP(acceleration));
+  }
+};
+
 enum BldcServoMode {
   // In this mode, the entire motor driver will be disabled.
   //
@@ -110,6 +169,52 @@ enum BldcServoMode {
   kNumModes,
 };
 
+// Why the most recent entry into kPositionTimeout happened.
+enum class BldcServoTimeoutCause : uint8_t {
+  kNone = 0,
+
+  // The timeout_s of the most recent command expired.
+  kCommand = 1,
+
+  // More than "heartbeat_misses" consecutive heartbeat periods
+  // elapsed with neither a command nor a heartbeat.
+  kHeartbeat = 2,
+
+  kNumCauses,
+};
+
+// The state of the host watchdog, which is only tracked while in
+// kPosition or kStayWithinBounds.
+struct BldcServoWatchdog {
+  BldcServoTimeoutCause cause = BldcServoTimeoutCause::kNone;
+
+  // Free running counts of timeouts for each cause.
+  uint32_t command_timeouts = 0;
+  uint32_t heartbeat_timeouts = 0;
+
+  // A free running count of every heartbeat period that elapsed
+  // without a command or heartbeat, whether or not it resulted in a
+  // timeout.
+  uint32_t missed_heartbeats = 0;
+
+  uint16_t consecutive_misses = 0;
+  float since_heartbeat_s = 0.0f;
+
+  // The number of heartbeats which have been accounted for.
+  uint32_t heartbeat_count = 0;
+
+  template <typename Archive>
+  void Serialize(Archive* a) {
+    a->Visit(MJ_NVP(cause));
+    a->Visit(MJ_NVP(command_timeouts));
+    a->Visit(MJ_NVP(heartbeat_timeouts));
+    a->Visit(MJ_NVP(missed_heartbeats));
+    a->Visit(MJ_NVP(consecutive_misses));
+    a->Visit(MJ_NVP(since_heartbeat_s));
+    a->Visit(MJ_NVP(heartbeat_count));
+  }
+};
+
 struct BldcServoStatus {
   BldcServoMode mode = kStopped;
   errc fault = errc::kSuccess;
@@ -158,10 +263,28 @@ struct BldcServoStatus {
   std::optional<float> control_velocity;
   float position_to_set = std::numeric_limits<float>::quiet_NaN();
   float timeout_s = 0.0;
+  BldcServoWatchdog watchdog;
+
+  // A free running clock in microseconds, which the host may set so
+  // that it is shared across many controllers.
+  uint32_t shared_time_us = 0;
   bool trajectory_done = false;
 
+  // The acceleration of the control position.  This is tracked while
+  // a trajectory with an acceleration limit is active, and is
+  // otherwise 0.
+  float control_acceleration = 0.0f;
+  BldcServoJerkTrajectory jerk_trajectory;
+
   float torque_error_Nm = 0.0f;
 
+  // The torque from the configured feedforward model.
+  float feedforward_model_Nm = 0.0f;
+
+  ThermalModel::State thermal_model;
+
+  LoadObserver::State load_observer;
+
   float sin = 0.0f;
   float cos = 0.0f;
   uint16_t cooldown_count = 0;
@@ -251,9 +374,17 @@ struct BldcServoStatus {
     a->Visit(MJ_NVP(control_velocity));
     a->Visit(MJ_NVP(position_to_set));
     a->Visit(MJ_NVP(timeout_s));
+    a->Visit(MJ_NVP(watchdog));
+    a->Visit(MJ_NVP(shared_time_us));
     a->Visit(MJ_NVP(trajectory_done));
+    a->Visit(MJ_NVP(control_acceleration));
+    a->Visit(MJ_NVP(jerk_trajectory));
 
     a->Visit(MJ_NVP(torque_error_Nm));
+    a->Visit(MJ_NVP(feedforward_model_Nm));
+    a->Visit(MJ_NVP(thermal_model));
+
+    a->Visit(MJ_NVP(load_observer));
 
     a->Visit(MJ_NVP(sin));
     a->Visit(MJ_NVP(cos));
@@ -271,6 +402,101 @@ struct BldcServoStatus {
   }
 };
 
+// The subset of BldcServoStatus which is read from the main loop,
+// published by the ISR at the end of each control cycle so that
+// readers always see values from a single cycle.
+struct BldcServoStatusSnapshot {
+  // Incremented once per control cycle.
+  uint32_t cycle = 0;
+
+  BldcServoMode mode = kStopped;
+  errc fault = errc::kSuccess;
+
+  float position = 0.0f;
+  float velocity = 0.0f;
+  float torque_Nm = 0.0f;
+  float d_A = 0.0f;
+  float q_A = 0.0f;
+
+  float bus_V = 0.0f;
+  float fet_temp_C = 0.0f;
+  float motor_temp_C = 0.0f;
+
+  bool trajectory_done = false;
+  float control_position = std::numeric_limits<float>::quiet_NaN();
+  float control_velocity = std::numeric_limits<float>::quiet_NaN();
+  float control_torque_Nm = 0.0f;
+  float torque_error_Nm = 0.0f;
+  float load_torque_Nm = 0.0f;
+
+  float pid_position_p = 0.0f;
+  float pid_position_integral = 0.0f;
+  float pid_position_d = 0.0f;
+  float pid_position_error = 0.0f;
+  float pid_position_error_rate = 0.0f;
+
+  // MotorPosition::Status::Homed
+  uint8_t homed = 0;
+
+  // From MotorPosition::Status::sources, in encoder counts.
+  struct Encoder {
+    float filtered_value = 0.0f;
+    float velocity = 0.0f;
+    bool active_theta = false;
+    bool active_velocity = false;
+  };
+  std::array<Encoder, 3> encoders = { {} };
+
+  std::array<bool, 5> aux1_pins = { {} };
+  std::array<bool, 5> aux2_pins = { {} };
+  std::array<float, 5> aux1_analog_inputs = { {} };
+  std::array<float, 5> aux2_analog_inputs = { {} };
+
+  // AuxStatus::analog_sums for aux1 and aux2, captured in the same
+  // cycle as "cycle" so that averages can be formed from them.
+  std::array<uint32_t, 5> aux1_analog_sums = { {} };
+  std::array<uint32_t, 5> aux2_analog_sums = { {} };
+};
+
+// Selects which status fields the ISR accumulates statistics for.
+// Each costs some time every control cycle, so all are off by
+// default.
+struct BldcServoStatisticsConfig {
+  bool q_current = false;
+  bool torque = false;
+  bool velocity = false;
+
+  bool any() const { return q_current || torque || velocity; }
+
+  template <typename Archive>
+  void Serialize(Archive* a) {
+    a->Visit(MJ_NVP(q_current));
+    a->Visit(MJ_NVP(torque));
+    a->Visit(MJ_NVP(velocity));
+  }
+};
+
+// Running statistics of a few status fields, accumulated by the ISR
+// every control cycle over the interval between reads.
+struct BldcServoStatistics {
+  struct Field {
+    float min = std::numeric_limits<float>::infinity();
+    float max = -std::numeric_limits<float>::infinity();
+    float sum = 0.0f;
+
+    void Add(float value) {
+      if (value < min) { min = value; }
+      if (value > max) { max = value; }
+      sum += value;
+    }
+  };
+
+  uint32_t count = 0;
+  Field q_A;
+  Field torque_Nm;
+  Field velocity;
+};
+
 struct BldcServoCommandData {
   BldcServoMode mode = kStopped;
 
@@ -314,6 +540,17 @@ struct BldcServoCommandData {
   float velocity_limit = std::numeric_limits<float>::quiet_NaN();
   float accel_limit = std::numeric_limits<float>::quiet_NaN();
 
+  // Only used when accel_limit is also set.
+  float jerk_limit = std::numeric_limits<float>::quiet_NaN();
+
+  // This should not be set by callers, but is used internally.
+  bool jerk_trajectory_planned = false;
+
+  // If set, the value of BldcServoStatus::shared_time_us at which
+  // the position should be reached.  The velocity limit is then
+  // chosen anew each cycle so as to arrive at that time.
+  std::optional<uint32_t> arrival_time_us;
+
   // If not NaN, temporarily operate in fixed voltage mode.
   float fixed_voltage_override = std::numeric_limits<float>::quiet_NaN();
 
@@ -355,6 +592,9 @@ struct BldcServoCommandData {
     a->Visit(MJ_NVP(kd_scale));
     a->Visit(MJ_NVP(velocity_limit));
     a->Visit(MJ_NVP(accel_limit));
+    a->Visit(MJ_NVP(jerk_limit));
+    a->Visit(MJ_NVP(jerk_trajectory_planned));
+    a->Visit(MJ_NVP(arrival_time_us));
     a->Visit(MJ_NVP(fixed_voltage_override));
     a->Visit(MJ_NVP(timeout_s));
     a->Visit(MJ_NVP(bounds_min));
@@ -482,6 +722,20 @@ struct BldcServoConfig {
   SimplePI::Config pid_dq;
   PID::Config pid_position;
 
+  // Estimates velocity and external load torque for use in position
+  // mode.
+  LoadObserver::Config load_observer;
+
+  // Adds the torque needed to follow the control trajectory in
+  // position mode.
+  FeedforwardModel::Config feedforward_model;
+
+  // Predicts the time until temperature derating begins.
+  ThermalModel::Config thermal_model;
+
+  // Which fields are reported by the statistics registers.
+  BldcServoStatisticsConfig statistics;
+
   // Use the configured motor resistance to apply a feedforward phase
   // voltage based on the desired current.
   float current_feedforward = 1.0f;
@@ -495,6 +749,10 @@ struct BldcServoConfig {
   float default_velocity_limit = std::numeric_limits<float>::quiet_NaN();
   float default_accel_limit = std::numeric_limits<float>::quiet_NaN();
 
+  // If finite, trajectories which have an acceleration limit are
+  // also limited to this jerk, measured in revolutions / s^3.
+  float default_jerk_limit = std::numeric_limits<float>::quiet_NaN();
+
   // If true, then the currents in A that are calculated for the D
   // and Q phase are instead directly commanded as voltages on the
   // phase terminals.  This is primarily useful for high resistance
@@ -522,6 +780,21 @@ struct BldcServoConfig {
   //  15 - "brake" - all motor phases shorted to ground
   uint8_t timeout_mode = 12;
 
+  // The limits used by the "decelerate to 0 and hold position"
+  // timeout mode.  The stop is planned once upon entering the
+  // timeout, from the state at that time.  If NaN, then
+  // default_accel_limit and default_jerk_limit are used.
+  float timeout_accel_limit = std::numeric_limits<float>::quiet_NaN();
+  float timeout_jerk_limit = std::numeric_limits<float>::quiet_NaN();
+
+  // If non-zero, the host is expected to send a command or write the
+  // heartbeat register at least this often while in kPosition or
+  // kStayWithinBounds.  Once more than heartbeat_misses periods in a
+  // row are missed, the timeout mode is entered, regardless of the
+  // timeout_s of the last command.
+  float heartbeat_period_s = 0.0f;
+  uint16_t heartbeat_misses = 2;
+
   // Similar to 'max_voltage', the flux braking default voltage is
   // board rev dependent.
   float flux_brake_min_voltage =
@@ -585,10 +858,15 @@ struct BldcServoConfig {
     a->Visit(MJ_NVP(adc_aux_cycles));
     a->Visit(MJ_NVP(pid_dq));
     a->Visit(MJ_NVP(pid_position));
+    a->Visit(MJ_NVP(load_observer));
+    a->Visit(MJ_NVP(feedforward_model));
+    a->Visit(MJ_NVP(thermal_model));
+    a->Visit(MJ_NVP(statistics));
     a->Visit(MJ_NVP(current_feedforward));
     a->Visit(MJ_NVP(bemf_feedforward));
     a->Visit(MJ_NVP(default_velocity_limit));
     a->Visit(MJ_NVP(default_accel_limit));
+    a->Visit(MJ_NVP(default_jerk_limit));
     a->Visit(MJ_NVP(voltage_mode_control));
     a->Visit(MJ_NVP(fixed_voltage_mode));
     a->Visit(MJ_NVP(fixed_voltage_control_V));
@@ -596,6 +874,10 @@ struct BldcServoConfig {
     a->Visit(MJ_NVP(default_timeout_s));
     a->Visit(MJ_NVP(timeout_max_torque_Nm));
     a->Visit(MJ_NVP(timeout_mode));
+    a->Visit(MJ_NVP(timeout_accel_limit));
+    a->Visit(MJ_NVP(timeout_jerk_limit));
+    a->Visit(MJ_NVP(heartbeat_period_s));
+    a->Visit(MJ_NVP(heartbeat_misses));
     a->Visit(MJ_NVP(flux_brake_min_voltage));
     a->Visit(MJ_NVP(flux_brake_resistance_ohm));
     a->Visit(MJ_NVP(max_current_A));
@@ -659,5 +941,20 @@ struct IsEnum<moteus::BldcServoMode> {
   }
 };
 
+template <>
+struct IsEnum<moteus::BldcServoTimeoutCause> {
+  static constexpr bool value = true;
+
+  using C = moteus::BldcServoTimeoutCause;
+  static std::array<std::pair<C, const char*>,
+                    static_cast<int>(C::kNumCauses)> map() {
+    return { {
+        { C::kNone, "none" },
+        { C::kCommand, "command" },
+        { C::kHeartbeat, "heartbeat" },
+      }};
+  }
+};
+
 }
 }
@@ -89,6 +89,10 @@ bool ParseOptions(BldcServo::CommandData* command, base::Tokenizer* tokenizer,
         command->fixed_voltage_override = value;
         break;
       }
+      case 'j': {
+        command->jerk_limit = value;
+        break;
+      }
       default: {
         return false;
       }
@@ -558,7 +562,7 @@ class BoardDebug::Impl {
       // We default to no timeout for debug commands.
       command.timeout_s = std::numeric_limits<float>::quiet_NaN();
 
-      if (!ParseOptions(&command, &tokenizer, "pdsftavo")) {
+      if (!ParseOptions(&command, &tokenizer, "pdsftavoj")) {
         WriteMessage(response, "ERR unknown option\r\n");
         return;
       }
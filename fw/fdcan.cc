@@ -14,6 +14,8 @@
 
 #include "fw/fdcan.h"
 
+#include <cstring>
+
 #include "PeripheralPins.h"
 
 extern const PinMap PinMap_CAN_TD[];
@@ -88,8 +90,21 @@ FDCan::Rate ApplyRateOverride(FDCan::Rate base, FDCan::Rate overlay) {
   }
   return base;
 }
+
+IRQn_Type FindReceiveIrq(FDCAN_GlobalTypeDef* can) {
+  if (can == FDCAN1) { return FDCAN1_IT0_IRQn; }
+#if defined(FDCAN2)
+  if (can == FDCAN2) { return FDCAN2_IT0_IRQn; }
+#endif
+#if defined(FDCAN3)
+  if (can == FDCAN3) { return FDCAN3_IT0_IRQn; }
+#endif
+  mbed_die();
+}
 }
 
+FDCan* FDCan::g_receive_instance_ = nullptr;
+
 FDCan::FDCan(const Options& options)
     : options_(options) {
   Init();
@@ -115,6 +130,14 @@ void FDCan::Init() {
   pinmap_pinout(options.td, PinMap_CAN_TD);
   pinmap_pinout(options.rd, PinMap_CAN_RD);
 
+  rx_irq_ = FindReceiveIrq(can_);
+
+  // We may be re-initialized to change filters, so make sure the
+  // receive interrupt can't observe the peripheral in the middle of
+  // that, and discard anything queued under the old filters.
+  NVIC_DisableIRQ(rx_irq_);
+  rx_tail_.store(rx_head_.load());
+
   auto& can = hfdcan1_;
 
   can.Instance = can_;
@@ -285,6 +308,22 @@ void FDCan::Init() {
     }
   }
 
+  // Frames read straight from the hardware FIFO by Poll use the
+  // receive timestamp, which counts nominal bit times, to find when
+  // they arrived.
+  if (HAL_FDCAN_ConfigTimestampCounter(
+          &can, FDCAN_TIMESTAMP_PRESC_1) != HAL_OK) {
+    mbed_die();
+  }
+  if (HAL_FDCAN_EnableTimestampCounter(
+          &can, FDCAN_TIMESTAMP_INTERNAL) != HAL_OK) {
+    mbed_die();
+  }
+  timestamp_cycles_ = static_cast<uint32_t>(
+      static_cast<uint64_t>(nominal.prescaler) *
+      (1 + nominal.time_seg1 + nominal.time_seg2) *
+      SystemCoreClock / config_.clock);
+
   if (HAL_FDCAN_Start(&can) != HAL_OK) {
     mbed_die();
   }
@@ -293,6 +332,44 @@ void FDCan::Init() {
           &can, FDCAN_IT_RX_FIFO0_NEW_MESSAGE, 0) != HAL_OK) {
     mbed_die();
   }
+
+  if (options.receive_interrupt) {
+    g_receive_instance_ = this;
+    NVIC_SetVector(
+        rx_irq_, reinterpret_cast<uint32_t>(&FDCan::GlobalReceiveInterrupt));
+    // Below the control loop and the soft-GPIO interrupts, but above
+    // everything which runs from the main loop.
+    HAL_NVIC_SetPriority(rx_irq_, 4, 0);
+    NVIC_EnableIRQ(rx_irq_);
+  }
+}
+
+void FDCan::GlobalReceiveInterrupt() {
+  g_receive_instance_->ISR_Receive();
+}
+
+void FDCan::ISR_Receive() {
+  // Clear the flag first, so that anything which arrives while we
+  // are draining the FIFO will trigger us again.
+  __HAL_FDCAN_CLEAR_FLAG(&hfdcan1_, FDCAN_FLAG_RX_FIFO0_NEW_MESSAGE);
+
+  while (HAL_FDCAN_GetRxFifoFillLevel(&hfdcan1_, FDCAN_RX_FIFO0) > 0) {
+    const uint32_t head = rx_head_.load(std::memory_order_relaxed);
+    const uint32_t tail = rx_tail_.load(std::memory_order_acquire);
+    if (head - tail >= kRxQueueSize) {
+      // Our queue is full.  Anything left stays in the hardware FIFO
+      // and will be read directly by Poll once the queue is empty.
+      return;
+    }
+
+    auto& frame = rx_queue_[head % kRxQueueSize];
+    frame.cycles = DWT->CYCCNT;
+    if (HAL_FDCAN_GetRxMessage(
+            &hfdcan1_, FDCAN_RX_FIFO0, &frame.header, frame.data) != HAL_OK) {
+      return;
+    }
+    rx_head_.store(head + 1, std::memory_order_release);
+  }
 }
 
 namespace {
@@ -348,14 +425,42 @@ void FDCan::Send(uint32_t dest_id,
 }
 
 bool FDCan::Poll(FDCAN_RxHeaderTypeDef* header,
-                 mjlib::base::string_span data) {
-  if (HAL_FDCAN_GetRxMessage(
-          &hfdcan1_, FDCAN_RX_FIFO0, header,
-          reinterpret_cast<uint8_t*>(data.data())) != HAL_OK) {
+                 mjlib::base::string_span data,
+                 uint32_t* cycles) {
+  const uint32_t tail = rx_tail_.load(std::memory_order_relaxed);
+  if (tail != rx_head_.load(std::memory_order_acquire)) {
+    const auto& frame = rx_queue_[tail % kRxQueueSize];
+    *header = frame.header;
+    std::memcpy(data.data(), frame.data, ParseDlc(frame.header.DataLength));
+    if (cycles) { *cycles = frame.cycles; }
+    rx_tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Our queue is empty, but the hardware FIFO may still hold frames
+  // if the queue was full when they arrived.
+  if (HAL_FDCAN_GetRxFifoFillLevel(&hfdcan1_, FDCAN_RX_FIFO0) == 0) {
     return false;
   }
 
-  return true;
+  if (options_.receive_interrupt) { NVIC_DisableIRQ(rx_irq_); }
+  const bool result =
+      HAL_FDCAN_GetRxMessage(
+          &hfdcan1_, FDCAN_RX_FIFO0, header,
+          reinterpret_cast<uint8_t*>(data.data())) == HAL_OK;
+  if (options_.receive_interrupt) { NVIC_EnableIRQ(rx_irq_); }
+
+  if (result && cycles) {
+    // The frame may have waited in the FIFO for some time, so work
+    // back from its receive timestamp.  That wraps after 65536 bit
+    // times, which is much longer than the queue is ever full for.
+    const uint32_t now = DWT->CYCCNT;
+    const uint16_t age = static_cast<uint16_t>(
+        HAL_FDCAN_GetTimestampCounter(&hfdcan1_) - header->RxTimestamp);
+    *cycles = now - age * timestamp_cycles_;
+  }
+
+  return result;
 }
 
 void FDCan::RecoverBusOff() {
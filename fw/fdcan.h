@@ -14,6 +14,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <string_view>
 
 #include "mbed.h"
@@ -82,6 +83,11 @@ class FDCan {
     bool restricted_mode = false;
     bool bus_monitor = false;
 
+    // If true, received frames are moved from the hardware FIFO into
+    // a software queue from the receive interrupt, and timestamped
+    // with the DWT cycle counter on arrival.
+    bool receive_interrupt = false;
+
     bool delay_compensation = false;
     uint32_t tdc_offset = 0;
     uint32_t tdc_filter = 0;
@@ -117,8 +123,13 @@ class FDCan {
             std::string_view data,
             const SendOptions& = SendOptions());
 
+  /// @param cycles if non-null, is set to the DWT cycle count when
+  /// the frame was received.  For frames read directly from the
+  /// hardware FIFO, this is derived from the receive timestamp.
+  ///
   /// @return true if a packet was available.
-  bool Poll(FDCAN_RxHeaderTypeDef* header, mjlib::base::string_span);
+  bool Poll(FDCAN_RxHeaderTypeDef* header, mjlib::base::string_span,
+            uint32_t* cycles = nullptr);
 
   void RecoverBusOff();
 
@@ -136,6 +147,16 @@ class FDCan {
 
  private:
   void Init();
+  void ISR_Receive();
+  static void GlobalReceiveInterrupt();
+
+  static constexpr uint32_t kRxQueueSize = 8;
+
+  struct RxFrame {
+    FDCAN_RxHeaderTypeDef header = {};
+    uint32_t cycles = 0;
+    uint8_t data[64] = {};
+  };
 
   Options options_;
   Config config_;
@@ -144,6 +165,15 @@ class FDCan {
   FDCAN_HandleTypeDef hfdcan1_;
   FDCAN_ProtocolStatusTypeDef status_result_ = {};
   uint32_t last_tx_request_ = 0;
+  // CPU cycles per tick of the receive timestamp counter.
+  uint32_t timestamp_cycles_ = 0;
+
+  IRQn_Type rx_irq_ = {};
+  RxFrame rx_queue_[kRxQueueSize] = {};
+  std::atomic<uint32_t> rx_head_{0};
+  std::atomic<uint32_t> rx_tail_{0};
+
+  static FDCan* g_receive_instance_;
 };
 
 }
@@ -14,6 +14,8 @@
 
 #pragma once
 
+#include <array>
+
 #include "mjlib/multiplex/micro_datagram_server.h"
 
 #include "fw/fdcan.h"
@@ -26,10 +28,67 @@ class FDCanMicroServer : public mjlib::multiplex::MicroDatagramServer {
   static constexpr uint32_t kBrsFlag = 0x01;
   static constexpr uint32_t kFdcanFlag = 0x02;
 
+  static constexpr uint8_t kBroadcastId = 0x7f;
+  static constexpr size_t kMaxGroups = 4;
+
+  struct FilterConfig {
+    uint32_t prefix = 0;
+    uint8_t id = 1;
+
+    // Additional destination IDs which are accepted as if they were
+    // addressed to this device.  Entries of 0 are unused.
+    std::array<uint8_t, kMaxGroups> groups = {};
+
+    bool operator==(const FilterConfig& rhs) const {
+      return prefix == rhs.prefix &&
+          id == rhs.id &&
+          groups == rhs.groups;
+    }
+  };
+
   FDCanMicroServer(FDCan* can) : fdcan_(can) {}
 
-  void SetPrefix(uint32_t can_prefix) {
-    can_prefix_ = can_prefix;
+  /// Program the hardware acceptance filters so that only frames
+  /// with the configured prefix and one of our destination IDs are
+  /// ever placed in the receive FIFO.
+  void ConfigureFilters(const FilterConfig& config) {
+    filter_config_ = config;
+    can_prefix_ = config.prefix;
+
+    destinations_[0] = config.id;
+    destinations_[1] = kBroadcastId;
+    destination_count_ = 2;
+    for (const auto group : config.groups) {
+      if (group == 0 || IsDestination(group)) { continue; }
+      destinations_[destination_count_++] = group;
+    }
+
+    size_t filter_count = 0;
+    for (size_t i = 0; i < destination_count_; i++) {
+      auto& filter = filters_[filter_count++];
+      filter.id1 = (config.prefix << 16) | destinations_[i];
+      filter.id2 = 0x1fff00ffu;
+      filter.mode = FDCan::FilterMode::kMask;
+      filter.action = FDCan::FilterAction::kAccept;
+      filter.type = FDCan::FilterType::kExtended;
+
+      // Standard frames can only be used with a prefix of 0.
+      if (config.prefix == 0) {
+        auto& std_filter = filters_[filter_count++];
+        std_filter.id1 = destinations_[i];
+        std_filter.id2 = 0x0ffu;
+        std_filter.mode = FDCan::FilterMode::kMask;
+        std_filter.action = FDCan::FilterAction::kAccept;
+        std_filter.type = FDCan::FilterType::kStandard;
+      }
+    }
+
+    FDCan::FilterConfig fdcan_config;
+    fdcan_config.begin = filters_.data();
+    fdcan_config.end = filters_.data() + filter_count;
+    fdcan_config.global_std_action = FDCan::FilterAction::kReject;
+    fdcan_config.global_ext_action = FDCan::FilterAction::kReject;
+    fdcan_->ConfigureFilters(fdcan_config);
   }
 
   void AsyncRead(Header* header,
@@ -87,7 +146,9 @@ class FDCanMicroServer : public mjlib::multiplex::MicroDatagramServer {
       can_reset_count_++;
     }
 
-    const bool got_data = fdcan_->Poll(&fdcan_header_, current_read_data_);
+    uint32_t rx_cycles = 0;
+    const bool got_data =
+        fdcan_->Poll(&fdcan_header_, current_read_data_, &rx_cycles);
     if (!got_data) { return; }
 
     // We could check the prefix here as below:
@@ -97,9 +158,23 @@ class FDCanMicroServer : public mjlib::multiplex::MicroDatagramServer {
     //
     // However, we should be excluding prefix based on the hardware
     // CAN filter, and having the check here would mask if the filter
-    // wasn't working.
+    // wasn't working.  The destination is checked only so that a
+    // misconfigured filter shows up in the foreign count.
+    uint8_t destination = fdcan_header_.Identifier & 0xff;
+    if (destination_count_ && !IsDestination(destination)) {
+      rx_foreign_count_++;
+      return;
+    }
+    rx_count_++;
+    last_rx_cycles_ = rx_cycles;
+
+    // Group IDs are presented to the multiplex server as if they were
+    // addressed to us directly.
+    if (destination != kBroadcastId) {
+      destination = filter_config_.id;
+    }
 
-    current_read_header_->destination = fdcan_header_.Identifier & 0xff;
+    current_read_header_->destination = destination;
     current_read_header_->source = (fdcan_header_.Identifier >> 8) & 0xff;
     current_read_header_->size = FDCan::ParseDlc(fdcan_header_.DataLength);
     current_read_header_->flags = 0
@@ -139,7 +214,27 @@ class FDCanMicroServer : public mjlib::multiplex::MicroDatagramServer {
 
   uint32_t can_reset_count() const { return can_reset_count_; }
 
+  /// Frames which passed the hardware filter and were handed to the
+  /// multiplex server.
+  uint32_t rx_count() const { return rx_count_; }
+
+  /// Frames which passed the hardware filter but were not addressed
+  /// to us.  This should always be zero.
+  uint32_t rx_foreign_count() const { return rx_foreign_count_; }
+
+  /// The DWT cycle count when the most recently processed frame was
+  /// received.
+  uint32_t last_rx_cycles() const { return last_rx_cycles_; }
+
  private:
+  bool IsDestination(uint8_t destination) const {
+    for (size_t i = 0; i < destination_count_; i++) {
+      if (destinations_[i] == destination) { return true; }
+    }
+    return false;
+  }
+
+
   FDCan* const fdcan_;
 
   mjlib::micro::SizeCallback current_read_callback_;
@@ -150,6 +245,14 @@ class FDCanMicroServer : public mjlib::multiplex::MicroDatagramServer {
   char buf_[64] = {};
   uint32_t can_prefix_ = 0;
   uint32_t can_reset_count_ = 0;
+  uint32_t rx_count_ = 0;
+  uint32_t rx_foreign_count_ = 0;
+  uint32_t last_rx_cycles_ = 0;
+
+  FilterConfig filter_config_;
+  std::array<uint8_t, kMaxGroups + 2> destinations_ = {};
+  size_t destination_count_ = 0;
+  std::array<FDCan::Filter, 2 * (kMaxGroups + 2)> filters_ = {};
 };
 
 }
@@ -0,0 +1,79 @@
+// Copyright 2023 mjbots Robotic Systems, LLC.  info@mjbots.com
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+
+#include "mjlib/base/visitor.h"
+
+#include "fw/ccm.h"
+#include "fw/math.h"
+
+namespace moteus {
+
+/// A per-joint dynamics model which gives the torque needed to
+/// follow the control trajectory:
+///
+///   torque = inertia * acceleration +
+///            coulomb_Nm * sign(velocity) +
+///            viscous * velocity
+///
+/// The sign is smoothed linearly over +-coulomb_velocity so that the
+/// feedforward does not chatter when holding position.
+class FeedforwardModel {
+ public:
+  struct Config {
+    // The inertia of the rotor and load referred to the output, in
+    // kg * m^2.
+    float inertia = 0.0f;
+
+    // The Coulomb (constant) friction, in Nm.
+    float coulomb_Nm = 0.0f;
+
+    // The velocity, in revolutions per second, at which the full
+    // Coulomb friction is applied.
+    float coulomb_velocity = 0.01f;
+
+    // The viscous friction, in Nm per revolution per second.
+    float viscous = 0.0f;
+
+    template <typename Archive>
+    void Serialize(Archive* a) {
+      a->Visit(MJ_NVP(inertia));
+      a->Visit(MJ_NVP(coulomb_Nm));
+      a->Visit(MJ_NVP(coulomb_velocity));
+      a->Visit(MJ_NVP(viscous));
+    }
+  };
+
+  /// @param velocity in revolutions per second
+  /// @param acceleration in revolutions per second squared
+  static float Calculate(const Config& config,
+                         float velocity,
+                         float acceleration) MOTEUS_CCM_ATTRIBUTE {
+    const float coulomb_sign =
+        (config.coulomb_velocity > 0.0f) ?
+        std::max(-1.0f, std::min(1.0f, velocity / config.coulomb_velocity)) :
+        ((velocity > 0.0f) ? 1.0f : ((velocity < 0.0f) ? -1.0f : 0.0f));
+
+    // The model is evaluated in revolutions, so convert the inertia
+    // to Nm per rev/s^2.
+    return config.inertia * k2Pi * acceleration +
+        config.coulomb_Nm * coulomb_sign +
+        config.viscous * velocity;
+  }
+};
+
+}
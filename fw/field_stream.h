@@ -0,0 +1,227 @@
+// Copyright 2023 mjbots Robotic Systems, LLC.  info@mjbots.com
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+#include "mjlib/base/string_span.h"
+
+namespace moteus {
+
+/// Emits a subset of the fields of some structures, each at its own
+/// rate, in a packed binary form.  The cost of each emission is
+/// proportional to the number of fields which are due, not to the
+/// size of the structures.
+///
+/// Each record is:
+///
+///  - uint32 => millisecond timestamp
+///  - uint16 => bitmask of the subscriptions present, in the order
+///              they were subscribed
+///  - N x value => each present field in its native type
+class FieldStream {
+ public:
+  enum Type : uint8_t {
+    kInt8,
+    kUint8,
+    kInt16,
+    kUint16,
+    kInt32,
+    kUint32,
+    kFloat,
+  };
+
+  struct Field {
+    const char* name;
+    Type type;
+    const void* data;
+  };
+
+  /// The Type used to emit a value of type T.
+  template <typename T>
+  static constexpr Type TypeOf() {
+    if constexpr (std::is_enum_v<T>) {
+      return TypeOf<std::underlying_type_t<T>>();
+    } else if constexpr (std::is_same_v<T, float>) {
+      return kFloat;
+    } else {
+      static_assert(std::is_integral_v<T> && sizeof(T) <= 4);
+      if constexpr (sizeof(T) == 1) {
+        return std::is_signed_v<T> ? kInt8 : kUint8;
+      } else if constexpr (sizeof(T) == 2) {
+        return std::is_signed_v<T> ? kInt16 : kUint16;
+      } else {
+        return std::is_signed_v<T> ? kInt32 : kUint32;
+      }
+    }
+  }
+
+  template <typename T>
+  static constexpr Field MakeField(const char* name, const T* data) {
+    return { name, TypeOf<T>(), data };
+  }
+
+  static constexpr size_t kMaxSubscriptions = 16;
+  static constexpr size_t kHeaderSize = 6;
+  static constexpr size_t kMaxRecordSize =
+      kHeaderSize + kMaxSubscriptions * 4;
+
+  struct Subscription {
+    const Field* field = nullptr;
+    uint16_t period_ms = 0;
+    uint32_t last_ms = 0;
+  };
+
+  FieldStream(const Field* fields, size_t fields_size)
+      : fields_(fields), fields_size_(fields_size) {}
+
+  static const char* TypeName(Type type) {
+    switch (type) {
+      case kInt8: { return "i8"; }
+      case kUint8: { return "u8"; }
+      case kInt16: { return "i16"; }
+      case kUint16: { return "u16"; }
+      case kInt32: { return "i32"; }
+      case kUint32: { return "u32"; }
+      case kFloat: { return "f32"; }
+    }
+    return "";
+  }
+
+  static size_t TypeSize(Type type) {
+    switch (type) {
+      case kInt8:
+      case kUint8: {
+        return 1;
+      }
+      case kInt16:
+      case kUint16: {
+        return 2;
+      }
+      case kInt32:
+      case kUint32:
+      case kFloat: {
+        return 4;
+      }
+    }
+    return 0;
+  }
+
+  const Field* Find(const std::string_view& name) const {
+    for (size_t i = 0; i < fields_size_; i++) {
+      if (name == fields_[i].name) { return &fields_[i]; }
+    }
+    return nullptr;
+  }
+
+  /// Emit @p name every @p period_ms.  Re-subscribing to a field
+  /// just changes its period, and a period of 0 unsubscribes.
+  /// Returns false if the field is unknown or there are too many
+  /// subscriptions.
+  bool Subscribe(const std::string_view& name, uint16_t period_ms) {
+    const Field* const field = Find(name);
+    if (!field) { return false; }
+
+    for (size_t i = 0; i < size_; i++) {
+      if (subscriptions_[i].field != field) { continue; }
+
+      if (period_ms == 0) {
+        for (size_t j = i + 1; j < size_; j++) {
+          subscriptions_[j - 1] = subscriptions_[j];
+        }
+        size_--;
+      } else {
+        subscriptions_[i].period_ms = period_ms;
+      }
+      return true;
+    }
+
+    if (period_ms == 0) { return true; }
+    if (size_ >= kMaxSubscriptions) { return false; }
+
+    auto& subscription = subscriptions_[size_++];
+    subscription.field = field;
+    subscription.period_ms = period_ms;
+    // Emit on the next poll.
+    subscription.last_ms = now_ms_ - period_ms;
+    return true;
+  }
+
+  void Clear() { size_ = 0; }
+
+  size_t size() const { return size_; }
+  const Subscription& subscription(size_t index) const {
+    return subscriptions_[index];
+  }
+
+  /// Write a record with all the fields that are due as of @p now_ms
+  /// into @p output, which must hold at least kMaxRecordSize bytes.
+  /// Returns the size of the record, or 0 if nothing was due.
+  size_t Poll(uint32_t now_ms, mjlib::base::string_span output) {
+    const uint16_t mask = Schedule(now_ms);
+    if (mask == 0) { return 0; }
+    return Write(now_ms, mask, output);
+  }
+
+  /// Mark every subscription due as of @p now_ms as emitted, and
+  /// return the mask of them to pass to Write.
+  uint16_t Schedule(uint32_t now_ms) {
+    now_ms_ = now_ms;
+
+    uint16_t mask = 0;
+    for (size_t i = 0; i < size_; i++) {
+      auto& subscription = subscriptions_[i];
+      if ((now_ms - subscription.last_ms) < subscription.period_ms) {
+        continue;
+      }
+      subscription.last_ms = now_ms;
+      mask |= (1 << i);
+    }
+    return mask;
+  }
+
+  /// Write a record of the subscriptions in @p mask, copied from
+  /// their fields now.  This has no side effects, so it can be
+  /// repeated if the fields changed while being copied.
+  size_t Write(uint32_t now_ms, uint16_t mask,
+               mjlib::base::string_span output) const {
+    size_t pos = kHeaderSize;
+    for (size_t i = 0; i < size_; i++) {
+      if ((mask & (1 << i)) == 0) { continue; }
+
+      const auto* const field = subscriptions_[i].field;
+      const auto size = TypeSize(field->type);
+      std::memcpy(output.data() + pos, field->data, size);
+      pos += size;
+    }
+
+    std::memcpy(output.data(), &now_ms, sizeof(now_ms));
+    std::memcpy(output.data() + 4, &mask, sizeof(mask));
+    return pos;
+  }
+
+ private:
+  const Field* const fields_;
+  const size_t fields_size_;
+
+  Subscription subscriptions_[kMaxSubscriptions] = {};
+  size_t size_ = 0;
+  uint32_t now_ms_ = 0;
+};
+
+}
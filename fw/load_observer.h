@@ -0,0 +1,143 @@
+// Copyright 2023 mjbots Robotic Systems, LLC.  info@mjbots.com
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "mjlib/base/visitor.h"
+
+#include "fw/ccm.h"
+#include "fw/math.h"
+
+namespace moteus {
+
+/// A Luenberger observer which estimates velocity and external load
+/// torque from the measured position and the torque applied by the
+/// motor, using a rigid body model:
+///
+///   inertia * acceleration = torque - load
+///
+/// The load is assumed to be constant between updates.  All three
+/// observer poles are placed at -2 * pi * bandwidth_hz.
+class LoadObserver {
+ public:
+  struct Config {
+    // If 0, the observer is disabled.
+    float bandwidth_hz = 0.0f;
+
+    // The inertia of the rotor and load referred to the output, in
+    // kg * m^2.
+    float inertia = 0.0f;
+
+    // The fraction of the estimated load torque which is added to the
+    // torque command in position mode.
+    float feedforward = 0.0f;
+
+    // If true, the observer velocity is used in place of the encoder
+    // velocity for the position mode derivative term.
+    bool use_velocity = false;
+
+    template <typename Archive>
+    void Serialize(Archive* a) {
+      a->Visit(MJ_NVP(bandwidth_hz));
+      a->Visit(MJ_NVP(inertia));
+      a->Visit(MJ_NVP(feedforward));
+      a->Visit(MJ_NVP(use_velocity));
+    }
+  };
+
+  struct State {
+    bool active = false;
+
+    // The estimated position minus the measured position, in
+    // revolutions.
+    float position_error = 0.0f;
+
+    // Revolutions per second.
+    float velocity = 0.0f;
+
+    float load_Nm = 0.0f;
+
+    template <typename Archive>
+    void Serialize(Archive* a) {
+      a->Visit(MJ_NVP(active));
+      a->Visit(MJ_NVP(position_error));
+      a->Visit(MJ_NVP(velocity));
+      a->Visit(MJ_NVP(load_Nm));
+    }
+  };
+
+  LoadObserver(const Config* config, State* state)
+      : config_(config), state_(state) {}
+
+  /// Recalculate the gains, which must be done whenever the config
+  /// or the update period changes.
+  void UpdateConfig(float period_s) {
+    enabled_ = config_->bandwidth_hz > 0.0f && config_->inertia > 0.0f;
+    state_->active = false;
+
+    if (!enabled_) { return; }
+
+    // The model is evaluated in revolutions, so convert the inertia
+    // to Nm per rev/s^2.
+    const float inertia = config_->inertia * k2Pi;
+    const float w = config_->bandwidth_hz * k2Pi;
+
+    period_s_ = period_s;
+    torque_scale_ = period_s / inertia;
+
+    // These place all poles of the error dynamics at -w.
+    k_position_ = 3.0f * w * period_s;
+    k_velocity_ = 3.0f * w * w * period_s;
+    k_load_ = inertia * w * w * w * period_s;
+  }
+
+  bool enabled() const { return enabled_; }
+
+  /// Start estimating from the given velocity with no load.
+  void Reset(float velocity) MOTEUS_CCM_ATTRIBUTE {
+    state_->active = true;
+    state_->position_error = 0.0f;
+    state_->velocity = velocity;
+    state_->load_Nm = 0.0f;
+  }
+
+  /// @param position_delta the change in measured position since the
+  /// last update, in revolutions
+  /// @param torque_Nm the torque applied by the motor over the last
+  /// period
+  void Update(float position_delta, float torque_Nm) MOTEUS_CCM_ATTRIBUTE {
+    const float error =
+        state_->position_error + period_s_ * state_->velocity -
+        position_delta;
+
+    state_->velocity +=
+        torque_scale_ * (torque_Nm - state_->load_Nm) -
+        k_velocity_ * error;
+    state_->load_Nm += k_load_ * error;
+    state_->position_error = error - k_position_ * error;
+  }
+
+ private:
+  const Config* const config_;
+  State* const state_;
+
+  bool enabled_ = false;
+  float period_s_ = 0.0f;
+  float torque_scale_ = 0.0f;
+  float k_position_ = 0.0f;
+  float k_velocity_ = 0.0f;
+  float k_load_ = 0.0f;
+};
+
+}
@@ -0,0 +1,353 @@
+#!/usr/bin/python3
+
+# Copyright 2023 mjbots Robotic Systems, LLC.  info@mjbots.com
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+'''Report flash, RAM, and CCM usage of a linked firmware image.
+
+Usage is broken down by output section and by the largest symbols in
+each memory region.  The exit status is non-zero if any region
+exceeds its budget, so that this can be used to fail a build.
+
+Control ISR code and data are also checked to be in CCM, RAM, or
+flash bank 1.  The persistent configuration is stored in bank 2, and
+while it is being written, anything fetched from bank 2 stalls.  The
+check covers every function reachable by direct calls from the ISR
+entry points, and any flash addresses in their literal pools, such as
+constant tables.  Calls through function pointers cannot be followed.
+'''
+
+import argparse
+import platform
+import re
+import subprocess
+import sys
+
+
+BINPREFIX = '' if platform.machine().startswith('arm') else 'arm-none-eabi-'
+
+
+class Region:
+    def __init__(self, name, start, size):
+        self.name = name
+        self.start = start
+        self.size = size
+        self.used = 0
+        self.sections = []
+        self.symbols = []
+
+    def contains(self, address):
+        return self.start <= address < self.start + self.size
+
+
+def _make_regions():
+    # These match the STM32G474 and the layout in stm32g474.ld.  The
+    # application image starts at 0x8010000 and ends where the
+    # persistent settings begin.
+    return [
+        Region('flash', 0x08010000, 0x0807f000 - 0x08010000),
+        Region('ram', 0x20000000, 96 * 1024),
+        Region('ccm', 0x10000000, 32 * 1024),
+    ]
+
+
+# The STM32G474 is used in dual bank mode, and bank 2 starts here.
+FLASH_BANK2_START = 0x08040000
+
+# The entry points of the control interrupt.
+ISR_PATTERNS = ['::ISR_', 'GlobalInterrupt', 'GlobalPendSv']
+
+
+def is_isr_symbol(name):
+    return (name.startswith('ISR_') or
+            any(x in name for x in ISR_PATTERNS))
+
+
+_FUNCTION_RE = re.compile(r'^([0-9a-f]+) <(.*)>:$')
+_BRANCH_RE = re.compile(
+    r'^\s*[0-9a-f]+:\s.*\s(bl|blx|b[a-z]{0,2}(\.[nw])?|call|jmp)\s+' +
+    r'([0-9a-f]+) <(.*)>$')
+_WORD_RE = re.compile(r'^\s*[0-9a-f]+:\s.*\s\.word\s+0x([0-9a-f]+)')
+
+
+class Function:
+    def __init__(self, address, name):
+        self.address = address
+        self.name = name
+        self.callees = set()
+        self.words = []
+
+
+def read_functions(objdump, elffile):
+    '''Parse the output of "objdump -d -C", returning a dictionary of
+    Function by name, with the functions each calls directly and the
+    literal words each contains.'''
+    output = subprocess.check_output(
+        [objdump, '-d', '-C', elffile]).decode('latin1')
+
+    result = {}
+    current = None
+    for line in output.splitlines():
+        match = _FUNCTION_RE.match(line)
+        if match:
+            current = Function(int(match.group(1), 16), match.group(2))
+            result[current.name] = current
+            continue
+        if current is None:
+            continue
+
+        match = _BRANCH_RE.match(line)
+        if match:
+            # Branches within a function show as an offset from it.
+            target = re.sub(r'\+0x[0-9a-f]+$', '', match.group(4))
+            if target != current.name:
+                current.callees.add(target)
+            continue
+
+        match = _WORD_RE.match(line)
+        if match:
+            current.words.append(int(match.group(1), 16))
+    return result
+
+
+def isr_reachable(functions):
+    '''Return the names of every function reachable from an ISR entry
+    point through direct calls.'''
+    pending = [x for x in functions if is_isr_symbol(x)]
+    result = set(pending)
+    while pending:
+        function = functions.get(pending.pop())
+        if function is None:
+            continue
+        for callee in function.callees:
+            if callee not in result:
+                result.add(callee)
+                pending.append(callee)
+    return result
+
+
+# These are placeholders emitted by the mbed linker script to reserve
+# whatever RAM remains after everything else is placed.  They are
+# reported, but not counted against the budget.
+RESERVED_SECTIONS = ['.heap', '.stack_dummy', '._user_heap_stack']
+
+
+class Section:
+    def __init__(self, name, size, vma, lma, flags):
+        self.name = name
+        self.size = size
+        self.vma = vma
+        self.lma = lma
+        self.flags = flags
+
+
+def read_sections(objdump, elffile):
+    '''Parse the output of "objdump -h".'''
+    output = subprocess.check_output(
+        [objdump, '-h', elffile]).decode('latin1')
+
+    result = []
+    lines = output.splitlines()
+    for i, line in enumerate(lines):
+        fields = line.split()
+        if len(fields) < 7 or not fields[0].isdigit():
+            continue
+        flags = (lines[i + 1] if i + 1 < len(lines) else '').replace(',', ' ')
+        result.append(Section(
+            name=fields[1],
+            size=int(fields[2], 16),
+            vma=int(fields[3], 16),
+            lma=int(fields[4], 16),
+            flags=flags.split()))
+    return result
+
+
+def read_symbols(nm, elffile):
+    '''Parse the output of "nm -S -C", returning (address, size, name).'''
+    output = subprocess.check_output(
+        [nm, '-S', '-C', '--size-sort', elffile]).decode('latin1')
+
+    result = []
+    for line in output.splitlines():
+        fields = line.split(None, 3)
+        if len(fields) < 4:
+            continue
+        result.append((int(fields[0], 16), int(fields[1], 16), fields[3]))
+    return result
+
+
+def _find_region(regions, address):
+    for region in regions:
+        if region.contains(address):
+            return region
+    return None
+
+
+def _format_size(value):
+    return f'{value:7d} ({value / 1024:6.1f}k)'
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__,
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument(
+        'elffile', nargs='?',
+        default='bazel-out/stm32g4-opt/bin/fw/moteus.elf')
+    parser.add_argument('--objdump', default=BINPREFIX + 'objdump')
+    parser.add_argument('--nm', default=BINPREFIX + 'nm')
+    parser.add_argument('--output', '-o', type=str, default=None,
+                        help='also write the report to this file')
+    parser.add_argument('--symbols', type=int, default=15,
+                        help='number of symbols to list for each region')
+    parser.add_argument('--budget', type=str, action='append', default=[],
+                        metavar='REGION=BYTES',
+                        help='fail if REGION uses more than BYTES, ' +
+                        'defaults to the region capacity')
+    parser.add_argument('--pool-size', type=int, default=20000,
+                        help='size of the SizedPool in moteus.cc')
+    parser.add_argument('--pool-available', type=int, default=None,
+                        help='system_info.pool_available as read from a ' +
+                        'running controller after startup')
+
+    args = parser.parse_args()
+
+    regions = _make_regions()
+    budgets = {x.name: x.size for x in regions}
+    for item in args.budget:
+        name, value = item.split('=')
+        if name not in budgets:
+            parser.error(f'unknown region {name}')
+        budgets[name] = int(value, 0)
+
+    reserved = []
+    for section in read_sections(args.objdump, args.elffile):
+        if 'ALLOC' not in section.flags or section.size == 0:
+            continue
+        if section.name in RESERVED_SECTIONS:
+            reserved.append(section)
+            continue
+
+        vma_region = _find_region(regions, section.vma)
+        if vma_region:
+            vma_region.used += section.size
+            vma_region.sections.append(section)
+
+        # Initialized data lives in flash and is copied out at startup,
+        # so it is charged to both regions.
+        if 'LOAD' in section.flags and section.lma != section.vma:
+            lma_region = _find_region(regions, section.lma)
+            if lma_region and lma_region != vma_region:
+                lma_region.used += section.size
+                lma_region.sections.append(section)
+
+    symbols = read_symbols(args.nm, args.elffile)
+    for address, size, name in symbols:
+        region = _find_region(regions, address)
+        if region:
+            region.symbols.append((size, name))
+
+    flash_region = [x for x in regions if x.name == 'flash'][0]
+
+    def symbol_at(address):
+        for start, size, name in symbols:
+            if start <= address < start + max(size, 1):
+                return name
+        return f'0x{address:08x}'
+
+    # Everything the ISR runs or reads from flash, as (address, what,
+    # name).
+    functions = read_functions(args.objdump, args.elffile)
+    isr_flash = []
+    isr_bank2 = []
+    for name in sorted(isr_reachable(functions)):
+        function = functions.get(name)
+        if function is None:
+            continue
+        items = [(function.address, 'code', name)]
+        # Thumb function pointers have the low bit set.
+        items += [(x & ~1, 'data', f'{symbol_at(x & ~1)} from {name}')
+                  for x in function.words if flash_region.contains(x)]
+        for item in items:
+            if not flash_region.contains(item[0]):
+                continue
+            (isr_bank2 if item[0] >= FLASH_BANK2_START
+             else isr_flash).append(item)
+
+    lines = []
+    failed = []
+
+    for region in regions:
+        budget = budgets[region.name]
+        lines.append(
+            f'{region.name}: {_format_size(region.used)} used of ' +
+            f'{_format_size(region.size)}, ' +
+            f'{100.0 * region.used / region.size:.1f}%' +
+            (f', budget {budget}' if budget != region.size else ''))
+        for section in sorted(region.sections, key=lambda x: -x.size):
+            lines.append(f'  {section.name:20s} {_format_size(section.size)}')
+
+        lines.append(f'  largest symbols:')
+        for size, name in sorted(region.symbols,
+                                 reverse=True)[0:args.symbols]:
+            lines.append(f'    {size:7d} {name}')
+        lines.append('')
+
+        if region.used > budget:
+            failed.append(region)
+
+    for section in reserved:
+        lines.append(f'reserved: {section.name} {_format_size(section.size)}')
+
+    bank2_used = 0
+    for section in flash_region.sections:
+        start = (section.vma if flash_region.contains(section.vma)
+                 else section.lma)
+        bank2_used += max(0, min(section.size,
+                                 start + section.size - FLASH_BANK2_START))
+    lines.append(f'flash bank 2: {_format_size(bank2_used)} used')
+    lines.append(f'ISR code and data in flash: {len(isr_flash)} in bank 1, ' +
+                 f'{len(isr_bank2)} in bank 2')
+    for address, what, name in sorted(set(isr_flash + isr_bank2)):
+        lines.append(f'  0x{address:08x} {what} {name}')
+
+    # The pool is allocated on main's stack, and everything is carved
+    # out of it during startup, so the value read once the controller
+    # is running is also the peak.
+    if args.pool_available is not None:
+        pool_used = args.pool_size - args.pool_available
+        lines.append(
+            f'pool: {_format_size(pool_used)} used of ' +
+            f'{_format_size(args.pool_size)}, ' +
+            f'{100.0 * pool_used / args.pool_size:.1f}%')
+
+    report = '\n'.join(lines) + '\n'
+    print(report, end='')
+    if args.output:
+        with open(args.output, 'w') as f:
+            f.write(report)
+
+    for region in failed:
+        print(f'ERROR: {region.name} uses {region.used} bytes, ' +
+              f'budget is {budgets[region.name]}', file=sys.stderr)
+
+    for address, what, name in sorted(set(isr_bank2)):
+        print(f'ERROR: ISR {what} {name} is in flash bank 2 ' +
+              f'at 0x{address:08x}', file=sys.stderr)
+
+    return 1 if (failed or isr_bank2) else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -33,7 +33,10 @@
 #include "fw/millisecond_timer.h"
 #include "fw/moteus_controller.h"
 #include "fw/moteus_hw.h"
+#include "fw/servo_stream.h"
+#include "fw/stream_mux.h"
 #include "fw/system_info.h"
+#include "fw/task_scheduler.h"
 #include "fw/uuid.h"
 
 #if defined(TARGET_STM32G4)
@@ -130,13 +133,25 @@ namespace {
 struct CanConfig {
   uint32_t prefix = 0;
 
+  // Additional destination IDs this device responds to.  0 is
+  // unused.
+  std::array<uint8_t, FDCanMicroServer::kMaxGroups> group = {};
+
   template <typename Archive>
   void Serialize(Archive* a) {
     a->Visit(MJ_NVP(prefix));
+    a->Visit(MJ_NVP(group));
   }
+};
+
+struct Rs485Config {
+  // If true, and the board has an RS485 port, the multiplex protocol
+  // is served on it in addition to CAN.  Takes effect after a reset.
+  bool enable = false;
 
-  bool operator==(const CanConfig& rhs) const {
-    return prefix == rhs.prefix;
+  template <typename Archive>
+  void Serialize(Archive* a) {
+    a->Visit(MJ_NVP(enable));
   }
 };
 }
@@ -216,6 +231,7 @@ int main(void) {
       options.fdcan_frame = true;
       options.bitrate_switch = true;
       options.automatic_retransmission = true;
+      options.receive_interrupt = true;
 
       // Family 0 uses a TCAN334GDCNT, which has a very low loop
       // delay.  Other families use chips with a longer loop delay.
@@ -235,7 +251,11 @@ int main(void) {
         return options;
       }());
 
-  micro::AsyncStream* serial = multiplex_protocol.MakeTunnel(1);
+  // The diagnostic channel is available on either bus, with replies
+  // and telemetry going to whichever was most recently used.  The
+  // RS485 stream is only attached once the config shows it enabled.
+  StreamMux<2> serial_mux({multiplex_protocol.MakeTunnel(1), nullptr});
+  micro::AsyncStream* serial = &serial_mux;
 
   micro::AsyncExclusive<micro::AsyncWriteStream> write_stream(serial);
   micro::CommandManager command_manager(&pool, serial, &write_stream);
@@ -266,67 +286,156 @@ int main(void) {
       &pool, &command_manager, &telemetry_manager, &multiplex_protocol,
       moteus_controller.bldc_servo());
 
-  persistent_config.Register("id", multiplex_protocol.config(), [](){});
+  ServoStream servo_stream(
+      &timer, moteus_controller.bldc_servo(), command_manager, &write_stream);
+
+  // Record how the control ISR fares while the flash is being
+  // written, since the main loop is blocked for the duration.
+  flash_interface.SetOperationCallback([&](bool active) {
+      const auto max_cycles =
+          moteus_controller.bldc_servo()->ReadMaxIsrCycles();
+      if (active) {
+        system_info.SetMaxIsrCycles(max_cycles);
+      } else {
+        system_info.SetFlashMaxIsrCycles(max_cycles);
+      }
+    });
+
+  CanConfig can_config;
+  std::optional<FDCanMicroServer::FilterConfig> old_filter_config;
+
+  auto update_can_filters = [&]() {
+    FDCanMicroServer::FilterConfig filter_config;
+    filter_config.prefix = can_config.prefix;
+    filter_config.id = multiplex_protocol.config()->id;
+    filter_config.groups = can_config.group;
+
+    // We only update our config if it has actually changed.
+    // Re-initializing the CAN-FD controller can cause packets to be
+    // lost, so don't do it unless actually necessary.
+    if (old_filter_config && filter_config == *old_filter_config) {
+      return;
+    }
+    old_filter_config = filter_config;
+
+    fdcan_micro_server.ConfigureFilters(filter_config);
+  };
+
+  // The RS485 port serves the same registers as CAN, using the
+  // multiplex stream framing.  The UART moves data with DMA, so only
+  // framing is done in the main loop.  These are only allocated from
+  // the pool when rs485.enable is set.
+  std::optional<multiplex::MicroStreamDatagram> rs485_datagram;
+  std::optional<multiplex::MicroServer> rs485_protocol;
+
+  auto update_id = [&]() {
+    if (rs485_protocol) {
+      rs485_protocol->config()->id = multiplex_protocol.config()->id;
+    }
+    update_can_filters();
+  };
+
+  persistent_config.Register(
+      "id", multiplex_protocol.config(), update_id);
 
   GitInfo git_info;
   telemetry_manager.Register("git", &git_info);
 
-  CanConfig can_config, old_can_config;
+  persistent_config.Register("can", &can_config, update_can_filters);
 
-  persistent_config.Register(
-      "can", &can_config,
-      [&can_config, &fdcan, &fdcan_micro_server, &old_can_config]() {
-        // We only update our config if it has actually changed.
-        // Re-initializing the CAN-FD controller can cause packets to
-        // be lost, so don't do it unless actually necessary.
-        if (can_config == old_can_config) {
-          return;
-        }
-        old_can_config = can_config;
-
-        FDCan::Filter filters[1] = {};
-        filters[0].id1 = can_config.prefix << 16;
-        filters[0].id2 = 0x1fff0000u;
-        filters[0].mode = FDCan::FilterMode::kMask;
-        filters[0].action = FDCan::FilterAction::kAccept;
-        filters[0].type = FDCan::FilterType::kExtended;
-        FDCan::FilterConfig filter_config;
-        filter_config.begin = std::begin(filters);
-        filter_config.end = std::end(filters);
-        filter_config.global_std_action = FDCan::FilterAction::kAccept;
-        filter_config.global_ext_action = FDCan::FilterAction::kReject;
-        fdcan.ConfigureFilters(filter_config);
-
-        fdcan_micro_server.SetPrefix(can_config.prefix);
-      });
+  Rs485Config rs485_config;
+  persistent_config.Register("rs485", &rs485_config, []() {});
 
   persistent_config.Load();
 
   moteus_controller.Start();
   command_manager.AsyncStart();
   multiplex_protocol.Start(moteus_controller.multiplex_server());
+  const bool rs485_enabled = rs485 && rs485_config.enable;
+  if (rs485_enabled) {
+    rs485_datagram.emplace(&pool, &*rs485, []() {
+        multiplex::MicroStreamDatagram::Options options;
+        return options;
+      }());
+    rs485_protocol.emplace(&pool, &*rs485_datagram, []() {
+        multiplex::MicroServer::Options options;
+        options.max_tunnel_streams = 1;
+        return options;
+      }());
+    rs485_protocol->config()->id = multiplex_protocol.config()->id;
+    serial_mux.SetStream(1, rs485_protocol->MakeTunnel(1));
+    rs485_protocol->Start(moteus_controller.multiplex_server());
+  }
+
+  TaskScheduler scheduler([]() -> uint32_t { return DWT->CYCCNT; });
+  using TaskType = TaskScheduler::Type;
+  // Each task's statistics are published in system_info.tasks under
+  // its TaskName.
+
+  // Frames are queued by the FDCAN receive interrupt.  Servicing them
+  // as an urgent task bounds the time from a command arriving to it
+  // being handed to the control ISR by the slowest single task rather
+  // than a whole pass of the main loop.
+  scheduler.Register(TaskName::kCan, TaskType::kUrgent, [&]() {
+      fdcan_micro_server.Poll();
+      moteus_controller.PollCommand(fdcan_micro_server.last_rx_cycles());
+    });
+  scheduler.Register(TaskName::kRs485, TaskType::kPoll, [&]() {
+      // The UART has no per-frame receive timestamp, so frames
+      // handled here are timed from when the main loop read them.
+      const uint32_t rx_cycles = DWT->CYCCNT;
+      if (rs485) {
+        rs485->Poll();
+      }
+      if (rs485_enabled) {
+        rs485_protocol->Poll();
+        // Anything these frames wrote is applied now, so that it is
+        // never stamped with the receive time of a CAN frame.
+        moteus_controller.PollCommand(rx_cycles);
+      }
+    });
+  scheduler.Register(TaskName::kController, TaskType::kPoll, [&]() {
+      moteus_controller.Poll();
+    });
+  scheduler.Register(TaskName::kMultiplex, TaskType::kPoll, [&]() {
+      multiplex_protocol.Poll();
+    });
+  scheduler.Register(TaskName::kTelemetry, TaskType::kMillisecond, [&]() {
+      telemetry_manager.PollMillisecond();
+    });
+  scheduler.Register(TaskName::kSystemInfo, TaskType::kMillisecond, [&]() {
+      system_info.SetCanResetCount(fdcan_micro_server.can_reset_count());
+      system_info.SetCanRxCount(fdcan_micro_server.rx_count(),
+                                fdcan_micro_server.rx_foreign_count());
+      system_info.SetIsrCycles(moteus_controller.bldc_servo()->isr_cycles());
+      system_info.SetMaxIsrCycles(
+          moteus_controller.bldc_servo()->ReadMaxIsrCycles());
+      system_info.SetMaxJerkPlanCycles(
+          moteus_controller.bldc_servo()->ReadMaxJerkPlanCycles());
+      system_info.PollMillisecond();
+    });
+  scheduler.Register(TaskName::kControllerMs, TaskType::kMillisecond, [&]() {
+      moteus_controller.PollMillisecond();
+    });
+  scheduler.Register(TaskName::kBoardDebug, TaskType::kMillisecond, [&]() {
+      board_debug.PollMillisecond();
+    });
+  scheduler.Register(TaskName::kServoStream, TaskType::kMillisecond, [&]() {
+      servo_stream.PollMillisecond();
+    });
+
+  system_info.SetTaskScheduler(&scheduler);
 
   auto old_time = timer.read_us();
 
   for (;;) {
-    if (rs485) {
-      rs485->Poll();
-    }
-#if defined(TARGET_STM32G4)
-    fdcan_micro_server.Poll();
-#endif
-    moteus_controller.Poll();
-    multiplex_protocol.Poll();
+    scheduler.Poll();
 
     const auto new_time = timer.read_us();
 
     const auto delta_us = MillisecondTimer::subtract_us(new_time, old_time);
     if (delta_us >= 1000) {
-      telemetry_manager.PollMillisecond();
-      system_info.PollMillisecond();
-      moteus_controller.PollMillisecond();
-      board_debug.PollMillisecond();
-      system_info.SetCanResetCount(fdcan_micro_server.can_reset_count());
+      scheduler.PollMillisecond();
 
       old_time += 1000;
     }
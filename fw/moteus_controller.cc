@@ -14,6 +14,10 @@
 
 #include "fw/moteus_controller.h"
 
+#include <algorithm>
+#include <optional>
+#include <type_traits>
+
 #include "mjlib/base/limit.h"
 
 #include "fw/aux_port.h"
@@ -95,6 +99,10 @@ Value ScaleAcceleration(float value, size_t type) {
   return ScaleMapping(value, 0.05f, 0.001f, 0.00001f, type);
 }
 
+Value ScaleJerk(float value, size_t type) {
+  return ScaleMapping(value, 10.0f, 1.0f, 0.001f, type);
+}
+
 Value ScaleTemperature(float value, size_t type) {
   return ScaleMapping(value, 1.0f, 0.1f, 0.001f, type);
 }
@@ -122,6 +130,40 @@ Value ScaleTime(float value, size_t type) {
   return ScaleMapping(value, 0.01f, 0.001f, 0.000001f, type);
 }
 
+// Durations of up to hours, in seconds.  An infinite duration reads
+// as the maximum value of the integer types.
+Value ScaleDuration(float value, size_t type) {
+  if (type != 3 && value > 1e9f) { value = 1e9f; }
+  return ScaleMapping(value, 1.0f, 0.1f, 0.001f, type);
+}
+
+// Shared times are microsecond counts which wrap, so unlike other
+// times they are never converted through a float with the integer
+// types.
+Value ScaleTimeUs(uint32_t value, size_t type) {
+  const int32_t signed_value = static_cast<int32_t>(value);
+  switch (type) {
+    case 0: return static_cast<int8_t>(signed_value / 10000);
+    case 1: return static_cast<int16_t>(signed_value / 1000);
+    case 2: return signed_value;
+    case 3: return static_cast<float>(signed_value) * 1e-6f;
+  }
+  MJ_ASSERT(false);
+  return static_cast<int8_t>(0);
+}
+
+// Free running counts saturate at the maximum of the integer type.
+Value ScaleCount(uint32_t value, size_t type) {
+  switch (type) {
+    case 0: return static_cast<int8_t>(std::min<uint32_t>(value, 127));
+    case 1: return static_cast<int16_t>(std::min<uint32_t>(value, 32767));
+    case 2: return static_cast<int32_t>(std::min<uint32_t>(value, 0x7fffffff));
+    case 3: return static_cast<float>(value);
+  }
+  MJ_ASSERT(false);
+  return static_cast<int8_t>(0);
+}
+
 int8_t ReadIntMapping(Value value) {
   return std::visit([](auto a) {
       return static_cast<int8_t>(a);
@@ -187,6 +229,10 @@ float ReadAcceleration(Value value) {
   return ReadScaleMapping(value, 0.05f, 0.001f, 0.00001f);
 }
 
+float ReadJerk(Value value) {
+  return ReadScaleMapping(value, 10.0f, 1.0f, 0.001f);
+}
+
 float ReadCurrent(Value value) {
   return ReadScaleMapping(value, 1.0f, 0.1f, 0.001f);
 }
@@ -199,6 +245,23 @@ float ReadTime(Value value) {
   return ReadScaleMapping(value, 0.01f, 0.001f, 0.000001f);
 }
 
+std::optional<uint32_t> ReadTimeUs(Value value) {
+  return std::visit([](auto a) -> std::optional<uint32_t> {
+      using T = decltype(a);
+      if constexpr (std::is_same_v<T, float>) {
+        if (!std::isfinite(a)) { return {}; }
+        return static_cast<uint32_t>(static_cast<int32_t>(a * 1e6f));
+      } else {
+        if (a == std::numeric_limits<T>::min()) { return {}; }
+        constexpr int32_t scale =
+            std::is_same_v<T, int8_t> ? 10000 :
+            std::is_same_v<T, int16_t> ? 1000 :
+            1;
+        return static_cast<uint32_t>(static_cast<int32_t>(a) * scale);
+      }
+    }, value);
+}
+
 template <typename T, size_t N>
 int8_t PinsToBits(const std::array<T, N>& array) {
   static_assert(N <= 7);
@@ -254,6 +317,8 @@ enum class Register {
   kCommandVelocityLimit = 0x028,
   kCommandAccelLimit = 0x029,
   kCommandFixedVoltageOverride = 0x02a,
+  kCommandJerkLimit = 0x02b,
+  kCommandArrivalTime = 0x02c,
 
   kPositionKp = 0x030,
   kPositionKi = 0x031,
@@ -267,6 +332,7 @@ enum class Register {
   kErrorPosition = 0x03b,
   kErrorVelocity = 0x03c,
   kErrorTorque = 0x03d,
+  kLoadTorque = 0x03e,
 
   kStayWithinLower = 0x040,
   kStayWithinUpper = 0x041,
@@ -302,6 +368,54 @@ enum class Register {
 
   kMillisecondCounter = 0x070,
   kClockTrim = 0x071,
+  kCommandLatency = 0x072,
+  kControlCycle = 0x073,
+  kSharedTime = 0x074,
+
+  kAuxSnapshotGpio = 0x078,
+  kAuxSnapshotAux1Analog1 = 0x079,
+  kAuxSnapshotAux1Analog2 = 0x07a,
+  kAuxSnapshotAux1Analog3 = 0x07b,
+  kAuxSnapshotAux1Analog4 = 0x07c,
+  kAuxSnapshotAux1Analog5 = 0x07d,
+  kAuxSnapshotAux2Analog1 = 0x07e,
+  kAuxSnapshotAux2Analog2 = 0x07f,
+  kAuxSnapshotAux2Analog3 = 0x080,
+  kAuxSnapshotAux2Analog4 = 0x081,
+  kAuxSnapshotAux2Analog5 = 0x082,
+
+  kAuxAverageGpio = 0x088,
+  kAuxAverageAux1Analog1 = 0x089,
+  kAuxAverageAux1Analog2 = 0x08a,
+  kAuxAverageAux1Analog3 = 0x08b,
+  kAuxAverageAux1Analog4 = 0x08c,
+  kAuxAverageAux1Analog5 = 0x08d,
+  kAuxAverageAux2Analog1 = 0x08e,
+  kAuxAverageAux2Analog2 = 0x08f,
+  kAuxAverageAux2Analog3 = 0x090,
+  kAuxAverageAux2Analog4 = 0x091,
+  kAuxAverageAux2Analog5 = 0x092,
+
+  kStatsQCurrentMin = 0x0a0,
+  kStatsQCurrentMax = 0x0a1,
+  kStatsQCurrentMean = 0x0a2,
+  kStatsTorqueMin = 0x0a3,
+  kStatsTorqueMax = 0x0a4,
+  kStatsTorqueMean = 0x0a5,
+  kStatsVelocityMin = 0x0a6,
+  kStatsVelocityMax = 0x0a7,
+  kStatsVelocityMean = 0x0a8,
+  kStatsCount = 0x0a9,
+
+  kHeartbeat = 0x0b0,
+  kTimeoutCause = 0x0b1,
+  kCommandTimeoutCount = 0x0b2,
+  kHeartbeatTimeoutCount = 0x0b3,
+  kMissedHeartbeatCount = 0x0b4,
+
+  kTimeToDerate = 0x0c0,
+  kFetTemperatureRise = 0x0c1,
+  kMotorTemperatureRise = 0x0c2,
 
   kModelNumber = 0x100,
   kFirmwareVersion = 0x101,
@@ -473,13 +587,29 @@ class MoteusController::Impl : public multiplex::MicroServer::Server {
   }
 
   void Poll() {
+    aux1_port_.Poll();
+    aux2_port_.Poll();
+  }
+
+  void PollCommand(uint32_t rx_cycles) {
+    if (pending_shared_time_us_) {
+      bldc_.SetSharedTime(*pending_shared_time_us_, rx_cycles);
+      pending_shared_time_us_.reset();
+    }
+
+    // The next frame should get a fresh status snapshot.
+    snapshot_valid_ = false;
+    aux_average_valid_ = false;
+    statistics_valid_ = false;
+
     // Check to see if we have a command to send out.
     if (command_valid_) {
       command_valid_ = false;
       bldc_.Command(command_);
+
+      command_latency_us_ =
+          (DWT->CYCCNT - rx_cycles) / (SystemCoreClock / 1000000);
     }
-    aux1_port_.Poll();
-    aux2_port_.Poll();
   }
 
   void PollMillisecond() {
@@ -583,6 +713,14 @@ class MoteusController::Impl : public multiplex::MicroServer::Server {
         command_.accel_limit = ReadAcceleration(value);
         return 0;
       }
+      case Register::kCommandJerkLimit: {
+        command_.jerk_limit = ReadJerk(value);
+        return 0;
+      }
+      case Register::kCommandArrivalTime: {
+        command_.arrival_time_us = ReadTimeUs(value);
+        return 0;
+      }
       case Register::kCommandVelocityLimit: {
         command_.velocity_limit = ReadVelocity(value);
         return 0;
@@ -628,6 +766,12 @@ class MoteusController::Impl : public multiplex::MicroServer::Server {
         clock_manager_->SetTrim(ReadIntMapping(value));
         return 0;
       }
+      case Register::kSharedTime: {
+        // This is applied in PollCommand, where the time the frame
+        // was received is known.
+        pending_shared_time_us_ = ReadTimeUs(value);
+        return 0;
+      }
 
       case Register::kSetOutputNearest: {
         const float position = ReadPosition(value);
@@ -639,6 +783,10 @@ class MoteusController::Impl : public multiplex::MicroServer::Server {
         bldc_.SetOutputPosition(position);
         return 0;
       }
+      case Register::kHeartbeat: {
+        bldc_.Heartbeat();
+        return 0;
+      }
       case Register::kRequireReindex: {
         bldc_.RequireReindex();
         return 0;
@@ -667,6 +815,7 @@ class MoteusController::Impl : public multiplex::MicroServer::Server {
       case Register::kErrorPosition:
       case Register::kErrorVelocity:
       case Register::kErrorTorque:
+      case Register::kLoadTorque:
       case Register::kEncoder0Position:
       case Register::kEncoder0Velocity:
       case Register::kEncoder1Position:
@@ -694,6 +843,47 @@ class MoteusController::Impl : public multiplex::MicroServer::Server {
       case Register::kRegisterMapVersion:
       case Register::kFirmwareVersion:
       case Register::kMultiplexId:
+      case Register::kCommandLatency:
+      case Register::kControlCycle:
+      case Register::kAuxSnapshotGpio:
+      case Register::kAuxSnapshotAux1Analog1:
+      case Register::kAuxSnapshotAux1Analog2:
+      case Register::kAuxSnapshotAux1Analog3:
+      case Register::kAuxSnapshotAux1Analog4:
+      case Register::kAuxSnapshotAux1Analog5:
+      case Register::kAuxSnapshotAux2Analog1:
+      case Register::kAuxSnapshotAux2Analog2:
+      case Register::kAuxSnapshotAux2Analog3:
+      case Register::kAuxSnapshotAux2Analog4:
+      case Register::kAuxSnapshotAux2Analog5:
+      case Register::kAuxAverageGpio:
+      case Register::kAuxAverageAux1Analog1:
+      case Register::kAuxAverageAux1Analog2:
+      case Register::kAuxAverageAux1Analog3:
+      case Register::kAuxAverageAux1Analog4:
+      case Register::kAuxAverageAux1Analog5:
+      case Register::kAuxAverageAux2Analog1:
+      case Register::kAuxAverageAux2Analog2:
+      case Register::kAuxAverageAux2Analog3:
+      case Register::kAuxAverageAux2Analog4:
+      case Register::kAuxAverageAux2Analog5:
+      case Register::kStatsQCurrentMin:
+      case Register::kStatsQCurrentMax:
+      case Register::kStatsQCurrentMean:
+      case Register::kStatsTorqueMin:
+      case Register::kStatsTorqueMax:
+      case Register::kStatsTorqueMean:
+      case Register::kStatsVelocityMin:
+      case Register::kStatsVelocityMax:
+      case Register::kStatsVelocityMean:
+      case Register::kStatsCount:
+      case Register::kTimeoutCause:
+      case Register::kCommandTimeoutCount:
+      case Register::kHeartbeatTimeoutCount:
+      case Register::kMissedHeartbeatCount:
+      case Register::kTimeToDerate:
+      case Register::kFetTemperatureRise:
+      case Register::kMotorTemperatureRise:
       case Register::kDriverFault1:
       case Register::kDriverFault2: {
         // Not writeable
@@ -705,8 +895,84 @@ class MoteusController::Impl : public multiplex::MicroServer::Server {
     return 1;
   }
 
-  const MotorPosition::SourceStatus& encoder_value(int index) const {
-    return bldc_.motor_position().sources[index];
+  // All status registers read while handling one frame come from the
+  // same control cycle.
+  const BldcServo::StatusSnapshot& status_snapshot() const {
+    if (!snapshot_valid_) {
+      snapshot_ = bldc_.status_snapshot();
+      snapshot_valid_ = true;
+    }
+    return snapshot_;
+  }
+
+  // The aux analog inputs averaged over every control cycle since
+  // the previous frame which read them, aux1 pins 1-5 then aux2.
+  float aux_average(int index) const {
+    if (!aux_average_valid_) {
+      aux_average_valid_ = true;
+
+      const auto& status = status_snapshot();
+      const uint32_t cycles = status.cycle - aux_average_cycle_;
+
+      const std::array<uint32_t, 5>* const sums[] = {
+        &status.aux1_analog_sums,
+        &status.aux2_analog_sums,
+      };
+      const std::array<float, 5>* const inputs[] = {
+        &status.aux1_analog_inputs,
+        &status.aux2_analog_inputs,
+      };
+      // The sums wrap after this many cycles of full scale input.
+      constexpr uint32_t kMaxCycles = 0xffffffffu / 4096;
+
+      for (int port = 0; port < 2; port++) {
+        for (int pin = 0; pin < 5; pin++) {
+          const int i = port * 5 + pin;
+          const uint32_t sum = (*sums[port])[pin];
+          aux_average_[i] =
+              (cycles == 0 || cycles > kMaxCycles) ?
+              (*inputs[port])[pin] :
+              static_cast<float>(sum - aux_average_sums_[i]) /
+              (4096.0f * cycles);
+          aux_average_sums_[i] = sum;
+        }
+      }
+      aux_average_cycle_ = status.cycle;
+    }
+    return aux_average_[index];
+  }
+
+  float Mean(const BldcServo::Statistics::Field& field) const {
+    return statistics_.count == 0 ?
+        std::numeric_limits<float>::quiet_NaN() :
+        field.sum / statistics_.count;
+  }
+
+  // Reading any statistics register starts a new window, so every
+  // register read in one frame comes from the same window.
+  const BldcServo::Statistics& statistics() const {
+    if (!statistics_valid_) {
+      statistics_ = bldc_.ReadStatistics();
+      statistics_valid_ = true;
+
+      // Report fields which are disabled, or have an empty window, as
+      // NaN rather than infinity.
+      constexpr float kNaN = std::numeric_limits<float>::quiet_NaN();
+      const auto& config = bldc_.config().statistics;
+      for (auto [field, enabled] : {
+               std::make_pair(&statistics_.q_A, config.q_current),
+               std::make_pair(&statistics_.torque_Nm, config.torque),
+               std::make_pair(&statistics_.velocity, config.velocity) }) {
+        if (statistics_.count == 0 || !enabled) {
+          field->min = field->max = field->sum = kNaN;
+        }
+      }
+    }
+    return statistics_;
+  }
+
+  const BldcServo::StatusSnapshot::Encoder& encoder_value(int index) const {
+    return status_snapshot().encoders[index];
   }
 
   const MotorPosition::SourceConfig& encoder_config(int index) const {
@@ -718,47 +984,47 @@ class MoteusController::Impl : public multiplex::MicroServer::Server {
       size_t type) const override
       __attribute__ ((optimize("O3"))) {
     auto vi32 = [](auto v) { return Value(static_cast<int32_t>(v)); };
+    const auto& status = status_snapshot();
 
     switch (static_cast<Register>(reg)) {
       case Register::kMode: {
-        return IntMapping(static_cast<int8_t>(bldc_.status().mode), type);
+        return IntMapping(static_cast<int8_t>(status.mode), type);
       }
       case Register::kPosition: {
-        return ScalePosition(bldc_.status().position, type);
+        return ScalePosition(status.position, type);
       }
       case Register::kVelocity: {
-        return ScaleVelocity(bldc_.status().velocity, type);
+        return ScaleVelocity(status.velocity, type);
       }
       case Register::kMotorTemperature: {
-        return ScaleTemperature(bldc_.status().motor_temp_C, type);
+        return ScaleTemperature(status.motor_temp_C, type);
       }
       case Register::kTemperature: {
-        return ScaleTemperature(bldc_.status().fet_temp_C, type);
+        return ScaleTemperature(status.fet_temp_C, type);
       }
       case Register::kQCurrent: {
-        return ScaleCurrent(bldc_.status().q_A, type);
+        return ScaleCurrent(status.q_A, type);
       }
       case Register::kDCurrent: {
-        return ScaleCurrent(bldc_.status().d_A, type);
+        return ScaleCurrent(status.d_A, type);
       }
       case Register::kAbsPosition: {
         return ScalePosition(encoder_value(1).filtered_value / encoder_config(1).cpr, type);
       }
       case Register::kTrajectoryComplete: {
-        return IntMapping(bldc_.status().trajectory_done ? 1 : 0, type);
+        return IntMapping(status.trajectory_done ? 1 : 0, type);
       }
       case Register::kHomeState: {
-        return IntMapping(
-            static_cast<int>(bldc_.motor_position().homed), type);
+        return IntMapping(static_cast<int>(status.homed), type);
       }
       case Register::kVoltage: {
-        return ScaleVoltage(bldc_.status().bus_V, type);
+        return ScaleVoltage(status.bus_V, type);
       }
       case Register::kTorque: {
-        return ScaleTorque(bldc_.status().torque_Nm, type);
+        return ScaleTorque(status.torque_Nm, type);
       }
       case Register::kFault: {
-        return IntMapping(bldc_.status().fault, type);
+        return IntMapping(status.fault, type);
       }
 
       case Register::kPwmPhaseA: {
@@ -823,6 +1089,15 @@ class MoteusController::Impl : public multiplex::MicroServer::Server {
       case Register::kCommandAccelLimit: {
         return ScaleAcceleration(command_.accel_limit, type);
       }
+      case Register::kCommandJerkLimit: {
+        return ScaleJerk(command_.jerk_limit, type);
+      }
+      case Register::kCommandArrivalTime: {
+        if (!command_.arrival_time_us) {
+          return ScaleTime(std::numeric_limits<float>::quiet_NaN(), type);
+        }
+        return ScaleTimeUs(*command_.arrival_time_us, type);
+      }
       case Register::kCommandFixedVoltageOverride: {
         return ScaleVoltage(command_.fixed_voltage_override, type);
       }
@@ -840,41 +1115,41 @@ class MoteusController::Impl : public multiplex::MicroServer::Server {
       }
 
       case Register::kPositionKp: {
-        return ScaleTorque(bldc_.status().pid_position.p, type);
+        return ScaleTorque(status.pid_position_p, type);
       }
       case Register::kPositionKi: {
-        return ScaleTorque(bldc_.status().pid_position.integral, type);
+        return ScaleTorque(status.pid_position_integral, type);
       }
       case Register::kPositionKd: {
-        return ScaleTorque(bldc_.status().pid_position.d, type);
+        return ScaleTorque(status.pid_position_d, type);
       }
       case Register::kPositionFeedforward: {
         return ScaleTorque(command_.feedforward_Nm, type);
       }
       case Register::kPositionCommandTorque: {
-        return ScaleTorque(bldc_.control().torque_Nm, type);
+        return ScaleTorque(status.control_torque_Nm, type);
       }
 
       case Register::kControlPosition: {
-        return ScalePosition(bldc_.status().control_position, type);
+        return ScalePosition(status.control_position, type);
       }
       case Register::kControlVelocity: {
-        return ScaleVelocity(
-            bldc_.status().control_velocity.value_or(
-                std::numeric_limits<float>::quiet_NaN()),
-            type);
+        return ScaleVelocity(status.control_velocity, type);
       }
       case Register::kControlTorque: {
-        return ScaleTorque(bldc_.control().torque_Nm, type);
+        return ScaleTorque(status.control_torque_Nm, type);
       }
       case Register::kErrorPosition: {
-        return ScalePosition(bldc_.status().pid_position.error, type);
+        return ScalePosition(status.pid_position_error, type);
       }
       case Register::kErrorVelocity: {
-        return ScaleVelocity(bldc_.status().pid_position.error_rate, type);
+        return ScaleVelocity(status.pid_position_error_rate, type);
       }
       case Register::kErrorTorque: {
-        return ScaleTorque(bldc_.status().torque_error_Nm, type);
+        return ScaleTorque(status.torque_error_Nm, type);
+      }
+      case Register::kLoadTorque: {
+        return ScaleTorque(status.load_torque_Nm, type);
       }
 
       case Register::kStayWithinLower: {
@@ -903,28 +1178,28 @@ class MoteusController::Impl : public multiplex::MicroServer::Server {
         return ScaleVelocity(encoder_value(2).velocity / encoder_config(2).cpr, type);
       }
       case Register::kEncoderValidity: {
-        const auto& status = bldc_.motor_position();
+        const auto& encoders = status.encoders;
 
         const int8_t validity =
-            ((status.sources[0].active_theta ? 1 : 0) << 0) |
-            ((status.sources[0].active_velocity ? 1 : 0) << 1) |
-            ((status.sources[1].active_theta ? 1 : 0) << 2) |
-            ((status.sources[1].active_velocity ? 1 : 0) << 3) |
-            ((status.sources[2].active_theta ? 1 : 0) << 4);
-            ((status.sources[2].active_velocity ? 1 : 0) << 5);
+            ((encoders[0].active_theta ? 1 : 0) << 0) |
+            ((encoders[0].active_velocity ? 1 : 0) << 1) |
+            ((encoders[1].active_theta ? 1 : 0) << 2) |
+            ((encoders[1].active_velocity ? 1 : 0) << 3) |
+            ((encoders[2].active_theta ? 1 : 0) << 4);
+            ((encoders[2].active_velocity ? 1 : 0) << 5);
         return IntMapping(validity, type);
       }
       case Register::kAux1GpioCommand: {
-        return IntMapping(PinsToBits(bldc_.aux1().pins), type);
+        return IntMapping(PinsToBits(status.aux1_pins), type);
       }
       case Register::kAux2GpioCommand: {
-        return IntMapping(PinsToBits(bldc_.aux2().pins), type);
+        return IntMapping(PinsToBits(status.aux2_pins), type);
       }
       case Register::kAux1GpioStatus: {
-        return IntMapping(PinsToBits(bldc_.aux1().pins), type);
+        return IntMapping(PinsToBits(status.aux1_pins), type);
       }
       case Register::kAux2GpioStatus: {
-        return IntMapping(PinsToBits(bldc_.aux2().pins), type);
+        return IntMapping(PinsToBits(status.aux2_pins), type);
       }
       case Register::kAux1AnalogIn1:
       case Register::kAux1AnalogIn2:
@@ -933,7 +1208,7 @@ class MoteusController::Impl : public multiplex::MicroServer::Server {
       case Register::kAux1AnalogIn5: {
         const int pin =
             static_cast<int>(reg) - static_cast<int>(Register::kAux1AnalogIn1);
-        return ScalePwm(bldc_.aux1().analog_inputs[pin], type);
+        return ScalePwm(status.aux1_analog_inputs[pin], type);
       }
       case Register::kAux2AnalogIn1:
       case Register::kAux2AnalogIn2:
@@ -942,7 +1217,103 @@ class MoteusController::Impl : public multiplex::MicroServer::Server {
       case Register::kAux2AnalogIn5: {
         const int pin =
             static_cast<int>(reg) - static_cast<int>(Register::kAux2AnalogIn1);
-        return ScalePwm(bldc_.aux2().analog_inputs[pin], type);
+        return ScalePwm(status.aux2_analog_inputs[pin], type);
+      }
+      case Register::kAuxSnapshotGpio:
+      case Register::kAuxAverageGpio: {
+        return IntMapping(
+            static_cast<int16_t>(PinsToBits(status.aux1_pins) |
+                                 (PinsToBits(status.aux2_pins) << 8)),
+            type);
+      }
+      case Register::kAuxSnapshotAux1Analog1:
+      case Register::kAuxSnapshotAux1Analog2:
+      case Register::kAuxSnapshotAux1Analog3:
+      case Register::kAuxSnapshotAux1Analog4:
+      case Register::kAuxSnapshotAux1Analog5:
+      case Register::kAuxSnapshotAux2Analog1:
+      case Register::kAuxSnapshotAux2Analog2:
+      case Register::kAuxSnapshotAux2Analog3:
+      case Register::kAuxSnapshotAux2Analog4:
+      case Register::kAuxSnapshotAux2Analog5: {
+        const int index =
+            static_cast<int>(reg) -
+            static_cast<int>(Register::kAuxSnapshotAux1Analog1);
+        const auto& analog_inputs =
+            index < 5 ? status.aux1_analog_inputs : status.aux2_analog_inputs;
+        return ScalePwm(analog_inputs[index % 5], type);
+      }
+      case Register::kAuxAverageAux1Analog1:
+      case Register::kAuxAverageAux1Analog2:
+      case Register::kAuxAverageAux1Analog3:
+      case Register::kAuxAverageAux1Analog4:
+      case Register::kAuxAverageAux1Analog5:
+      case Register::kAuxAverageAux2Analog1:
+      case Register::kAuxAverageAux2Analog2:
+      case Register::kAuxAverageAux2Analog3:
+      case Register::kAuxAverageAux2Analog4:
+      case Register::kAuxAverageAux2Analog5: {
+        const int index =
+            static_cast<int>(reg) -
+            static_cast<int>(Register::kAuxAverageAux1Analog1);
+        return ScalePwm(aux_average(index), type);
+      }
+      case Register::kStatsQCurrentMin: {
+        return ScaleCurrent(statistics().q_A.min, type);
+      }
+      case Register::kStatsQCurrentMax: {
+        return ScaleCurrent(statistics().q_A.max, type);
+      }
+      case Register::kStatsQCurrentMean: {
+        return ScaleCurrent(Mean(statistics().q_A), type);
+      }
+      case Register::kStatsTorqueMin: {
+        return ScaleTorque(statistics().torque_Nm.min, type);
+      }
+      case Register::kStatsTorqueMax: {
+        return ScaleTorque(statistics().torque_Nm.max, type);
+      }
+      case Register::kStatsTorqueMean: {
+        return ScaleTorque(Mean(statistics().torque_Nm), type);
+      }
+      case Register::kStatsVelocityMin: {
+        return ScaleVelocity(statistics().velocity.min, type);
+      }
+      case Register::kStatsVelocityMax: {
+        return ScaleVelocity(statistics().velocity.max, type);
+      }
+      case Register::kStatsVelocityMean: {
+        return ScaleVelocity(Mean(statistics().velocity), type);
+      }
+      case Register::kStatsCount: {
+        return ScaleCount(statistics().count, type);
+      }
+      case Register::kHeartbeat: {
+        return ScaleCount(bldc_.status().watchdog.consecutive_misses, type);
+      }
+      case Register::kTimeoutCause: {
+        return IntMapping(
+            static_cast<int>(bldc_.status().watchdog.cause), type);
+      }
+      case Register::kCommandTimeoutCount: {
+        return ScaleCount(bldc_.status().watchdog.command_timeouts, type);
+      }
+      case Register::kHeartbeatTimeoutCount: {
+        return ScaleCount(bldc_.status().watchdog.heartbeat_timeouts, type);
+      }
+      case Register::kMissedHeartbeatCount: {
+        return ScaleCount(bldc_.status().watchdog.missed_heartbeats, type);
+      }
+      case Register::kTimeToDerate: {
+        return ScaleDuration(
+            bldc_.status().thermal_model.time_to_derate_s, type);
+      }
+      case Register::kFetTemperatureRise: {
+        return ScaleTemperature(bldc_.status().thermal_model.fet_rise_C, type);
+      }
+      case Register::kMotorTemperatureRise: {
+        return ScaleTemperature(
+            bldc_.status().thermal_model.motor_rise_C, type);
       }
       case Register::kMillisecondCounter: {
         const uint32_t ms_counter = system_info_->millisecond_counter();
@@ -957,6 +1328,22 @@ class MoteusController::Impl : public multiplex::MicroServer::Server {
       case Register::kClockTrim: {
         return IntMapping(clock_manager_->trim(), type);
       }
+      case Register::kSharedTime: {
+        return ScaleTimeUs(bldc_.status().shared_time_us, type);
+      }
+      case Register::kControlCycle: {
+        const uint32_t cycle = status.cycle;
+        switch (type) {
+          case 0: return static_cast<int8_t>(cycle % 256);
+          case 1: return static_cast<int16_t>(cycle % 65536);
+          case 2: return static_cast<int32_t>(cycle);
+          case 3: return static_cast<float>(cycle % 8388608);
+        }
+        break;
+      }
+      case Register::kCommandLatency: {
+        return ScaleCount(command_latency_us_, type);
+      }
 
       case Register::kModelNumber: {
         if (type != 2) { break; }
@@ -1016,6 +1403,20 @@ class MoteusController::Impl : public multiplex::MicroServer::Server {
 
   bool command_valid_ = false;
   BldcServo::CommandData command_;
+  uint32_t command_latency_us_ = 0;
+
+  std::optional<uint32_t> pending_shared_time_us_;
+
+  mutable bool snapshot_valid_ = false;
+  mutable BldcServo::StatusSnapshot snapshot_;
+
+  mutable bool statistics_valid_ = false;
+  mutable BldcServo::Statistics statistics_;
+
+  mutable bool aux_average_valid_ = false;
+  mutable uint32_t aux_average_cycle_ = 0;
+  mutable std::array<uint32_t, 10> aux_average_sums_ = {};
+  mutable std::array<float, 10> aux_average_ = {};
 };
 
 MoteusController::MoteusController(micro::Pool* pool,
@@ -1040,6 +1441,10 @@ void MoteusController::Poll() {
   impl_->Poll();
 }
 
+void MoteusController::PollCommand(uint32_t rx_cycles) {
+  impl_->PollCommand(rx_cycles);
+}
+
 void MoteusController::PollMillisecond() {
   impl_->PollMillisecond();
 }
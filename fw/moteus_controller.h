@@ -45,6 +45,13 @@ class MoteusController {
   void Poll();
   void PollMillisecond();
 
+  /// Hand any command or shared time received since the last call to
+  /// the control ISR.  @p rx_cycles is the DWT cycle count when the
+  /// frame which carried it was received, so this must be called
+  /// after polling each transport, with that transport's receive
+  /// time.
+  void PollCommand(uint32_t rx_cycles);
+
   BldcServo* bldc_servo();
 
   mjlib::multiplex::MicroServer::Server* multiplex_server();
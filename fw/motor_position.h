@@ -73,6 +73,13 @@ class MotorPosition {
 
     float pll_filter_hz = 400.0;
 
+    // If non-zero, the filter bandwidth is raised as speed increases,
+    // reaching pll_filter_high_hz at pll_filter_high_speed source
+    // revolutions per second and above.  This permits a low noise
+    // velocity estimate at low speed, without lagging at high speed.
+    float pll_filter_high_hz = 0.0f;
+    float pll_filter_high_speed = 0.0f;
+
     // The CPR for this source is subdivided into N equal segments.
     // This table specifies a fraction of CPR that should be applied
     // when at the *center* of that offset region.  Other counts will
@@ -101,6 +108,8 @@ class MotorPosition {
       a->Visit(MJ_NVP(debug_override));
       a->Visit(MJ_NVP(reference));
       a->Visit(MJ_NVP(pll_filter_hz));
+      a->Visit(MJ_NVP(pll_filter_high_hz));
+      a->Visit(MJ_NVP(pll_filter_high_speed));
       a->Visit(MJ_NVP(compensation_table));
     }
   };
@@ -430,6 +439,8 @@ class MotorPosition {
           const float max_pll_hz = source_rate_hz / 10.0f;
           source_config.pll_filter_hz =
               std::min(source_config.pll_filter_hz, max_pll_hz);
+          source_config.pll_filter_high_hz =
+              std::min(source_config.pll_filter_high_hz, max_pll_hz);
           break;
         }
         case SourceConfig::kHall: {
@@ -563,9 +574,33 @@ class MotorPosition {
       const auto& config = config_.sources[i];
       auto& constants = pll_filter_constants_[i];
 
-      const float w_3db = config.pll_filter_hz * k2Pi;
-      constants.kp = 2.0f * w_3db;
-      constants.ki = w_3db * w_3db;
+      const bool scheduled =
+          config.pll_filter_hz != 0.0f &&
+          config.pll_filter_high_hz != 0.0f &&
+          config.pll_filter_high_speed > 0.0f;
+
+      // Breakpoints are evenly spaced in speed, with bandwidths
+      // spaced geometrically between the low and high values.
+      for (size_t j = 0; j < kPllBreakpoints; j++) {
+        const float fraction =
+            static_cast<float>(j) / static_cast<float>(kPllBreakpoints - 1);
+        const float filter_hz =
+            scheduled ?
+            config.pll_filter_hz * std::pow(
+                config.pll_filter_high_hz / config.pll_filter_hz, fraction) :
+            config.pll_filter_hz;
+        const float w_3db = filter_hz * k2Pi;
+        constants.kp[j] = 2.0f * w_3db;
+        constants.ki[j] = w_3db * w_3db;
+      }
+
+      // This converts an absolute velocity in counts per second to a
+      // fractional breakpoint index.
+      constants.speed_scale =
+          scheduled ?
+          static_cast<float>(kPllBreakpoints - 1) /
+          (config.pll_filter_high_speed * static_cast<float>(config.cpr)) :
+          0.0f;
     }
 
     if (config_updated_) {
@@ -933,11 +968,26 @@ class MotorPosition {
           const float error =
               WrapBalancedCpr(unwrapped_error, cpr);
 
+          float kp = filter.kp[0];
+          float ki = filter.ki[0];
+          if (filter.speed_scale != 0.0f) {
+            const float position = std::min(
+                static_cast<float>(kPllBreakpoints - 1),
+                std::abs(status.velocity) * filter.speed_scale);
+            const int index =
+                std::min<int>(kPllBreakpoints - 2, static_cast<int>(position));
+            const float fraction = position - static_cast<float>(index);
+            kp = filter.kp[index] +
+                fraction * (filter.kp[index + 1] - filter.kp[index]);
+            ki = filter.ki[index] +
+                fraction * (filter.ki[index + 1] - filter.ki[index]);
+          }
+
           status.filtered_value +=
-              status.time_since_update * filter.kp * error;
+              status.time_since_update * kp * error;
 
           status.velocity +=
-              status.time_since_update * filter.ki * error;
+              status.time_since_update * ki * error;
         } else {
           status.filtered_value = status.compensated_value;
           status.velocity = 0.0f;
@@ -1073,9 +1123,14 @@ class MotorPosition {
   int32_t output_encoder_step_hb_1_4_ = 0;
   int32_t output_encoder_step_hb_3_4_ = 0;
 
+  static constexpr size_t kPllBreakpoints = 4;
+
   struct PllFilterConstants {
-    float kp = 0.0f;
-    float ki = 0.0f;
+    std::array<float, kPllBreakpoints> kp = {};
+    std::array<float, kPllBreakpoints> ki = {};
+
+    // Zero if the bandwidth is not speed scheduled.
+    float speed_scale = 0.0f;
   };
   std::array<PllFilterConstants, kNumSources> pll_filter_constants_;
 };
@@ -0,0 +1,72 @@
+// Copyright 2023 mjbots Robotic Systems, LLC.  info@mjbots.com
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace moteus {
+
+/// Publishes a value from a single writer, normally an ISR, to
+/// readers in lower priority contexts on the same core.
+///
+/// Readers never block the writer.  If a read is interrupted by a
+/// write, the reader just copies the value again.
+template <typename T>
+class SeqLock {
+ public:
+  /// Only call from the single writer.
+  void Write(const T& value) {
+    Update([&](T* destination) { *destination = value; });
+  }
+
+  /// Only call from the single writer.  @p fill is invoked with a
+  /// pointer to the published value, so that it can be updated in
+  /// place without an intermediate copy.
+  template <typename Fill>
+  void Update(Fill fill) {
+    const uint32_t sequence = sequence_.load(std::memory_order_relaxed);
+    sequence_.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    fill(&value_);
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    sequence_.store(sequence + 2, std::memory_order_relaxed);
+  }
+
+  T Read() const {
+    while (true) {
+      const uint32_t before = sequence_.load(std::memory_order_relaxed);
+      std::atomic_signal_fence(std::memory_order_seq_cst);
+      T result = value_;
+      std::atomic_signal_fence(std::memory_order_seq_cst);
+      const uint32_t after = sequence_.load(std::memory_order_relaxed);
+
+      if (before == after && (before & 1) == 0) {
+        return result;
+      }
+    }
+  }
+
+  /// Incremented by 2 for each completed write.
+  uint32_t sequence() const {
+    return sequence_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  T value_ = {};
+  std::atomic<uint32_t> sequence_{0};
+};
+
+}
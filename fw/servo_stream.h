@@ -0,0 +1,243 @@
+// Copyright 2023 mjbots Robotic Systems, LLC.  info@mjbots.com
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "mjlib/base/tokenizer.h"
+#include "mjlib/micro/async_exclusive.h"
+#include "mjlib/micro/async_stream.h"
+#include "mjlib/micro/command_manager.h"
+
+#include "fw/bldc_servo.h"
+#include "fw/field_stream.h"
+#include "fw/millisecond_timer.h"
+
+namespace moteus {
+
+/// Emits individual fields of the servo_stats and servo_control
+/// telemetry channels, each at its own rate, as a packed
+/// "servo_stream" record.  The diagnostic commands are:
+///
+///  stream sub <field> <period_ms> [<field> <period_ms>...]
+///     A period of 0 unsubscribes.  Replies as for "stream list".
+///  stream clear
+///  stream list
+///     One "<field> <type> <period_ms>" line per subscription, in
+///     record order.
+///
+/// Since the reply to "stream sub" is written before any record, a
+/// host can learn the record layout even while records are flowing.
+class ServoStream {
+ public:
+  ServoStream(MillisecondTimer* timer,
+              const BldcServo* bldc,
+              mjlib::micro::CommandManager& command_manager,
+              mjlib::micro::AsyncExclusive<
+                mjlib::micro::AsyncWriteStream>* write_stream)
+      : timer_(timer),
+        bldc_(bldc),
+        write_stream_(write_stream),
+        status_(bldc->status()),
+        control_(bldc->control()),
+        fields_{
+          MF("mode", &status_.mode),
+          MF("fault", &status_.fault),
+          MF("adc_cur1_raw", &status_.adc_cur1_raw),
+          MF("adc_cur2_raw", &status_.adc_cur2_raw),
+          MF("adc_cur3_raw", &status_.adc_cur3_raw),
+          MF("cur1_A", &status_.cur1_A),
+          MF("cur2_A", &status_.cur2_A),
+          MF("cur3_A", &status_.cur3_A),
+          MF("bus_V", &status_.bus_V),
+          MF("filt_bus_V", &status_.filt_bus_V),
+          MF("fet_temp_C", &status_.fet_temp_C),
+          MF("filt_fet_temp_C", &status_.filt_fet_temp_C),
+          MF("motor_temp_C", &status_.motor_temp_C),
+          MF("filt_motor_temp_C", &status_.filt_motor_temp_C),
+          MF("d_A", &status_.d_A),
+          MF("q_A", &status_.q_A),
+          MF("position", &status_.position),
+          MF("velocity", &status_.velocity),
+          MF("torque_Nm", &status_.torque_Nm),
+          MF("velocity_filt", &status_.velocity_filt),
+          MF("control_position", &status_.control_position),
+          MF("control_acceleration", &status_.control_acceleration),
+          MF("trajectory_done", &status_.trajectory_done),
+          MF("timeout_s", &status_.timeout_s),
+          MF("torque_error_Nm", &status_.torque_error_Nm),
+          MF("load_torque_Nm", &status_.load_observer.load_Nm),
+          MF("feedforward_model_Nm", &status_.feedforward_model_Nm),
+          MF("pid_position.error", &status_.pid_position.error),
+          MF("pid_position.integral", &status_.pid_position.integral),
+          MF("final_timer", &status_.final_timer),
+          MF("control.d_V", &control_.d_V),
+          MF("control.q_V", &control_.q_V),
+          MF("control.i_d_A", &control_.i_d_A),
+          MF("control.i_q_A", &control_.i_q_A),
+          MF("control.torque_Nm", &control_.torque_Nm),
+        },
+        stream_(fields_, kNumFields) {
+    std::memcpy(emit_buffer_, kEmitHeader, sizeof(kEmitHeader) - 1);
+
+    command_manager.Register("stream", [this](auto&& command, auto&& response) {
+        this->Command(command, response);
+      });
+  }
+
+  void PollMillisecond() {
+    // If the previous record has not been written yet, leave
+    // everything due until the next poll.
+    if (writing_) { return; }
+
+    const uint32_t now_ms = timer_->read_ms();
+    const uint16_t mask = stream_.Schedule(now_ms);
+    if (mask == 0) { return; }
+
+    // The fields are read from the live status, so copy them again
+    // if a control cycle ran in between, so that a record never
+    // mixes cycles.  The copy is short, so this rarely needs more
+    // than one retry.  If every attempt is interrupted, the record
+    // is dropped rather than emitted torn.
+    size_t size = 0;
+    for (int attempt = 0; ; attempt++) {
+      if (attempt == kMaxCopyAttempts) { return; }
+
+      const uint32_t before = bldc_->status_sequence();
+      std::atomic_signal_fence(std::memory_order_seq_cst);
+      size = stream_.Write(
+          now_ms, mask,
+          mjlib::base::string_span(
+              &emit_buffer_[kEmitHeaderSize], FieldStream::kMaxRecordSize));
+      std::atomic_signal_fence(std::memory_order_seq_cst);
+      if (bldc_->status_sequence() == before) { break; }
+    }
+
+    const uint32_t size32 = size;
+    std::memcpy(&emit_buffer_[kEmitHeaderSize - 4], &size32, sizeof(size32));
+
+    writing_ = true;
+    write_stream_->AsyncStart(
+        [this, size](mjlib::micro::AsyncWriteStream* stream,
+                     mjlib::micro::VoidCallback release) {
+          mjlib::micro::AsyncWrite(
+              *stream,
+              std::string_view(emit_buffer_, kEmitHeaderSize + size),
+              [this, release](const mjlib::micro::error_code&) {
+                writing_ = false;
+                release();
+              });
+        });
+  }
+
+ private:
+  template <typename T>
+  static constexpr FieldStream::Field MF(const char* name, const T* data) {
+    return FieldStream::MakeField(name, data);
+  }
+
+  void Command(const std::string_view& command,
+               const mjlib::micro::CommandManager::Response& response) {
+    mjlib::base::Tokenizer tokenizer(command, " ");
+    const auto cmd_text = tokenizer.next();
+
+    if (cmd_text == "sub") {
+      while (true) {
+        const auto name = tokenizer.next();
+        if (name.empty()) { break; }
+        const auto period_str = tokenizer.next();
+        if (period_str.empty()) {
+          WriteMessage("ERR missing period\r\n", response);
+          return;
+        }
+        const auto period_ms = ParsePeriod(period_str);
+        if (period_ms < 0) {
+          WriteMessage("ERR invalid period\r\n", response);
+          return;
+        }
+        if (!stream_.Subscribe(name, period_ms)) {
+          WriteMessage("ERR unknown field or too many\r\n", response);
+          return;
+        }
+      }
+      WriteList(response);
+    } else if (cmd_text == "clear") {
+      stream_.Clear();
+      WriteMessage("OK\r\n", response);
+    } else if (cmd_text == "list") {
+      WriteList(response);
+    } else {
+      WriteMessage("ERR unknown stream\r\n", response);
+    }
+  }
+
+  // Returns -1 if @p text is not an integer from 0 to 65535.  The
+  // tokenizer's views are not null terminated, so strtol can not be
+  // used directly.
+  static int32_t ParsePeriod(const std::string_view& text) {
+    if (text.empty() || text.size() > 5) { return -1; }
+    int32_t result = 0;
+    for (const char c : text) {
+      if (c < '0' || c > '9') { return -1; }
+      result = result * 10 + (c - '0');
+    }
+    return result > 65535 ? -1 : result;
+  }
+
+  void WriteList(const mjlib::micro::CommandManager::Response& response) {
+    size_t pos = 0;
+    for (size_t i = 0; i < stream_.size(); i++) {
+      const auto& subscription = stream_.subscription(i);
+      pos += std::snprintf(
+          &list_buffer_[pos], sizeof(list_buffer_) - pos,
+          "%s %s %d\r\n",
+          subscription.field->name,
+          FieldStream::TypeName(subscription.field->type),
+          static_cast<int>(subscription.period_ms));
+    }
+    std::snprintf(&list_buffer_[pos], sizeof(list_buffer_) - pos, "OK\r\n");
+    WriteMessage(list_buffer_, response);
+  }
+
+  void WriteMessage(const std::string_view& message,
+                    const mjlib::micro::CommandManager::Response& response) {
+    mjlib::micro::AsyncWrite(*response.stream, message, response.callback);
+  }
+
+  static constexpr size_t kNumFields = 35;
+  static constexpr int kMaxCopyAttempts = 4;
+  static constexpr char kEmitHeader[] = "emit servo_stream\r\n";
+  // The announcement is followed by the uint32 record size.
+  static constexpr size_t kEmitHeaderSize = sizeof(kEmitHeader) - 1 + 4;
+
+  MillisecondTimer* const timer_;
+  const BldcServo* const bldc_;
+  mjlib::micro::AsyncExclusive<mjlib::micro::AsyncWriteStream>* const
+      write_stream_;
+  const BldcServo::Status& status_;
+  const BldcServo::Control& control_;
+
+  const FieldStream::Field fields_[kNumFields];
+  FieldStream stream_;
+
+  bool writing_ = false;
+  char emit_buffer_[kEmitHeaderSize + FieldStream::kMaxRecordSize] = {};
+  char list_buffer_[FieldStream::kMaxSubscriptions * 40 + 8] = {};
+};
+
+}
@@ -16,15 +16,34 @@
 
 #include "mbed.h"
 
+#include "mjlib/base/inplace_function.h"
 #include "mjlib/micro/flash.h"
 
+#include "fw/ccm.h"
+
 namespace moteus {
 
+/// The persistent configuration lives in the last two pages of flash
+/// bank 2.  The G474 is run in dual bank mode, so while those pages
+/// are being erased or programmed, code and constants in bank 1, RAM,
+/// and CCM can still be read, and the control ISR is not stalled.
+/// memory_report.py verifies that no ISR code ends up in bank 2.
+///
+/// Each page is erased and each double word programmed as a separate
+/// operation, with the wait for completion running from CCM.
 class Stm32G4Flash : public mjlib::micro::FlashInterface {
  public:
+  /// Invoked with true before the flash is unlocked for writing, and
+  /// with false after it is locked again.
+  using OperationCallback = mjlib::base::inplace_function<void (bool)>;
+
   Stm32G4Flash() {}
   ~Stm32G4Flash() override {}
 
+  void SetOperationCallback(OperationCallback callback) {
+    operation_callback_ = callback;
+  }
+
   Info GetInfo() override {
     Info result;
     // The final 4k of flash
@@ -34,22 +53,23 @@ class Stm32G4Flash : public mjlib::micro::FlashInterface {
   }
 
   void Erase() override {
-    uint32_t page_err = 0;
-    FLASH_EraseInitTypeDef erase_options{};
-    erase_options.TypeErase = FLASH_TYPEERASE_PAGES;
-    erase_options.Banks = FLASH_BANK_2;
-    erase_options.Page = 126;
-    erase_options.NbPages = 2;
-    if (HAL_FLASHEx_Erase(&erase_options, &page_err) != HAL_OK) {
-      mbed_die();
-    }
-    if (page_err != 0xffffffff) {
-      mbed_die();
+    for (uint32_t page = kFirstPage; page < kFirstPage + kNumPages; page++) {
+      FLASH->CR = (FLASH->CR & ~(FLASH_CR_PNB | FLASH_CR_PG)) |
+          FLASH_CR_BKER | FLASH_CR_PER | (page << FLASH_CR_PNB_Pos);
+      FLASH->CR |= FLASH_CR_STRT;
+      const bool ok = Wait();
+      FLASH->CR &= ~(FLASH_CR_PER | FLASH_CR_BKER | FLASH_CR_PNB);
+      if (!ok) { mbed_die(); }
     }
+
+    // Any cached data from these pages is now stale.
+    FlushCaches();
   }
 
   void Unlock() override {
+    if (operation_callback_) { operation_callback_(true); }
     HAL_FLASH_Unlock();
+    ClearErrors();
   }
 
   void Lock() override {
@@ -57,6 +77,7 @@ class Stm32G4Flash : public mjlib::micro::FlashInterface {
       FlushWord();
     }
     HAL_FLASH_Lock();
+    if (operation_callback_) { operation_callback_(false); }
   }
 
   void ProgramByte(char* ptr, uint8_t value) override {
@@ -80,12 +101,56 @@ class Stm32G4Flash : public mjlib::micro::FlashInterface {
 
  private:
   void FlushWord() {
-    HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, shadow_start_, shadow_);
+    const uint64_t value = shadow_;
+    volatile uint32_t* const dest =
+        reinterpret_cast<volatile uint32_t*>(shadow_start_);
+
+    FLASH->CR |= FLASH_CR_PG;
+    dest[0] = static_cast<uint32_t>(value);
+    __ISB();
+    dest[1] = static_cast<uint32_t>(value >> 32);
+    const bool ok = Wait();
+    FLASH->CR &= ~FLASH_CR_PG;
+    if (!ok) { mbed_die(); }
+
     shadow_start_ = 0;
     shadow_ = 0;
     shadow_bits_ = 0;
   }
 
+  static bool Wait() MOTEUS_CCM_ATTRIBUTE {
+    while (FLASH->SR & FLASH_SR_BSY);
+
+    const uint32_t sr = FLASH->SR;
+    // The error flags are cleared by writing 1.
+    FLASH->SR = sr & (kErrors | FLASH_SR_EOP);
+    return (sr & kErrors) == 0;
+  }
+
+  static void ClearErrors() {
+    FLASH->SR = kErrors | FLASH_SR_EOP;
+  }
+
+  static void FlushCaches() {
+    const uint32_t enabled = FLASH->ACR & (FLASH_ACR_ICEN | FLASH_ACR_DCEN);
+    FLASH->ACR &= ~(FLASH_ACR_ICEN | FLASH_ACR_DCEN);
+    FLASH->ACR |= FLASH_ACR_ICRST | FLASH_ACR_DCRST;
+    FLASH->ACR &= ~(FLASH_ACR_ICRST | FLASH_ACR_DCRST);
+    FLASH->ACR |= enabled;
+  }
+
+  // Pages 126 and 127 of bank 2.
+  static constexpr uint32_t kFirstPage = 126;
+  static constexpr uint32_t kNumPages = 2;
+
+  static constexpr uint32_t kErrors =
+      FLASH_SR_OPERR | FLASH_SR_PROGERR | FLASH_SR_WRPERR |
+      FLASH_SR_PGAERR | FLASH_SR_SIZERR | FLASH_SR_PGSERR |
+      FLASH_SR_MISERR | FLASH_SR_FASTERR | FLASH_SR_RDERR |
+      FLASH_SR_OPTVERR;
+
+  OperationCallback operation_callback_;
+
   uint32_t shadow_start_ = 0;
   uint64_t shadow_ = 0;
   uint64_t shadow_bits_ = 0;
@@ -0,0 +1,143 @@
+// Copyright 2023 mjbots Robotic Systems, LLC.  info@mjbots.com
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "mjlib/base/assert.h"
+#include "mjlib/micro/async_stream.h"
+
+namespace moteus {
+
+/// Presents several AsyncStreams as one.  Data read from any of them
+/// is returned in the order it arrives.  Writes go to whichever
+/// stream most recently provided data, so replies and telemetry
+/// follow the host that is currently talking to us.
+///
+/// Only one host should use the merged stream at a time, as lines
+/// arriving on different streams at once may be interleaved.
+template <size_t kStreams, size_t kBufferSize = 64>
+class StreamMux : public mjlib::micro::AsyncStream {
+ public:
+  /// Any of the @p streams may be nullptr, in which case it is
+  /// ignored.
+  StreamMux(const std::array<mjlib::micro::AsyncStream*, kStreams>& streams) {
+    for (size_t i = 0; i < kStreams; i++) {
+      children_[i].stream = streams[i];
+    }
+  }
+
+  void AsyncReadSome(const mjlib::base::string_span& buffer,
+                     const mjlib::micro::SizeCallback& callback) override {
+    MJ_ASSERT(!read_callback_);
+    read_buffer_ = buffer;
+    read_callback_ = callback;
+
+    for (size_t i = 0; i < kStreams; i++) {
+      StartRead(i);
+    }
+    MaybeCompleteRead();
+  }
+
+  void AsyncWriteSome(const std::string_view& data,
+                      const mjlib::micro::SizeCallback& callback) override {
+    auto* const stream = children_[active_].stream;
+    if (!stream) {
+      // Nothing has been received yet, and our first stream is
+      // absent, so just discard the data.
+      callback(mjlib::micro::error_code(), data.size());
+      return;
+    }
+    stream->AsyncWriteSome(data, callback);
+  }
+
+  /// Attach a stream after construction, for instance once the
+  /// configuration has been loaded.  Any slot previously empty may be
+  /// filled.
+  void SetStream(size_t index, mjlib::micro::AsyncStream* stream) {
+    MJ_ASSERT(!children_[index].stream);
+    children_[index].stream = stream;
+    if (read_callback_) { StartRead(index); }
+  }
+
+  /// The stream to which writes are currently directed.
+  size_t active() const { return active_; }
+
+ private:
+  struct Child {
+    mjlib::micro::AsyncStream* stream = nullptr;
+    char buffer[kBufferSize] = {};
+    size_t offset = 0;
+    size_t size = 0;
+    bool reading = false;
+  };
+
+  void StartRead(size_t index) {
+    auto& child = children_[index];
+    if (!child.stream || child.reading || child.offset != child.size) {
+      return;
+    }
+
+    child.reading = true;
+    child.offset = 0;
+    child.size = 0;
+    child.stream->AsyncReadSome(
+        mjlib::base::string_span(child.buffer, sizeof(child.buffer)),
+        [this, index](const mjlib::micro::error_code& ec, size_t size) {
+          auto& child = children_[index];
+          child.reading = false;
+          // On error, there is nothing for us to report to our
+          // reader, so just try again.
+          child.size = ec ? 0 : size;
+          MaybeCompleteRead();
+          if (read_callback_) { StartRead(index); }
+        });
+  }
+
+  void MaybeCompleteRead() {
+    if (!read_callback_) { return; }
+
+    // Prefer the most recently used stream, so that anything left
+    // over from its last read is delivered before switching.
+    for (size_t i = 0; i < kStreams; i++) {
+      const size_t index = (active_ + i) % kStreams;
+      auto& child = children_[index];
+      if (child.offset == child.size) { continue; }
+
+      const size_t to_copy = std::min<size_t>(
+          child.size - child.offset, read_buffer_.size());
+      std::memcpy(read_buffer_.data(), &child.buffer[child.offset], to_copy);
+      child.offset += to_copy;
+      active_ = index;
+
+      auto copy = read_callback_;
+      read_callback_ = {};
+      read_buffer_ = {};
+
+      copy(mjlib::micro::error_code(), to_copy);
+      return;
+    }
+  }
+
+  std::array<Child, kStreams> children_;
+  size_t active_ = 0;
+
+  mjlib::base::string_span read_buffer_;
+  mjlib::micro::SizeCallback read_callback_;
+};
+
+}
@@ -14,6 +14,8 @@
 
 #include "fw/system_info.h"
 
+#include <algorithm>
+
 #include "mbed.h"
 
 #include "mjlib/base/inplace_function.h"
@@ -26,6 +28,21 @@ namespace moteus {
 volatile uint32_t SystemInfo::idle_count = 0;
 
 namespace {
+struct TaskInfo {
+  TaskName name = TaskName::kUnknown;
+  uint32_t count = 0;
+  float mean_us = 0.0f;
+  float max_us = 0.0f;
+
+  template <typename Archive>
+  void Serialize(Archive* a) {
+    a->Visit(MJ_NVP(name));
+    a->Visit(MJ_NVP(count));
+    a->Visit(MJ_NVP(mean_us));
+    a->Visit(MJ_NVP(max_us));
+  }
+};
+
 struct SystemInfoData {
   uint32_t pool_size = 0;
   uint32_t pool_available = 0;
@@ -33,6 +50,29 @@ struct SystemInfoData {
   uint32_t idle_rate = 0;
   uint32_t can_reset_count = 0;
 
+  // Frames which passed the CAN hardware filter, and those which
+  // passed it despite not being addressed to us.
+  uint32_t can_rx_count = 0;
+  uint32_t can_rx_foreign_count = 0;
+
+  // Main loop tasks, in the order they are registered with the
+  // scheduler in moteus.cc, measured over the last reporting
+  // interval.  The times include any pre-emption by interrupts.
+  std::array<TaskInfo, TaskScheduler::kMaxTasks> tasks = {};
+
+  // Time spent in the control ISR over the last reporting interval.
+  uint32_t isr_us = 0;
+
+  // The longest the control ISR took to complete, measured from the
+  // start of its PWM period, over the last reporting interval, and
+  // during the most recent flash write, i.e. "conf write".
+  float isr_max_us = 0.0f;
+  float flash_isr_max_us = 0.0f;
+
+  // The longest the control ISR spent on a cycle which planned a
+  // jerk limited move, over the last reporting interval.
+  float jerk_plan_max_us = 0.0f;
+
   // We deliberately start this counter near to int32 overflow so that
   // any applications that use it will likely have to handle it
   // properly.
@@ -45,6 +85,13 @@ struct SystemInfoData {
     a->Visit(MJ_NVP(idle_rate));
     a->Visit(MJ_NVP(can_reset_count));
     a->Visit(MJ_NVP(ms_count));
+    a->Visit(MJ_NVP(can_rx_count));
+    a->Visit(MJ_NVP(can_rx_foreign_count));
+    a->Visit(MJ_NVP(tasks));
+    a->Visit(MJ_NVP(isr_us));
+    a->Visit(MJ_NVP(isr_max_us));
+    a->Visit(MJ_NVP(flash_isr_max_us));
+    a->Visit(MJ_NVP(jerk_plan_max_us));
   }
 };
 }
@@ -72,6 +119,31 @@ class SystemInfo::Impl {
     data_.idle_rate = this_idle_count - last_idle_count_;
     last_idle_count_ = this_idle_count;
 
+    const float cycles_per_us = SystemCoreClock / 1000000;
+
+    data_.isr_us = static_cast<uint32_t>(
+        (isr_cycles_ - last_isr_cycles_) / cycles_per_us);
+    last_isr_cycles_ = isr_cycles_;
+
+    data_.isr_max_us = max_isr_cycles_ / cycles_per_us;
+    max_isr_cycles_ = 0;
+    data_.flash_isr_max_us = flash_max_isr_cycles_ / cycles_per_us;
+    data_.jerk_plan_max_us = max_jerk_plan_cycles_ / cycles_per_us;
+    max_jerk_plan_cycles_ = 0;
+
+    if (scheduler_) {
+      for (size_t i = 0; i < scheduler_->size(); i++) {
+        const auto& stats = scheduler_->stats(i);
+        auto& info = data_.tasks[i];
+        info.count = stats.count;
+        info.mean_us = stats.count == 0 ? 0.0f :
+            (static_cast<float>(stats.total_cycles) / stats.count /
+             cycles_per_us);
+        info.max_us = stats.max_cycles / cycles_per_us;
+      }
+      scheduler_->ResetStats();
+    }
+
     data_updater_();
   }
 
@@ -79,10 +151,44 @@ class SystemInfo::Impl {
     data_.can_reset_count = value;
   }
 
+  void SetCanRxCount(uint32_t accepted, uint32_t foreign) {
+    data_.can_rx_count = accepted;
+    data_.can_rx_foreign_count = foreign;
+  }
+
+  void SetTaskScheduler(TaskScheduler* scheduler) {
+    scheduler_ = scheduler;
+    for (size_t i = 0; i < scheduler_->size(); i++) {
+      data_.tasks[i].name = scheduler_->name(i);
+    }
+  }
+
+  void SetIsrCycles(uint32_t value) {
+    isr_cycles_ = value;
+  }
+
+  void SetMaxIsrCycles(uint32_t value) {
+    max_isr_cycles_ = std::max(max_isr_cycles_, value);
+  }
+
+  void SetFlashMaxIsrCycles(uint32_t value) {
+    flash_max_isr_cycles_ = value;
+  }
+
+  void SetMaxJerkPlanCycles(uint32_t value) {
+    max_jerk_plan_cycles_ = std::max(max_jerk_plan_cycles_, value);
+  }
+
   mjlib::micro::Pool& pool_;
 
   uint8_t ms_count_ = 0;
   uint32_t last_idle_count_ = 0;
+  TaskScheduler* scheduler_ = nullptr;
+  uint32_t isr_cycles_ = 0;
+  uint32_t last_isr_cycles_ = 0;
+  uint32_t max_isr_cycles_ = 0;
+  uint32_t flash_max_isr_cycles_ = 0;
+  uint32_t max_jerk_plan_cycles_ = 0;
   SystemInfoData data_;
   mjlib::base::inplace_function<void ()> data_updater_;
 };
@@ -101,6 +207,30 @@ void SystemInfo::SetCanResetCount(uint32_t value) {
   impl_->SetCanResetCount(value);
 }
 
+void SystemInfo::SetCanRxCount(uint32_t accepted, uint32_t foreign) {
+  impl_->SetCanRxCount(accepted, foreign);
+}
+
+void SystemInfo::SetTaskScheduler(TaskScheduler* scheduler) {
+  impl_->SetTaskScheduler(scheduler);
+}
+
+void SystemInfo::SetIsrCycles(uint32_t value) {
+  impl_->SetIsrCycles(value);
+}
+
+void SystemInfo::SetMaxIsrCycles(uint32_t value) {
+  impl_->SetMaxIsrCycles(value);
+}
+
+void SystemInfo::SetFlashMaxIsrCycles(uint32_t value) {
+  impl_->SetFlashMaxIsrCycles(value);
+}
+
+void SystemInfo::SetMaxJerkPlanCycles(uint32_t value) {
+  impl_->SetMaxJerkPlanCycles(value);
+}
+
 uint32_t SystemInfo::millisecond_counter() const {
   return impl_->data_.ms_count;
 }
@@ -17,6 +17,8 @@
 #include "mjlib/micro/pool_ptr.h"
 #include "mjlib/micro/telemetry_manager.h"
 
+#include "fw/task_scheduler.h"
+
 namespace moteus {
 
 /// This class keeps track of things like how many main loops we
@@ -29,6 +31,25 @@ class SystemInfo {
 
   void PollMillisecond();
   void SetCanResetCount(uint32_t);
+  void SetCanRxCount(uint32_t accepted, uint32_t foreign);
+
+  /// Report per-task statistics from this scheduler.  Its statistics
+  /// are reset at each reporting interval.
+  void SetTaskScheduler(TaskScheduler*);
+
+  /// Set the free running count of cycles spent in the control ISR.
+  void SetIsrCycles(uint32_t);
+
+  /// Report the longest control ISR, in cycles, since the last call.
+  void SetMaxIsrCycles(uint32_t);
+
+  /// Set the longest control ISR, in cycles, observed while the
+  /// flash was last being written.
+  void SetFlashMaxIsrCycles(uint32_t);
+
+  /// Report the longest jerk limited plan made by the control ISR,
+  /// in cycles, since the last call.
+  void SetMaxJerkPlanCycles(uint32_t);
 
   uint32_t millisecond_counter() const;
 
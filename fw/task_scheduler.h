@@ -0,0 +1,178 @@
+// Copyright 2023 mjbots Robotic Systems, LLC.  info@mjbots.com
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <utility>
+
+#include "mjlib/base/assert.h"
+#include "mjlib/base/inplace_function.h"
+#include "mjlib/base/visitor.h"
+
+namespace moteus {
+
+/// Identifies each task registered with the scheduler, so that its
+/// statistics can be published with its name in system_info.tasks.
+enum class TaskName : uint8_t {
+  kUnknown,
+  kCan,
+  kRs485,
+  kController,
+  kMultiplex,
+  kTelemetry,
+  kSystemInfo,
+  kControllerMs,
+  kBoardDebug,
+  kServoStream,
+  kNumNames,
+};
+
+/// Runs the non-ISR work of the firmware as a fixed list of
+/// cooperative tasks, and keeps cycle count statistics for each one.
+class TaskScheduler {
+ public:
+  static constexpr size_t kMaxTasks = 12;
+
+  enum class Type {
+    // Run once per pass of the main loop.
+    kPoll,
+    // Run once per millisecond.
+    kMillisecond,
+    // Run before every other task, so that the latency until it is
+    // next run is bounded by the slowest single task rather than a
+    // whole pass of the main loop.
+    kUrgent,
+  };
+
+  using Callback = mjlib::base::inplace_function<void ()>;
+
+  // Returns a free running cycle counter, i.e. DWT->CYCCNT.
+  using CycleCounter = uint32_t (*)();
+
+  struct Stats {
+    uint32_t count = 0;
+    uint32_t total_cycles = 0;
+    uint32_t max_cycles = 0;
+  };
+
+  TaskScheduler(CycleCounter cycle_counter)
+      : cycle_counter_(cycle_counter) {}
+
+  /// @return the index of the new task, which can be used to look up
+  /// its statistics.
+  size_t Register(TaskName name, Type type, const Callback& callback) {
+    MJ_ASSERT(size_ < kMaxTasks);
+    auto& task = tasks_[size_];
+    task.name = name;
+    task.type = type;
+    task.callback = callback;
+    return size_++;
+  }
+
+  /// Run every kPoll task once.
+  void Poll() {
+    Run(Type::kPoll);
+  }
+
+  /// Run every kMillisecond task once.
+  void PollMillisecond() {
+    Run(Type::kMillisecond);
+  }
+
+  size_t size() const { return size_; }
+  TaskName name(size_t index) const { return tasks_[index].name; }
+  const Stats& stats(size_t index) const { return tasks_[index].stats; }
+
+  /// Clear the statistics of every task, starting a new measurement
+  /// window.
+  void ResetStats() {
+    for (size_t i = 0; i < size_; i++) {
+      tasks_[i].stats = {};
+    }
+  }
+
+ private:
+  struct Task {
+    TaskName name = TaskName::kUnknown;
+    Type type = Type::kPoll;
+    Callback callback;
+    Stats stats;
+  };
+
+  void Run(Type type) {
+    for (size_t i = 0; i < size_; i++) {
+      auto& task = tasks_[i];
+      if (task.type != type) { continue; }
+
+      RunUrgent();
+      RunTask(&task);
+    }
+    RunUrgent();
+  }
+
+  void RunUrgent() {
+    for (size_t i = 0; i < size_; i++) {
+      auto& task = tasks_[i];
+      if (task.type != Type::kUrgent) { continue; }
+      RunTask(&task);
+    }
+  }
+
+  void RunTask(Task* task) {
+    const uint32_t start = cycle_counter_();
+    task->callback();
+    const uint32_t delta = cycle_counter_() - start;
+
+    auto& stats = task->stats;
+    stats.count++;
+    stats.total_cycles += delta;
+    if (delta > stats.max_cycles) { stats.max_cycles = delta; }
+  }
+
+  const CycleCounter cycle_counter_;
+  std::array<Task, kMaxTasks> tasks_ = {};
+  size_t size_ = 0;
+};
+
+}
+
+namespace mjlib {
+namespace base {
+
+template <>
+struct IsEnum<moteus::TaskName> {
+  static constexpr bool value = true;
+
+  using T = moteus::TaskName;
+  static std::array<std::pair<T, const char*>,
+                    static_cast<int>(T::kNumNames)> map() {
+    return { {
+        { T::kUnknown, "unknown" },
+        { T::kCan, "can" },
+        { T::kRs485, "rs485" },
+        { T::kController, "controller" },
+        { T::kMultiplex, "multiplex" },
+        { T::kTelemetry, "telemetry" },
+        { T::kSystemInfo, "system_info" },
+        { T::kControllerMs, "controller_ms" },
+        { T::kBoardDebug, "board_debug" },
+        { T::kServoStream, "servo_stream" },
+      } };
+  }
+};
+
+}
+}
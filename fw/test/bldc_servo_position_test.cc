@@ -15,11 +15,14 @@
 #include "fw/bldc_servo_position.h"
 
 #include <fstream>
+#include <vector>
 
 #include <fmt/format.h>
 
 #include <boost/test/auto_unit_test.hpp>
 
+#include "fw/test/trajectory_fuzz.h"
+
 using namespace moteus;
 
 namespace tt = boost::test_tools;
@@ -625,3 +628,410 @@ BOOST_AUTO_TEST_CASE(StopPositionWithLimitOvershoot, * boost::unit_test::toleran
   BOOST_TEST(ctx.status.control_velocity.value() == 0.0);
   BOOST_TEST(ctx.status.trajectory_done == true);
 }
+
+namespace {
+// The time to change velocity by dv, starting and ending with no
+// acceleration.
+double JerkVelocityChangeTime(double dv, double a, double j) {
+  dv = std::abs(dv);
+  if (dv >= a * a / j) { return dv / a + a / j; }
+  return 2.0 * std::sqrt(dv / j);
+}
+
+// The duration of a rest to rest move.
+double JerkMoveTime(double dx, double a, double v, double j) {
+  dx = std::abs(dx);
+  if (std::isfinite(v) && v * JerkVelocityChangeTime(v, a, j) <= dx) {
+    // We reach the velocity limit and cruise.
+    return JerkVelocityChangeTime(v, a, j) + dx / v;
+  }
+
+  // Otherwise, find the peak velocity that covers the distance.
+  double lo = 0.0;
+  double hi = std::isfinite(v) ? v : 1e6;
+  for (int i = 0; i < 200; i++) {
+    const double mid = 0.5 * (lo + hi);
+    if (mid * JerkVelocityChangeTime(mid, a, j) > dx) {
+      hi = mid;
+    } else {
+      lo = mid;
+    }
+  }
+  return 2.0 * JerkVelocityChangeTime(lo, a, j);
+}
+}
+
+BOOST_AUTO_TEST_CASE(JerkLimits, * boost::unit_test::tolerance(1e-3)) {
+  struct TestCase {
+    double x0;
+    double v0;
+
+    double xf;
+    double vf;
+
+    double a;
+    double v;
+    double j;
+    double rate_khz;
+
+    // If true, check the duration against that of a rest to rest
+    // move or velocity change.
+    bool check_duration;
+  };
+
+  TestCase test_cases[] = {
+    ///////////////////////////////////
+    // "velocity mode"
+    { 0.0,  0.0,   NaN,  0.5,   1.0, 2.0, 10.0, 40,  true },
+    { 0.0,  0.0,   NaN,  2.0,   1.0, 4.0, 2.0,  40,  true },
+    { 0.0,  1.0,   NaN, -0.5,   1.0, 2.0, 4.0,  40,  true },
+    { 0.0,  0.5,   NaN,  6.0,   2.0, 4.0, 8.0,  15,  false },
+
+    /////////////////////////////////
+    // Rest to rest, with and without reaching the accel and velocity
+    // limits.
+    { 0.0,  0.0,   5.0, 0.0,    1.0, NaN, 1.0,  40,  true },
+    { 0.0,  0.0,   5.0, 0.0,    1.0, NaN, 10.0, 40,  true },
+    { 0.0,  0.0,   3.0, 0.0,    1.0, 0.5, 4.0,  40,  true },
+    { 0.0,  0.0,   3.0, 0.0,    2.0, 0.7, 4.0,  40,  true },
+    { 0.0,  0.0,   0.01, 0.0,   2.0, 0.7, 4.0,  40,  true },
+    { 5.0,  0.0,   0.0, 0.0,    2.0, 1.5, 20.0, 15,  true },
+    { -1.0, 0.0,  -3.0, 0.0,  100.0, 5.0, 2000.0, 30,  true },
+
+    /////////////////////////////////
+    // Moving starts, overshoot, and overspeed.
+    { 0.0,  1.0,    5.0, 0.0,   1.0, NaN, 2.0,  40,  false },
+    { 0.0, -1.0,    5.0, 0.0,   1.0, 2.0, 2.0,  40,  false },
+    { 0.3,  4.0,    3.0, 0.0,   2.0, 0.7, 8.0,  40,  false },
+    { 0.3,  2.0,    3.0, 0.0,   2.0, 0.7, 8.0,  40,  false },
+
+    /////////////////////////////////
+    // Moving targets.
+    { 0.0,  0.0,    3.0, 0.5,   1.0, 0.8, 4.0,  40,  false },
+    { 0.0,  0.0,    0.0, -0.5,  1.0, 0.6, 4.0,  40,  false },
+    {-0.03, 0.5,    0.0, 0.3,   1.0, 0.6, 4.0,  40,  false },
+
+    // Near the wraparound point.
+    {32765.97, 0.5,  32766.0, 0.3,  1.0, 0.6, 4.0, 15,  false },
+    {32767.98, 0.5, -32767.99, 0.3,  1.0, 0.6, 4.0, 15,  false },
+  };
+
+  int case_num = 0;
+
+  for (const auto& test_case : test_cases) {
+    case_num++;
+
+    BOOST_TEST_CONTEXT("Case " << case_num << " : "
+                       << test_case.x0 << " "
+                       << test_case.v0 << " "
+                       << test_case.xf << " "
+                       << test_case.vf << " "
+                       << test_case.a << " "
+                       << test_case.v << " "
+                       << test_case.j) {
+      Context ctx;
+      ctx.rate_hz = test_case.rate_khz * 1000.0;
+      ctx.data.position = test_case.xf;
+      ctx.data.velocity = test_case.vf;
+      ctx.data.accel_limit = test_case.a;
+      ctx.data.velocity_limit = test_case.v;
+      ctx.data.jerk_limit = test_case.j;
+      ctx.set_position(test_case.x0);
+      ctx.set_velocity(test_case.v0);
+
+      const double dt = 1.0 / ctx.rate_hz;
+      const int64_t x0_raw = ctx.to_raw(static_cast<float>(test_case.x0));
+      const int64_t xf_raw = ctx.to_raw(static_cast<float>(test_case.xf));
+
+      double old_vel = test_case.v0;
+      double old_accel = 0.0;
+      bool overspeed = std::abs(test_case.v0) > test_case.v;
+
+      double max_jerk = 0.0;
+      double max_accel = 0.0;
+      double duration = NaN;
+
+      const int64_t max_count = 30.0 * ctx.rate_hz;
+      for (int64_t i = 0; i < max_count; i++) {
+        ctx.Call();
+
+        const double this_vel = ctx.status.control_velocity.value();
+        const double accel = ctx.status.control_acceleration;
+        const double jerk = (accel - old_accel) * ctx.rate_hz;
+
+        max_accel = std::max(max_accel, std::abs(accel));
+        max_jerk = std::max(max_jerk, std::abs(jerk));
+
+        // The change in velocity should match the acceleration.  This
+        // is limited by the float resolution of the velocity.
+        if (i != 0) {
+          const double measured_accel = (this_vel - old_vel) * ctx.rate_hz;
+          BOOST_TEST(std::abs(measured_accel - 0.5 * (accel + old_accel)) <
+                     0.05 + test_case.j * dt);
+        }
+
+        if (std::isfinite(test_case.v)) {
+          if (!overspeed) {
+            BOOST_TEST(std::abs(this_vel) <= test_case.v + 1e-4);
+          } else if (std::abs(this_vel) <= test_case.v) {
+            overspeed = false;
+          }
+        }
+
+        old_vel = this_vel;
+        old_accel = accel;
+
+        if (ctx.status.trajectory_done) {
+          duration = (i + 1) * dt;
+          break;
+        }
+      }
+
+      BOOST_TEST(std::isfinite(duration));
+      BOOST_TEST(max_accel <= test_case.a * 1.001);
+      // As is this, by the float resolution of the acceleration.
+      BOOST_TEST(max_jerk <= test_case.j * 1.001 + test_case.a * 1e-7 * ctx.rate_hz);
+      BOOST_TEST(ctx.status.control_acceleration == 0.0);
+
+      const double expected_vf =
+          std::isfinite(test_case.v) ?
+          std::max(-test_case.v, std::min(test_case.v, test_case.vf)) :
+          test_case.vf;
+      BOOST_TEST(ctx.status.control_velocity.value() == expected_vf);
+
+      if (std::isfinite(test_case.xf)) {
+        // The target has moved on by the time we arrive.
+        const double target =
+            ctx.from_raw(xf_raw - x0_raw) + test_case.vf * duration;
+        const double final_position =
+            ctx.from_raw(ctx.status.control_position_raw.value() - x0_raw);
+        BOOST_TEST(std::abs(final_position - target) <=
+                   BldcServoPosition::kJerkPositionTolerance);
+      }
+
+      if (test_case.check_duration) {
+        const double expected_duration =
+            std::isfinite(test_case.xf) ?
+            JerkMoveTime(test_case.xf - test_case.x0,
+                         test_case.a, test_case.v, test_case.j) :
+            JerkVelocityChangeTime(test_case.vf - test_case.v0,
+                                   test_case.a, test_case.j);
+        // We may finish up to a cycle late, and the cruise velocity
+        // is only refined to within a short cruise.
+        BOOST_TEST(duration >= expected_duration - dt);
+        BOOST_TEST(duration <=
+                   expected_duration + 2 * dt +
+                   BldcServoPosition::kJerkPlanCruiseTolerance_s);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(JerkLimitsRecommand, * boost::unit_test::tolerance(1e-3)) {
+  // Repeating the same command partway through a move, as a host
+  // sending commands at a fixed rate would, must not disturb the
+  // acceleration profile.
+  auto run = [](int recommand_cycles, bool continue_plan = false) {
+    Context ctx;
+    ctx.data.position = 4.0f;
+    ctx.data.velocity = 0.0f;
+    ctx.data.accel_limit = 2.0f;
+    ctx.data.velocity_limit = 1.5f;
+    ctx.data.jerk_limit = 5.0f;
+    ctx.set_position(0.0f);
+
+    std::vector<float> accels;
+    for (int i = 0; i < 10 * ctx.rate_hz && !ctx.status.trajectory_done; i++) {
+      if (recommand_cycles && (i % recommand_cycles) == 0) {
+        BldcServoCommandData next = ctx.data;
+        next.position = 4.0f;
+        next.position_relative_raw = MotorPosition::FloatToInt(4.0f);
+        next.jerk_trajectory_planned =
+            continue_plan &&
+            BldcServoPosition::ContinuesJerkPlan(next, ctx.data);
+        if (i > 0) {
+          BOOST_TEST(next.jerk_trajectory_planned == continue_plan);
+        }
+        ctx.data = next;
+      }
+      ctx.Call();
+      accels.push_back(ctx.status.control_acceleration);
+    }
+    return accels;
+  };
+
+  const auto reference = run(0);
+  const auto recommanded = run(400);
+
+  // Each replan starts from float state, so the end of the move may
+  // shift by a few cycles.
+  BOOST_TEST(std::abs(static_cast<double>(recommanded.size()) -
+                      static_cast<double>(reference.size())) <= 10.0);
+  const size_t size = std::min(reference.size(), recommanded.size());
+  double max_error = 0.0;
+  for (size_t i = 0; i < size; i++) {
+    max_error = std::max<double>(
+        max_error, std::abs(reference[i] - recommanded[i]));
+  }
+  BOOST_TEST(max_error < 0.01);
+
+  // When the repeated command is recognized, the original plan is
+  // followed exactly.
+  const auto continued = run(40, true);
+  BOOST_TEST(continued == reference, tt::per_element());
+}
+
+BOOST_AUTO_TEST_CASE(JerkLimitsContinuePlan) {
+  BldcServoCommandData current;
+  current.mode = BldcServoMode::kPosition;
+  current.position = 4.0f;
+  current.position_relative_raw = MotorPosition::FloatToInt(4.0f);
+  current.velocity = 0.0f;
+  current.accel_limit = 2.0f;
+  current.velocity_limit = 1.5f;
+  current.jerk_limit = 5.0f;
+  current.jerk_trajectory_planned = true;
+
+  BOOST_TEST(BldcServoPosition::ContinuesJerkPlan(current, current));
+
+  // Any change to the target or limits needs a new plan.
+  auto changed = [&](auto modify) {
+    BldcServoCommandData next = current;
+    modify(&next);
+    return !BldcServoPosition::ContinuesJerkPlan(next, current);
+  };
+  BOOST_TEST(changed([](auto* d) {
+        d->position_relative_raw = MotorPosition::FloatToInt(4.5f); }));
+  BOOST_TEST(changed([](auto* d) { d->position_relative_raw.reset(); }));
+  BOOST_TEST(changed([](auto* d) { d->velocity = 0.1f; }));
+  BOOST_TEST(changed([](auto* d) { d->velocity_limit = 1.0f; }));
+  BOOST_TEST(changed([](auto* d) { d->accel_limit = 3.0f; }));
+  BOOST_TEST(changed([](auto* d) { d->jerk_limit = 6.0f; }));
+  BOOST_TEST(changed([](auto* d) { d->mode = BldcServoMode::kStopped; }));
+
+  // As does anything the current plan is not being followed for.
+  BldcServoCommandData unplanned = current;
+  unplanned.jerk_trajectory_planned = false;
+  BOOST_TEST(!BldcServoPosition::ContinuesJerkPlan(current, unplanned));
+}
+
+BOOST_AUTO_TEST_CASE(JerkLimitsDisabled) {
+  // A jerk limit without an acceleration limit has no effect.
+  Context ctx;
+  ctx.data.position = 1.0f;
+  ctx.data.velocity = 0.0f;
+  ctx.data.velocity_limit = 2.0f;
+  ctx.data.jerk_limit = 5.0f;
+  ctx.set_position(0.0f);
+
+  ctx.Call();
+  BOOST_TEST(ctx.status.control_velocity.value() == 2.0f);
+  BOOST_TEST(ctx.status.control_acceleration == 0.0f);
+  BOOST_TEST(ctx.data.jerk_trajectory_planned == false);
+}
+
+BOOST_AUTO_TEST_CASE(AccelLimitAcceleration, * boost::unit_test::tolerance(1e-3)) {
+  // The acceleration limited planner reports its acceleration for
+  // use by the feedforward model.
+  Context ctx;
+  ctx.data.position = 1.0f;
+  ctx.data.velocity = 0.0f;
+  ctx.data.accel_limit = 2.0f;
+  ctx.data.velocity_limit = 0.5f;
+  ctx.set_position(0.0f);
+
+  ctx.Call();
+  BOOST_TEST(ctx.status.control_acceleration == 2.0);
+
+  // Cruising.
+  for (int i = 0; i < 20000; i++) { ctx.Call(); }
+  BOOST_TEST(ctx.status.control_velocity.value() == 0.5);
+  BOOST_TEST(ctx.status.control_acceleration == 0.0);
+
+  // Decelerating.
+  while (ctx.status.control_velocity.value() > 0.4f) { ctx.Call(); }
+  BOOST_TEST(ctx.status.control_acceleration == -2.0);
+
+  while (!ctx.status.trajectory_done) { ctx.Call(); }
+  ctx.Call();
+  BOOST_TEST(ctx.status.control_acceleration == 0.0);
+}
+
+BOOST_AUTO_TEST_CASE(ArrivalVelocityLimit, * boost::unit_test::tolerance(1e-4)) {
+  constexpr float kMax = 100.0f;
+  auto limit = [](float dx, float v0, float a, float t) {
+    return BldcServoPosition::ArrivalVelocityLimit(dx, v0, a, t, kMax);
+  };
+
+  // From rest: 0.382 accel, cruise, and decel covers 1.0 in 3s.
+  BOOST_TEST(limit(1.0f, 0.0f, 1.0f, 3.0f) == 0.381966f);
+  BOOST_TEST(limit(-1.0f, 0.0f, 1.0f, 3.0f) == 0.381966f);
+
+  // Without an acceleration limit, a constant velocity.
+  BOOST_TEST(limit(1.0f, 0.0f, NaN, 4.0f) == 0.25f);
+
+  // While already decelerating along the matching profile, the limit
+  // is the current velocity.
+  BOOST_TEST(limit(0.5f, 1.0f, 1.0f, 1.0f) == 1.0f);
+
+  // Too fast, so slow down to cruise.
+  BOOST_TEST(limit(2.0f, 2.0f, 1.0f, 4.0f) == 0.0f);
+  BOOST_TEST(limit(3.0f, 2.0f, 1.0f, 4.0f) == 0.5f);
+
+  // Late, impossible, or certain to overshoot.
+  BOOST_TEST(limit(1.0f, 0.0f, 1.0f, 0.0f) == kMax);
+  BOOST_TEST(limit(1.0f, 0.0f, 1.0f, 1.0f) == kMax);
+  BOOST_TEST(limit(0.1f, 2.0f, 1.0f, 4.0f) == kMax);
+}
+
+BOOST_AUTO_TEST_CASE(ArrivalTime, * boost::unit_test::tolerance(1e-3)) {
+  // Two axes with different distances to cover, commanded at
+  // different times, both arrive at the stated time.
+  for (const float distance : { 0.3f, 1.0f, -1.5f }) {
+    for (const int delay_cycles : { 0, 400 }) {
+      Context ctx;
+      ctx.rate_hz = 10000.0f;
+      ctx.set_position(0.0f);
+      ctx.data.position = NaN;
+      ctx.data.velocity = 0.0f;
+      ctx.data.accel_limit = 2.0f;
+      ctx.data.velocity_limit = ctx.config.max_velocity;
+
+      // The shared time starts just before wrapping.
+      ctx.status.shared_time_us = 0xffffff00u;
+
+      auto step = [&]() {
+        ctx.Call();
+        ctx.status.shared_time_us += 100;
+      };
+
+      for (int i = 0; i < delay_cycles; i++) { step(); }
+
+      ctx.data.position = distance;
+      ctx.data.arrival_time_us = 0xffffff00u + 2000000u;
+
+      int cycles = delay_cycles;
+      do {
+        step();
+        cycles++;
+      } while (!ctx.status.trajectory_done && cycles < 50000);
+
+      BOOST_TEST(ctx.from_raw(*ctx.status.control_position_raw) == distance);
+      // The final approach of the trajectory adds a few cycles.
+      BOOST_TEST(cycles * 1e-4 == 2.0, tt::tolerance(0.01));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(TrajectoryFuzzShort) {
+  // A short run of the randomized checks, to keep the unit tests
+  // fast.  Use trajectory_fuzz for longer runs.
+  for (uint32_t seed : { 0, 1, 2 }) {
+    BOOST_TEST_CONTEXT("seed " << seed) {
+      test::TrajectoryFuzz dut(seed);
+      const auto result = dut.Run(100000);
+      BOOST_TEST(result.failures == 0);
+      BOOST_TEST(result.first_failure == "");
+    }
+  }
+}
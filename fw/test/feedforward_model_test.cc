@@ -0,0 +1,64 @@
+// Copyright 2023 mjbots Robotic Systems, LLC.  info@mjbots.com
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fw/feedforward_model.h"
+
+#include <cmath>
+
+#include <boost/test/auto_unit_test.hpp>
+
+using namespace moteus;
+
+BOOST_AUTO_TEST_CASE(FeedforwardModelDefault) {
+  FeedforwardModel::Config config;
+  BOOST_TEST(FeedforwardModel::Calculate(config, 3.0f, 10.0f) == 0.0f);
+}
+
+BOOST_AUTO_TEST_CASE(FeedforwardModelTerms,
+                     * boost::unit_test::tolerance(1e-5f)) {
+  FeedforwardModel::Config config;
+
+  config.inertia = 0.01f;
+  BOOST_TEST(FeedforwardModel::Calculate(config, 0.0f, 2.0f) ==
+             static_cast<float>(0.01 * 2.0 * M_PI * 2.0));
+  BOOST_TEST(FeedforwardModel::Calculate(config, 0.0f, -2.0f) ==
+             static_cast<float>(-0.01 * 2.0 * M_PI * 2.0));
+  config.inertia = 0.0f;
+
+  config.viscous = 0.5f;
+  BOOST_TEST(FeedforwardModel::Calculate(config, -3.0f, 0.0f) == -1.5f);
+  config.viscous = 0.0f;
+
+  config.coulomb_Nm = 0.2f;
+  BOOST_TEST(FeedforwardModel::Calculate(config, 1.0f, 0.0f) == 0.2f);
+  BOOST_TEST(FeedforwardModel::Calculate(config, -1.0f, 0.0f) == -0.2f);
+  BOOST_TEST(FeedforwardModel::Calculate(config, 0.0f, 0.0f) == 0.0f);
+}
+
+BOOST_AUTO_TEST_CASE(FeedforwardModelCoulombSmoothing,
+                     * boost::unit_test::tolerance(1e-5f)) {
+  FeedforwardModel::Config config;
+  config.coulomb_Nm = 0.2f;
+  config.coulomb_velocity = 0.1f;
+
+  // Within the smoothing band, the friction is linear in velocity.
+  BOOST_TEST(FeedforwardModel::Calculate(config, 0.05f, 0.0f) == 0.1f);
+  BOOST_TEST(FeedforwardModel::Calculate(config, -0.025f, 0.0f) == -0.05f);
+  BOOST_TEST(FeedforwardModel::Calculate(config, 0.5f, 0.0f) == 0.2f);
+
+  // With no smoothing, it is just the sign.
+  config.coulomb_velocity = 0.0f;
+  BOOST_TEST(FeedforwardModel::Calculate(config, 0.001f, 0.0f) == 0.2f);
+  BOOST_TEST(FeedforwardModel::Calculate(config, -0.001f, 0.0f) == -0.2f);
+}
@@ -0,0 +1,171 @@
+// Copyright 2023 mjbots Robotic Systems, LLC.  info@mjbots.com
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fw/field_stream.h"
+
+#include <boost/test/auto_unit_test.hpp>
+
+using namespace moteus;
+
+namespace {
+struct Data {
+  float position = 1.5f;
+  uint16_t raw = 0x1234;
+  int8_t mode = -3;
+};
+
+struct Fixture {
+  Data data;
+  FieldStream::Field fields[3] = {
+    { "position", FieldStream::kFloat, &data.position },
+    { "raw", FieldStream::kUint16, &data.raw },
+    { "mode", FieldStream::kInt8, &data.mode },
+  };
+  FieldStream dut{fields, 3};
+
+  char buffer[FieldStream::kMaxRecordSize] = {};
+
+  size_t Poll(uint32_t now_ms) {
+    return dut.Poll(now_ms, buffer);
+  }
+
+  template <typename T>
+  T Get(size_t offset) const {
+    T result = {};
+    std::memcpy(&result, &buffer[offset], sizeof(result));
+    return result;
+  }
+};
+}
+
+BOOST_AUTO_TEST_CASE(FieldStreamTypeOf) {
+  enum class Small : int8_t { kValue };
+  static_assert(FieldStream::TypeOf<bool>() == FieldStream::kUint8);
+  static_assert(FieldStream::TypeOf<Small>() == FieldStream::kInt8);
+  static_assert(FieldStream::TypeOf<int16_t>() == FieldStream::kInt16);
+  static_assert(FieldStream::TypeOf<uint32_t>() == FieldStream::kUint32);
+  static_assert(FieldStream::TypeOf<float>() == FieldStream::kFloat);
+
+  int32_t value = 0;
+  const auto field = FieldStream::MakeField("value", &value);
+  BOOST_TEST(field.type == FieldStream::kInt32);
+  BOOST_TEST(field.data == &value);
+}
+
+BOOST_AUTO_TEST_CASE(FieldStreamEmpty) {
+  Fixture ctx;
+  BOOST_TEST(ctx.Poll(0) == 0);
+  BOOST_TEST(ctx.Poll(100) == 0);
+
+  BOOST_TEST(!ctx.dut.Subscribe("missing", 1));
+  BOOST_TEST(ctx.dut.size() == 0);
+}
+
+BOOST_AUTO_TEST_CASE(FieldStreamRates) {
+  Fixture ctx;
+  ctx.Poll(1000);
+
+  BOOST_TEST(ctx.dut.Subscribe("raw", 1));
+  BOOST_TEST(ctx.dut.Subscribe("position", 10));
+
+  // Everything is emitted the first time.
+  BOOST_TEST(ctx.Poll(1001) == FieldStream::kHeaderSize + 2 + 4);
+  BOOST_TEST(ctx.Get<uint32_t>(0) == 1001);
+  BOOST_TEST(ctx.Get<uint16_t>(4) == 0x0003);
+  BOOST_TEST(ctx.Get<uint16_t>(6) == 0x1234);
+  BOOST_TEST(ctx.Get<float>(8) == 1.5f);
+
+  // Then only the fields which are due.
+  ctx.data.raw = 0x4321;
+  for (uint32_t i = 1002; i < 1011; i++) {
+    BOOST_TEST(ctx.Poll(i) == FieldStream::kHeaderSize + 2);
+    BOOST_TEST(ctx.Get<uint16_t>(4) == 0x0001);
+    BOOST_TEST(ctx.Get<uint16_t>(6) == 0x4321);
+  }
+
+  ctx.data.position = -2.0f;
+  BOOST_TEST(ctx.Poll(1011) == FieldStream::kHeaderSize + 2 + 4);
+  BOOST_TEST(ctx.Get<float>(8) == -2.0f);
+
+  // Changing the rate keeps the position in the record.
+  BOOST_TEST(ctx.dut.Subscribe("raw", 5));
+  BOOST_TEST(ctx.dut.size() == 2);
+  BOOST_TEST(ctx.Poll(1012) == 0);
+  BOOST_TEST(ctx.Poll(1016) == FieldStream::kHeaderSize + 2);
+  BOOST_TEST(ctx.Get<uint16_t>(4) == 0x0001);
+}
+
+BOOST_AUTO_TEST_CASE(FieldStreamRewrite) {
+  Fixture ctx;
+  BOOST_TEST(ctx.dut.Subscribe("raw", 1));
+  BOOST_TEST(ctx.dut.Subscribe("mode", 2));
+
+  const uint16_t mask = ctx.dut.Schedule(1);
+  BOOST_TEST(mask == 0x0003);
+  BOOST_TEST(ctx.dut.Write(1, mask, ctx.buffer) ==
+             FieldStream::kHeaderSize + 2 + 1);
+  BOOST_TEST(ctx.Get<uint16_t>(6) == 0x1234);
+
+  // Writing again copies the current values, without changing what
+  // is due next.
+  ctx.data.raw = 0x5678;
+  BOOST_TEST(ctx.dut.Write(1, mask, ctx.buffer) ==
+             FieldStream::kHeaderSize + 2 + 1);
+  BOOST_TEST(ctx.Get<uint16_t>(6) == 0x5678);
+  BOOST_TEST(ctx.Get<int8_t>(8) == -3);
+
+  BOOST_TEST(ctx.dut.Schedule(2) == 0x0001);
+}
+
+BOOST_AUTO_TEST_CASE(FieldStreamUnsubscribe) {
+  Fixture ctx;
+
+  BOOST_TEST(ctx.dut.Subscribe("position", 1));
+  BOOST_TEST(ctx.dut.Subscribe("raw", 1));
+  BOOST_TEST(ctx.dut.Subscribe("mode", 1));
+  BOOST_TEST(ctx.Poll(1) == FieldStream::kHeaderSize + 4 + 2 + 1);
+
+  // Later subscriptions move up to take the place of removed ones.
+  BOOST_TEST(ctx.dut.Subscribe("raw", 0));
+  BOOST_TEST(ctx.dut.size() == 2);
+  BOOST_TEST(ctx.dut.subscription(1).field == &ctx.fields[2]);
+
+  BOOST_TEST(ctx.Poll(2) == FieldStream::kHeaderSize + 4 + 1);
+  BOOST_TEST(ctx.Get<uint16_t>(4) == 0x0003);
+  BOOST_TEST(ctx.Get<int8_t>(10) == -3);
+
+  ctx.dut.Clear();
+  BOOST_TEST(ctx.Poll(3) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(FieldStreamFull) {
+  Fixture ctx;
+  FieldStream::Field fields[FieldStream::kMaxSubscriptions + 1] = {};
+  const char* names[] = {
+    "a", "b", "c", "d", "e", "f", "g", "h", "i",
+    "j", "k", "l", "m", "n", "o", "p", "q",
+  };
+  for (size_t i = 0; i < FieldStream::kMaxSubscriptions + 1; i++) {
+    fields[i] = { names[i], FieldStream::kFloat, &ctx.data.position };
+  }
+  FieldStream dut(fields, FieldStream::kMaxSubscriptions + 1);
+
+  for (size_t i = 0; i < FieldStream::kMaxSubscriptions; i++) {
+    BOOST_TEST(dut.Subscribe(names[i], 1));
+  }
+  BOOST_TEST(!dut.Subscribe("q", 1));
+
+  BOOST_TEST(dut.Poll(1, ctx.buffer) == FieldStream::kMaxRecordSize);
+  BOOST_TEST(ctx.Get<uint16_t>(4) == 0xffff);
+}
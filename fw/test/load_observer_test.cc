@@ -0,0 +1,103 @@
+// Copyright 2023 mjbots Robotic Systems, LLC.  info@mjbots.com
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fw/load_observer.h"
+
+#include <cmath>
+
+#include <boost/test/auto_unit_test.hpp>
+
+using namespace moteus;
+
+namespace {
+constexpr float kPeriod = 1.0f / 30000.0f;
+constexpr int kCpr = 16384;
+
+// A rigid body with the given inertia and load, driven by a
+// sinusoidal motor torque, and measured with a quantized encoder.
+struct Simulation {
+  double inertia = 0.001;
+  double load_Nm = 0.0;
+
+  double time = 0.0;
+  double position = 0.0;
+  double velocity = 0.0;
+
+  int64_t last_counts = 0;
+
+  LoadObserver::Config config;
+  LoadObserver::State state;
+  LoadObserver dut{&config, &state};
+
+  Simulation() {
+    config.bandwidth_hz = 50.0f;
+    config.inertia = inertia;
+    dut.UpdateConfig(kPeriod);
+    dut.Reset(0.0f);
+  }
+
+  void Step(int count) {
+    for (int i = 0; i < count; i++) {
+      time += kPeriod;
+      const double torque_Nm = 0.2 * std::sin(2.0 * M_PI * 3.0 * time);
+
+      const double acceleration =
+          (torque_Nm - load_Nm) / (inertia * 2.0 * M_PI);
+      velocity += acceleration * kPeriod;
+      position += velocity * kPeriod;
+
+      const int64_t counts = static_cast<int64_t>(std::floor(position * kCpr));
+      dut.Update(static_cast<float>(counts - last_counts) / kCpr, torque_Nm);
+      last_counts = counts;
+    }
+  }
+};
+}
+
+BOOST_AUTO_TEST_CASE(LoadObserverDisabled) {
+  LoadObserver::Config config;
+  LoadObserver::State state;
+  LoadObserver dut{&config, &state};
+
+  dut.UpdateConfig(kPeriod);
+  BOOST_TEST(!dut.enabled());
+
+  config.bandwidth_hz = 50.0f;
+  dut.UpdateConfig(kPeriod);
+  BOOST_TEST(!dut.enabled());
+
+  config.inertia = 0.001f;
+  dut.UpdateConfig(kPeriod);
+  BOOST_TEST(dut.enabled());
+}
+
+BOOST_AUTO_TEST_CASE(LoadObserverTracking) {
+  Simulation ctx;
+
+  // With no load, the estimate should settle near zero and the
+  // velocity should follow the plant.
+  ctx.Step(15000);
+  BOOST_TEST(std::abs(ctx.state.load_Nm) < 0.01f);
+  BOOST_TEST(std::abs(ctx.state.velocity - ctx.velocity) < 0.02);
+
+  // Now apply a step in load.  It should be identified within a few
+  // observer time constants.
+  ctx.load_Nm = 0.1;
+  ctx.Step(600);
+  BOOST_TEST(std::abs(ctx.state.load_Nm - 0.1f) < 0.02f);
+
+  ctx.Step(3000);
+  BOOST_TEST(std::abs(ctx.state.load_Nm - 0.1f) < 0.005f);
+  BOOST_TEST(std::abs(ctx.state.velocity - ctx.velocity) < 0.02);
+}
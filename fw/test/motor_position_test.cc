@@ -1313,3 +1313,75 @@ BOOST_AUTO_TEST_CASE(MotorPositionDrift) {
     }
   }
 }
+
+namespace {
+// Drive source 0 with a noisy encoder whose velocity is v0 + amplitude *
+// sin(2 pi freq t), and return the RMS velocity error in revolutions
+// per second once the filter has settled.
+double RunPll(float low_hz, float high_hz, float high_speed,
+              double v0, double amplitude, double freq, double noise) {
+  Context ctx;
+  auto& source = ctx.dut.config()->sources[0];
+  source.pll_filter_hz = low_hz;
+  source.pll_filter_high_hz = high_hz;
+  source.pll_filter_high_speed = high_speed;
+  ctx.pcf.persistent_config.Load();
+
+  const double cpr = source.cpr;
+
+  boost::random::mt19937 rng;
+  boost::random::normal_distribution dist(0.0, noise);
+
+  ctx.aux1_status.spi.active = true;
+
+  double position = 0.0;
+  double sum_squared_error = 0.0;
+  int count = 0;
+  constexpr int kSteps = 20000;
+  for (int i = 0; i < kSteps; i++) {
+    const double t = i * kDt;
+    const double velocity = v0 + amplitude * std::sin(2 * M_PI * freq * t);
+    position += velocity * kDt;
+
+    const int64_t raw =
+        static_cast<int64_t>(std::round(position * cpr + dist(rng)));
+    ctx.aux1_status.spi.value = ((raw % 16384) + 16384) % 16384;
+    ctx.aux1_status.spi.nonce++;
+
+    ctx.dut.ISR_Update(kDt);
+
+    if (i >= kSteps / 2) {
+      const double error =
+          ctx.dut.status().sources[0].velocity / cpr - velocity;
+      sum_squared_error += error * error;
+      count++;
+    }
+  }
+
+  return std::sqrt(sum_squared_error / count);
+}
+}
+
+BOOST_AUTO_TEST_CASE(MotorPositionPllSpeedSchedule) {
+  for (double noise : { 1.0, 4.0 }) {
+    BOOST_TEST_CONTEXT("noise " << noise) {
+      // At low speed, noise dominates, and the scheduled filter
+      // should be nearly as quiet as a fixed low bandwidth.
+      const double slow_low = RunPll(100, 0, 0, 1, 0, 0, noise);
+      const double slow_high = RunPll(1000, 0, 0, 1, 0, 0, noise);
+      const double slow_scheduled = RunPll(100, 1000, 20, 1, 0, 0, noise);
+
+      BOOST_TEST(slow_scheduled < 2.0 * slow_low);
+      BOOST_TEST(slow_scheduled < 0.1 * slow_high);
+
+      // At high speed with a changing velocity, lag dominates, and
+      // the scheduled filter should track like the high bandwidth.
+      const double fast_low = RunPll(100, 0, 0, 30, 10, 50, noise);
+      const double fast_high = RunPll(1000, 0, 0, 30, 10, 50, noise);
+      const double fast_scheduled = RunPll(100, 1000, 20, 30, 10, 50, noise);
+
+      BOOST_TEST(fast_scheduled < 1.2 * fast_high);
+      BOOST_TEST(fast_scheduled < 0.25 * fast_low);
+    }
+  }
+}
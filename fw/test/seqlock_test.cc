@@ -0,0 +1,76 @@
+// Copyright 2023 mjbots Robotic Systems, LLC.  info@mjbots.com
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fw/seqlock.h"
+
+#include <functional>
+
+#include <boost/test/auto_unit_test.hpp>
+
+using namespace moteus;
+
+namespace {
+// Invoked in the middle of copying a Sample, to simulate an ISR
+// which pre-empts the reader.
+std::function<void ()> g_interrupt;
+
+struct Sample {
+  int a = 0;
+  int b = 0;
+
+  Sample() {}
+  Sample(int a_in, int b_in) : a(a_in), b(b_in) {}
+
+  Sample(const Sample& rhs) : a(rhs.a) {
+    if (g_interrupt) {
+      auto copy = g_interrupt;
+      g_interrupt = {};
+      copy();
+    }
+    b = rhs.b;
+  }
+
+  Sample& operator=(const Sample&) = default;
+};
+}
+
+BOOST_AUTO_TEST_CASE(SeqLockBasic) {
+  SeqLock<Sample> dut;
+  BOOST_TEST(dut.sequence() == 0);
+
+  dut.Write(Sample(1, 1));
+  BOOST_TEST(dut.sequence() == 2);
+
+  const auto result = dut.Read();
+  BOOST_TEST(result.a == 1);
+  BOOST_TEST(result.b == 1);
+}
+
+BOOST_AUTO_TEST_CASE(SeqLockInterruptedRead) {
+  SeqLock<Sample> dut;
+  dut.Write(Sample(1, 1));
+
+  int interrupt_count = 0;
+  g_interrupt = [&]() {
+    interrupt_count++;
+    dut.Write(Sample(2, 2));
+  };
+
+  // Without the retry, this would return a torn {1, 2}.
+  const auto result = dut.Read();
+  BOOST_TEST(interrupt_count == 1);
+  BOOST_TEST(result.a == 2);
+  BOOST_TEST(result.b == 2);
+  BOOST_TEST(dut.sequence() == 4);
+}
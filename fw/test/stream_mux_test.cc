@@ -0,0 +1,184 @@
+// Copyright 2023 mjbots Robotic Systems, LLC.  info@mjbots.com
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fw/stream_mux.h"
+
+#include <string>
+
+#include <boost/test/auto_unit_test.hpp>
+
+using namespace moteus;
+
+namespace {
+class FakeStream : public mjlib::micro::AsyncStream {
+ public:
+  void AsyncReadSome(const mjlib::base::string_span& buffer,
+                     const mjlib::micro::SizeCallback& callback) override {
+    BOOST_TEST(!read_callback_);
+    read_buffer_ = buffer;
+    read_callback_ = callback;
+  }
+
+  void AsyncWriteSome(const std::string_view& data,
+                      const mjlib::micro::SizeCallback& callback) override {
+    written += std::string(data);
+    callback(mjlib::micro::error_code(), data.size());
+  }
+
+  bool read_pending() const { return !!read_callback_; }
+
+  void Receive(const std::string& data) {
+    BOOST_TEST_REQUIRE(read_pending());
+    BOOST_TEST_REQUIRE(data.size() <= static_cast<size_t>(read_buffer_.size()));
+    std::memcpy(read_buffer_.data(), data.data(), data.size());
+    auto copy = read_callback_;
+    read_callback_ = {};
+    copy(mjlib::micro::error_code(), data.size());
+  }
+
+  std::string written;
+
+ private:
+  mjlib::base::string_span read_buffer_;
+  mjlib::micro::SizeCallback read_callback_;
+};
+
+struct Reader {
+  char buffer[8] = {};
+  std::string received;
+  int count = 0;
+
+  template <typename Stream>
+  void Start(Stream* stream) {
+    stream->AsyncReadSome(
+        mjlib::base::string_span(buffer, sizeof(buffer)),
+        [this](const mjlib::micro::error_code& ec, size_t size) {
+          BOOST_TEST(!ec);
+          received += std::string(buffer, size);
+          count++;
+        });
+  }
+};
+}
+
+BOOST_AUTO_TEST_CASE(StreamMuxBasic) {
+  FakeStream can;
+  FakeStream rs485;
+  StreamMux<2> dut({&can, &rs485});
+
+  Reader reader;
+  reader.Start(&dut);
+  BOOST_TEST(can.read_pending());
+  BOOST_TEST(rs485.read_pending());
+  BOOST_TEST(reader.count == 0);
+
+  // Replies go to the first stream until something is received.
+  dut.AsyncWriteSome("a", [](const mjlib::micro::error_code&, size_t) {});
+  BOOST_TEST(can.written == "a");
+  BOOST_TEST(rs485.written == "");
+
+  rs485.Receive("tel\n");
+  BOOST_TEST(reader.count == 1);
+  BOOST_TEST(reader.received == "tel\n");
+  BOOST_TEST(dut.active() == 1);
+
+  dut.AsyncWriteSome("b", [](const mjlib::micro::error_code&, size_t) {});
+  BOOST_TEST(can.written == "a");
+  BOOST_TEST(rs485.written == "b");
+
+  // The read on the stream which did not receive anything is still
+  // outstanding, and is not started a second time.
+  reader.Start(&dut);
+  BOOST_TEST(can.read_pending());
+  BOOST_TEST(rs485.read_pending());
+
+  can.Receive("conf");
+  BOOST_TEST(reader.count == 2);
+  BOOST_TEST(reader.received == "tel\nconf");
+  BOOST_TEST(dut.active() == 0);
+
+  dut.AsyncWriteSome("c", [](const mjlib::micro::error_code&, size_t) {});
+  BOOST_TEST(can.written == "ac");
+  BOOST_TEST(rs485.written == "b");
+}
+
+BOOST_AUTO_TEST_CASE(StreamMuxBuffered) {
+  FakeStream can;
+  FakeStream rs485;
+  StreamMux<2> dut({&can, &rs485});
+
+  Reader reader;
+  reader.Start(&dut);
+
+  // Data larger than the reader's buffer is delivered over several
+  // reads, and data which arrives on the other stream while no read
+  // is outstanding waits its turn.
+  can.Receive("0123456789abc");
+  BOOST_TEST(reader.received == "01234567");
+  BOOST_TEST(!can.read_pending());
+
+  rs485.Receive("xyz");
+  BOOST_TEST(reader.count == 1);
+
+  reader.Start(&dut);
+  BOOST_TEST(reader.received == "0123456789abc");
+  BOOST_TEST(dut.active() == 0);
+
+  reader.Start(&dut);
+  BOOST_TEST(reader.received == "0123456789abcxyz");
+  BOOST_TEST(dut.active() == 1);
+
+  // Now both streams are read again.
+  reader.Start(&dut);
+  BOOST_TEST(can.read_pending());
+  BOOST_TEST(rs485.read_pending());
+  BOOST_TEST(reader.count == 3);
+}
+
+BOOST_AUTO_TEST_CASE(StreamMuxMissing) {
+  FakeStream rs485;
+  StreamMux<2> dut({nullptr, &rs485});
+
+  // With no stream to reply on, writes are discarded.
+  size_t written = 0;
+  dut.AsyncWriteSome("abc", [&](const mjlib::micro::error_code&, size_t size) {
+      written = size;
+    });
+  BOOST_TEST(written == 3);
+
+  Reader reader;
+  reader.Start(&dut);
+  rs485.Receive("abc");
+  BOOST_TEST(reader.received == "abc");
+
+  dut.AsyncWriteSome("d", [](const mjlib::micro::error_code&, size_t) {});
+  BOOST_TEST(rs485.written == "d");
+}
+
+BOOST_AUTO_TEST_CASE(StreamMuxSetStream) {
+  FakeStream can;
+  StreamMux<2> dut({&can, nullptr});
+
+  Reader reader;
+  reader.Start(&dut);
+
+  // A stream added while a read is outstanding is read immediately.
+  FakeStream rs485;
+  dut.SetStream(1, &rs485);
+  BOOST_TEST(rs485.read_pending());
+
+  rs485.Receive("abc");
+  BOOST_TEST(reader.received == "abc");
+  BOOST_TEST(dut.active() == 1);
+}
@@ -0,0 +1,84 @@
+// Copyright 2023 mjbots Robotic Systems, LLC.  info@mjbots.com
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fw/task_scheduler.h"
+
+#include <string>
+
+#include <boost/test/auto_unit_test.hpp>
+
+using namespace moteus;
+
+namespace {
+uint32_t g_cycles = 0;
+
+uint32_t GetCycles() {
+  return g_cycles;
+}
+}
+
+BOOST_AUTO_TEST_CASE(TaskSchedulerOrder) {
+  std::string log;
+
+  TaskScheduler dut{GetCycles};
+  using T = TaskScheduler::Type;
+  dut.Register(TaskName::kController, T::kPoll, [&]() { log += "a"; });
+  dut.Register(TaskName::kCan, T::kUrgent, [&]() { log += "u"; });
+  dut.Register(TaskName::kTelemetry, T::kMillisecond, [&]() { log += "m"; });
+  dut.Register(TaskName::kMultiplex, T::kPoll, [&]() { log += "b"; });
+
+  BOOST_TEST(dut.size() == 4);
+  BOOST_TEST((dut.name(2) == TaskName::kTelemetry));
+
+  dut.Poll();
+  BOOST_TEST(log == "uaubu");
+
+  log = "";
+  dut.PollMillisecond();
+  BOOST_TEST(log == "umu");
+}
+
+BOOST_AUTO_TEST_CASE(TaskSchedulerStats) {
+  TaskScheduler dut{GetCycles};
+  using T = TaskScheduler::Type;
+
+  uint32_t next_duration = 0;
+  const auto a = dut.Register(
+      TaskName::kController, T::kPoll, [&]() { g_cycles += next_duration; });
+  const auto u = dut.Register(
+      TaskName::kCan, T::kUrgent, [&]() { g_cycles += 3; });
+
+  next_duration = 10;
+  dut.Poll();
+  next_duration = 30;
+  dut.Poll();
+
+  BOOST_TEST(dut.stats(a).count == 2);
+  BOOST_TEST(dut.stats(a).total_cycles == 40);
+  BOOST_TEST(dut.stats(a).max_cycles == 30);
+
+  BOOST_TEST(dut.stats(u).count == 4);
+  BOOST_TEST(dut.stats(u).total_cycles == 12);
+  BOOST_TEST(dut.stats(u).max_cycles == 3);
+
+  dut.ResetStats();
+  BOOST_TEST(dut.stats(a).count == 0);
+  BOOST_TEST(dut.stats(a).max_cycles == 0);
+
+  // The cycle counter is free running, so wrapping must be handled.
+  g_cycles = 0xfffffffb;
+  next_duration = 10;
+  dut.Poll();
+  BOOST_TEST(dut.stats(a).max_cycles == 10);
+}
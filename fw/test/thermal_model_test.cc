@@ -0,0 +1,107 @@
+// Copyright 2023 mjbots Robotic Systems, LLC.  info@mjbots.com
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fw/thermal_model.h"
+
+#include <cmath>
+
+#include <boost/test/auto_unit_test.hpp>
+
+using namespace moteus;
+
+BOOST_AUTO_TEST_CASE(ThermalModelTimeToReach,
+                     * boost::unit_test::tolerance(1e-4f)) {
+  BOOST_TEST(ThermalModel::TimeToReach(20.0f, 120.0f, 70.0f, 10.0f) ==
+             static_cast<float>(10.0 * std::log(2.0)));
+
+  // Already there.
+  BOOST_TEST(ThermalModel::TimeToReach(80.0f, 120.0f, 70.0f, 10.0f) == 0.0f);
+
+  // Never gets there.
+  BOOST_TEST(std::isinf(
+                 ThermalModel::TimeToReach(20.0f, 60.0f, 70.0f, 10.0f)));
+  BOOST_TEST(std::isinf(
+                 ThermalModel::TimeToReach(20.0f, 70.0f, 70.0f, 10.0f)));
+}
+
+BOOST_AUTO_TEST_CASE(ThermalModelDisabled) {
+  ThermalModel::Config config;
+  ThermalModel::State state;
+  ThermalModel dut{&config, &state};
+  dut.UpdateConfig(0.01f);
+
+  ThermalModel::Inputs inputs;
+  inputs.current2_A2 = 10000.0f;
+  inputs.motor_resistance_ohm = 0.1f;
+  inputs.fet_temp_C = 30.0f;
+  inputs.fet_derate_C = 50.0f;
+  dut.Update(inputs);
+
+  BOOST_TEST(std::isinf(state.time_to_derate_s));
+}
+
+BOOST_AUTO_TEST_CASE(ThermalModelPrediction) {
+  constexpr float kPeriod = 0.01f;
+  constexpr float kAmbient = 25.0f;
+  constexpr float kDerate = 80.0f;
+
+  ThermalModel::Config config;
+  config.fet_resistance_ohm = 0.005f;
+  config.fet_thermal_resistance = 2.0f;
+  config.fet_time_constant_s = 20.0f;
+  config.motor_thermal_resistance = 1.0f;
+  config.motor_time_constant_s = 60.0f;
+
+  ThermalModel::State state;
+  ThermalModel dut{&config, &state};
+  dut.UpdateConfig(kPeriod);
+
+  // 30A gives a steady rise of 13.5C for the FETs and 27C for the
+  // motor, neither of which reaches the derating temperature.
+  ThermalModel::Inputs inputs;
+  inputs.current2_A2 = 30.0f * 30.0f;
+  inputs.motor_resistance_ohm = 0.02f;
+  inputs.fet_derate_C = kDerate;
+  inputs.motor_derate_C = kDerate;
+
+  // The measured temperatures follow the same model as the
+  // prediction.
+  auto step = [&]() {
+    inputs.fet_temp_C = kAmbient + state.fet_rise_C;
+    inputs.motor_temp_C = kAmbient + state.motor_rise_C;
+    dut.Update(inputs);
+  };
+
+  for (int i = 0; i < 1000; i++) { step(); }
+  BOOST_TEST(std::isinf(state.time_to_derate_s));
+  BOOST_TEST(std::abs(state.fet_rise_C - 13.5f * (1.0f - std::exp(-0.5f))) <
+             0.05f);
+
+  // At 90A both settle well above the derating temperature.
+  inputs.current2_A2 = 90.0f * 90.0f;
+  step();
+  const float predicted_s = state.time_to_derate_s;
+  BOOST_TEST(std::isfinite(predicted_s));
+
+  int cycles = 0;
+  while (state.time_to_derate_s > 0.0f && cycles < 100000) {
+    step();
+    cycles++;
+  }
+  const float actual_s = cycles * kPeriod;
+  BOOST_TEST(std::abs(actual_s - predicted_s) < 0.05f);
+
+  // Once there, derating is immediate.
+  BOOST_TEST(state.time_to_derate_s == 0.0f);
+}
@@ -0,0 +1,451 @@
+// Copyright 2023 mjbots Robotic Systems, LLC.  info@mjbots.com
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <string>
+
+#include <fmt/format.h>
+
+#include "fw/bldc_servo_position.h"
+
+namespace moteus {
+namespace test {
+
+/// Runs BldcServoPosition::UpdateCommand against randomly generated
+/// commands, with a plant that tracks the control position exactly,
+/// and checks invariants of the result on every cycle.
+class TrajectoryFuzz {
+ public:
+  struct Result {
+    uint64_t cycles = 0;
+    uint64_t episodes = 0;
+    uint64_t failures = 0;
+
+    // The largest difference between the integrated control position
+    // and the ideal position for a constant velocity, in revolutions.
+    double max_drift = 0.0;
+
+    std::string first_failure;
+  };
+
+  TrajectoryFuzz(uint32_t seed) : rng_(seed) {}
+
+  /// Run random episodes until at least @p cycles have been simulated.
+  Result Run(uint64_t cycles) {
+    Result result;
+    while (result.cycles < cycles) {
+      // Moves are much shorter than the other episodes, so run them
+      // more often.
+      switch (std::uniform_int_distribution<int>(0, 7)(rng_)) {
+        case 0: { RunDrift(&result); break; }
+        case 1: { RunBounds(&result); break; }
+        case 2:
+        case 3:
+        case 4: { RunJerkMove(&result); break; }
+        default: { RunMove(&result); break; }
+      }
+      result.episodes++;
+    }
+    return result;
+  }
+
+ private:
+  static constexpr float NaN = std::numeric_limits<float>::quiet_NaN();
+
+  struct Context {
+    BldcServoStatus status;
+    BldcServoConfig config;
+    BldcServoPositionConfig position_config;
+    MotorPosition::Status position;
+    BldcServoCommandData data;
+    float rate_hz = 30000.0f;
+
+    Context() {
+      position_config.position_min = NaN;
+      position_config.position_max = NaN;
+      data.mode = BldcServoMode::kPosition;
+      data.position = NaN;
+      data.velocity = 0.0f;
+    }
+
+    void SetPosition(int64_t raw) {
+      position.position_relative_raw = raw;
+      position.position_raw = raw;
+      position.position_relative = MotorPosition::IntToFloat(raw);
+      position.position = position.position_relative;
+    }
+
+    void SetTarget(int64_t raw) {
+      data.position = MotorPosition::IntToFloat(raw);
+      data.position_relative_raw = raw;
+    }
+
+    float Step() {
+      const float result = BldcServoPosition::UpdateCommand(
+          &status, &config, &position_config, &position, 0,
+          rate_hz, &data, data.velocity);
+
+      // Our plant tracks the control position perfectly.
+      SetPosition(*status.control_position_raw);
+      return result;
+    }
+  };
+
+  static int64_t ToRaw(double revolutions) {
+    return static_cast<int64_t>(revolutions * kRawScale);
+  }
+
+  static double FromRaw(int64_t raw) {
+    return static_cast<double>(raw) / kRawScale;
+  }
+
+  // The difference between two positions, allowing for the integral
+  // position to wrap.
+  static int64_t Delta(int64_t a, int64_t b) {
+    return static_cast<int64_t>(
+        static_cast<uint64_t>(a) - static_cast<uint64_t>(b));
+  }
+
+  float Uniform(float min, float max) {
+    return std::uniform_real_distribution<float>(min, max)(rng_);
+  }
+
+  bool Chance(float probability) {
+    return Uniform(0.0f, 1.0f) < probability;
+  }
+
+  uint64_t Cycles(uint64_t max) {
+    return std::uniform_int_distribution<uint64_t>(1, max)(rng_);
+  }
+
+  float RandomRate() {
+    const float rates[] = { 15000.0f, 20000.0f, 30000.0f, 40000.0f };
+    return rates[std::uniform_int_distribution<int>(0, 3)(rng_)];
+  }
+
+  // A start position anywhere within the integral range, sometimes
+  // near the edges so that wrapping is exercised.
+  int64_t RandomStart() {
+    if (Chance(0.3f)) {
+      return ToRaw(std::copysign(32767.9f, Uniform(-1.0f, 1.0f)));
+    }
+    return ToRaw(Uniform(-32000.0f, 32000.0f));
+  }
+
+  void Fail(Result* result, const std::string& message) {
+    if (result->failures == 0) {
+      result->first_failure = message;
+    }
+    result->failures++;
+  }
+
+  // Command a constant velocity with no limits and verify that the
+  // integrated position matches the ideal, including across the
+  // integral position wrap.
+  void RunDrift(Result* result) {
+    Context ctx;
+    ctx.rate_hz = RandomRate();
+    const int64_t start = RandomStart();
+    ctx.SetPosition(start);
+    ctx.data.velocity = Uniform(-100.0f, 100.0f);
+
+    const uint64_t count = Cycles(2000000);
+    const double step = static_cast<double>(ctx.data.velocity) / ctx.rate_hz;
+
+    double travel = 0.0;
+    int64_t last = start;
+    for (uint64_t i = 0; i < count; i++) {
+      ctx.Step();
+      const int64_t now = *ctx.status.control_position_raw;
+      travel += FromRaw(Delta(now, last));
+      last = now;
+    }
+    result->cycles += count;
+
+    // The first cycle starts from the current velocity, which is 0.
+    // After that, each cycle may be off by the float rounding of the
+    // step and the truncation to the integral resolution.
+    const double drift = std::abs(travel - step * (count - 1));
+    const double allowed =
+        count * (std::abs(step) * std::ldexp(1.0, -22) + std::ldexp(1.0, -32));
+    result->max_drift = std::max(result->max_drift, drift);
+    if (drift > allowed) {
+      Fail(result, fmt::format(
+               "drift: v={} rate={} cycles={} drift={} allowed={}",
+               ctx.data.velocity, ctx.rate_hz, count, drift, allowed));
+    }
+  }
+
+  // Command a move with acceleration and possibly velocity limits,
+  // and verify the limits are obeyed and the move completes.  The
+  // target may itself be moving.
+  void RunMove(Result* result) {
+    Context ctx;
+    ctx.rate_hz = RandomRate();
+    const float period_s = 1.0f / ctx.rate_hz;
+
+    const int64_t start = ToRaw(Uniform(-1000.0f, 1000.0f));
+    ctx.SetPosition(start);
+
+    const float accel = Uniform(1.0f, 2000.0f);
+    const float velocity_limit = Chance(0.2f) ? NaN : Uniform(0.5f, 200.0f);
+    const float max_velocity =
+        std::isnan(velocity_limit) ? 200.0f : velocity_limit;
+
+    // Start out moving within our limits.
+    const float v0 = Chance(0.5f) ? 0.0f : Uniform(-max_velocity, max_velocity);
+    ctx.status.velocity_filt = v0;
+
+    const float dx = Uniform(-200.0f, 200.0f);
+    const float vf =
+        Chance(0.3f) ? Uniform(-0.5f * max_velocity, 0.5f * max_velocity) : 0.0f;
+    ctx.data.accel_limit = accel;
+    ctx.data.velocity_limit = velocity_limit;
+    ctx.data.velocity = vf;
+    ctx.SetTarget(start + ToRaw(dx));
+
+    // Working in the frame of the target: the time to stop, then
+    // cover the distance accelerating and decelerating with no
+    // velocity limit, or cruising at the limit.
+    const float closing_velocity = max_velocity - std::abs(vf);
+    const float stop_s = std::abs(v0 - vf) / accel;
+    const float travel = std::abs(dx) + 0.5f * accel * stop_s * stop_s;
+    const float bang_bang_s = 2.0f * std::sqrt(travel / accel);
+    const float cruise_s =
+        travel / closing_velocity + max_velocity / accel;
+    const float bound_s =
+        stop_s + (std::isnan(velocity_limit) ?
+                  bang_bang_s : std::max(bang_bang_s, cruise_s));
+    const uint64_t max_cycles =
+        static_cast<uint64_t>(1.2f * bound_s * ctx.rate_hz) + 100;
+
+    const std::string description = fmt::format(
+        "move: rate={} a={} vlim={} v0={} dx={} vf={}",
+        ctx.rate_hz, accel, velocity_limit, v0, dx, vf);
+
+    // Small velocities are captured as zero.
+    float last_velocity =
+        (std::abs(v0) < ctx.config.velocity_zero_capture_threshold) ?
+        0.0f : v0;
+    int64_t target = 0;
+    uint64_t i = 0;
+    for (; i < max_cycles; i++) {
+      target = *ctx.data.position_relative_raw;
+      ctx.Step();
+      const float velocity = *ctx.status.control_velocity;
+
+      if (!std::isfinite(velocity)) {
+        Fail(result, description + " non-finite velocity");
+        break;
+      }
+      // On completion the velocity may snap to the target by up to
+      // an additional half cycle of acceleration.
+      if (std::abs(velocity - last_velocity) >
+          accel * period_s * 1.501f + 1e-5f) {
+        Fail(result, fmt::format(
+                 "{} accel exceeded at cycle {}: {} -> {}",
+                 description, i, last_velocity, velocity));
+        break;
+      }
+      if (!std::isnan(velocity_limit) &&
+          std::abs(velocity) > velocity_limit * 1.0001f) {
+        Fail(result, fmt::format(
+                 "{} velocity limit exceeded at cycle {}: {}",
+                 description, i, velocity));
+        break;
+      }
+      last_velocity = velocity;
+
+      if (ctx.status.trajectory_done) { break; }
+    }
+    result->cycles += i;
+
+    if (!ctx.status.trajectory_done) {
+      Fail(result, description + " did not complete");
+      return;
+    }
+
+    const double error =
+        FromRaw(Delta(*ctx.status.control_position_raw, target));
+    // A moving target is considered reached when it is within 10
+    // cycles of travel.
+    if (std::abs(error) > 1e-3 + 11.0f * std::abs(vf) * period_s) {
+      Fail(result, fmt::format("{} final error {}", description, error));
+    }
+  }
+
+  // Command a move with jerk, acceleration, and possibly velocity
+  // limits, and verify that all are obeyed and the move completes
+  // within the target tolerance.
+  void RunJerkMove(Result* result) {
+    Context ctx;
+    ctx.rate_hz = RandomRate();
+    const float period_s = 1.0f / ctx.rate_hz;
+
+    const int64_t start = ToRaw(Uniform(-1000.0f, 1000.0f));
+    ctx.SetPosition(start);
+
+    const float accel = Uniform(1.0f, 2000.0f);
+    const float jerk = accel * Uniform(0.5f, 200.0f);
+    const float velocity_limit = Chance(0.2f) ? NaN : Uniform(0.5f, 200.0f);
+    const float max_velocity =
+        std::isnan(velocity_limit) ? 200.0f : velocity_limit;
+
+    const float v0 = Chance(0.5f) ? 0.0f : Uniform(-max_velocity, max_velocity);
+    ctx.status.velocity_filt = v0;
+
+    const float dx = Uniform(-200.0f, 200.0f);
+    const float vf =
+        Chance(0.3f) ? Uniform(-0.5f * max_velocity, 0.5f * max_velocity) : 0.0f;
+    ctx.data.accel_limit = accel;
+    ctx.data.jerk_limit = jerk;
+    ctx.data.velocity_limit = velocity_limit;
+    ctx.data.velocity = vf;
+    ctx.SetTarget(start + ToRaw(dx));
+
+    // The same bound as for an acceleration limited move, where each
+    // of the stop, speed up, and slow down phases may take up to an
+    // additional accel / jerk.  The stop also covers more distance,
+    // which is accounted for by the larger margin.
+    const float closing_velocity = max_velocity - std::abs(vf);
+    const float ramp_s = accel / jerk;
+    const float stop_s = std::abs(v0 - vf) / accel + ramp_s;
+    const float travel = std::abs(dx) + std::abs(v0 - vf) * stop_s;
+    const float bang_bang_s = 2.0f * std::sqrt(travel / accel);
+    const float cruise_s =
+        travel / closing_velocity + max_velocity / accel;
+    const float bound_s =
+        stop_s + 2.0f * ramp_s +
+        (std::isnan(velocity_limit) ?
+         bang_bang_s : std::max(bang_bang_s, cruise_s));
+    const uint64_t max_cycles =
+        static_cast<uint64_t>(1.5f * bound_s * ctx.rate_hz) + 100;
+
+    const std::string description = fmt::format(
+        "jerk move: rate={} j={} a={} vlim={} v0={} dx={} vf={}",
+        ctx.rate_hz, jerk, accel, velocity_limit, v0, dx, vf);
+
+    float last_velocity =
+        (std::abs(v0) < ctx.config.velocity_zero_capture_threshold) ?
+        0.0f : v0;
+    float last_accel = 0.0f;
+    int64_t target = 0;
+    uint64_t i = 0;
+    for (; i < max_cycles; i++) {
+      target = *ctx.data.position_relative_raw;
+      ctx.Step();
+      const float velocity = *ctx.status.control_velocity;
+      const float acceleration = ctx.status.control_acceleration;
+
+      if (!std::isfinite(velocity) || !std::isfinite(acceleration)) {
+        Fail(result, description + " non-finite state");
+        break;
+      }
+      // The velocity is evaluated from the time within the current
+      // segment and summed with the target velocity, so may be off by
+      // a few units of float precision in either.
+      const float elapsed_s = i * period_s;
+      if (std::abs(acceleration) > accel * 1.001f ||
+          std::abs(velocity - last_velocity) >
+          accel * period_s * 1.001f + 1e-5f +
+          2.4e-7f * (accel * elapsed_s + std::abs(velocity))) {
+        Fail(result, fmt::format(
+                 "{} accel exceeded at cycle {}: {} {} -> {}",
+                 description, i, acceleration, last_velocity, velocity));
+        break;
+      }
+      if (std::abs(acceleration - last_accel) >
+          jerk * period_s * 1.001f + accel * 1e-5f) {
+        Fail(result, fmt::format(
+                 "{} jerk exceeded at cycle {}: {} -> {}",
+                 description, i, last_accel, acceleration));
+        break;
+      }
+      if (!std::isnan(velocity_limit) &&
+          std::abs(velocity) > velocity_limit * 1.0001f) {
+        Fail(result, fmt::format(
+                 "{} velocity limit exceeded at cycle {}: {}",
+                 description, i, velocity));
+        break;
+      }
+      last_velocity = velocity;
+      last_accel = acceleration;
+
+      if (ctx.status.trajectory_done) { break; }
+    }
+    result->cycles += i;
+
+    if (!ctx.status.trajectory_done) {
+      Fail(result, description + " did not complete");
+      return;
+    }
+
+    const double error =
+        FromRaw(Delta(*ctx.status.control_position_raw, target));
+    if (std::abs(error) >
+        BldcServoPosition::kJerkPositionTolerance +
+        2.0f * std::abs(vf) * period_s) {
+      Fail(result, fmt::format("{} final error {}", description, error));
+    }
+  }
+
+  // Command velocities at and beyond configured position bounds, and
+  // verify that the control position never leaves them.
+  void RunBounds(Result* result) {
+    Context ctx;
+    ctx.rate_hz = RandomRate();
+
+    const float min = Uniform(-100.0f, 0.0f);
+    const float max = min + Uniform(0.1f, 100.0f);
+    ctx.position_config.position_min = min;
+    ctx.position_config.position_max = max;
+    ctx.SetPosition(ToRaw(Uniform(min, max)));
+
+    if (Chance(0.5f)) {
+      ctx.data.accel_limit = Uniform(1.0f, 2000.0f);
+    }
+
+    // The bounds are quantized like any other float position.
+    const double tolerance = 2.0 / 65536.0;
+
+    const uint64_t count = Cycles(200000);
+    for (uint64_t i = 0; i < count; i++) {
+      if ((i % 10000) == 0) {
+        ctx.data.velocity = Uniform(-50.0f, 50.0f);
+      }
+      ctx.Step();
+
+      const double position = FromRaw(*ctx.status.control_position_raw);
+      if (position < min - tolerance || position > max + tolerance) {
+        Fail(result, fmt::format(
+                 "bounds: [{}, {}] exceeded at cycle {}: {}",
+                 min, max, i, position));
+        break;
+      }
+    }
+    result->cycles += count;
+  }
+
+  static constexpr double kRawScale = 281474976710656.0;  // 2^48
+
+  std::mt19937 rng_;
+};
+
+}
+}
@@ -0,0 +1,173 @@
+// Copyright 2023 mjbots Robotic Systems, LLC.  info@mjbots.com
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// @file
+///
+/// Fuzz and benchmark BldcServoPosition over many more cycles than
+/// is practical in the unit tests.
+///
+///  trajectory_fuzz [--cycles N] [--seed N] [--benchmark]
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <fmt/format.h>
+
+#include "fw/test/trajectory_fuzz.h"
+
+namespace moteus {
+volatile uint8_t g_measured_hw_family = 0;
+volatile uint8_t g_measured_hw_rev = 7;
+}
+
+using namespace moteus;
+
+namespace {
+constexpr float NaN = std::numeric_limits<float>::quiet_NaN();
+
+struct BenchmarkContext {
+  BldcServoStatus status;
+  BldcServoConfig config;
+  BldcServoPositionConfig position_config;
+  MotorPosition::Status position;
+  BldcServoCommandData data;
+
+  // If true, plan the jerk limited trajectory again every cycle, as
+  // if a new command had arrived.
+  bool replan = false;
+
+  BenchmarkContext() {
+    position_config.position_min = NaN;
+    position_config.position_max = NaN;
+    data.mode = BldcServoMode::kPosition;
+    data.position = NaN;
+  }
+};
+
+template <typename Setup>
+void Benchmark(const char* name, uint64_t cycles, Setup setup) {
+  BenchmarkContext ctx;
+  setup(&ctx);
+
+  // Accumulate the result so the calls cannot be optimized away.
+  float sum = 0.0f;
+
+  const auto start = std::chrono::steady_clock::now();
+  for (uint64_t i = 0; i < cycles; i++) {
+    if (ctx.status.trajectory_done && !std::isnan(ctx.data.accel_limit)) {
+      // Restart moves as they finish so that we spend our time in
+      // the trajectory generator.
+      setup(&ctx);
+    }
+    if (ctx.replan) { ctx.data.jerk_trajectory_planned = false; }
+    sum += BldcServoPosition::UpdateCommand(
+        &ctx.status, &ctx.config, &ctx.position_config, &ctx.position, 0,
+        30000.0f, &ctx.data, ctx.data.velocity);
+    ctx.position.position_relative_raw = *ctx.status.control_position_raw;
+  }
+  const auto end = std::chrono::steady_clock::now();
+
+  const double ns =
+      std::chrono::duration<double, std::nano>(end - start).count();
+  fmt::print("{:<16} {:8.2f} ns/cycle  ({})\n", name, ns / cycles, sum);
+}
+
+void RunBenchmarks(uint64_t cycles) {
+  Benchmark("velocity", cycles, [](BenchmarkContext* ctx) {
+      ctx->data.velocity = 12.5f;
+    });
+  Benchmark("accel", cycles, [](BenchmarkContext* ctx) {
+      ctx->data.accel_limit = 200.0f;
+      ctx->data.velocity = 0.0f;
+      ctx->status.trajectory_done = false;
+      ctx->data.position_relative_raw =
+          ctx->position.position_relative_raw + (10ll << 48);
+    });
+  Benchmark("accel_velocity", cycles, [](BenchmarkContext* ctx) {
+      ctx->data.accel_limit = 200.0f;
+      ctx->data.velocity_limit = 20.0f;
+      ctx->data.velocity = 0.0f;
+      ctx->status.trajectory_done = false;
+      ctx->data.position_relative_raw =
+          ctx->position.position_relative_raw + (10ll << 48);
+    });
+  Benchmark("jerk", cycles, [](BenchmarkContext* ctx) {
+      ctx->data.accel_limit = 200.0f;
+      ctx->data.velocity_limit = 20.0f;
+      ctx->data.jerk_limit = 2000.0f;
+      ctx->data.velocity = 0.0f;
+      ctx->data.jerk_trajectory_planned = false;
+      ctx->status.trajectory_done = false;
+      ctx->data.position_relative_raw =
+          ctx->position.position_relative_raw + (10ll << 48);
+    });
+  Benchmark("jerk_plan", cycles, [](BenchmarkContext* ctx) {
+      ctx->data.accel_limit = 200.0f;
+      ctx->data.velocity_limit = 20.0f;
+      ctx->data.jerk_limit = 2000.0f;
+      ctx->data.velocity = 0.0f;
+      ctx->status.trajectory_done = false;
+      ctx->data.position_relative_raw =
+          ctx->position.position_relative_raw + (10ll << 48);
+      ctx->replan = true;
+    });
+  Benchmark("bounds", cycles, [](BenchmarkContext* ctx) {
+      ctx->position_config.position_min = -1.0f;
+      ctx->position_config.position_max = 1.0f;
+      ctx->data.velocity = 12.5f;
+    });
+}
+}
+
+int main(int argc, char** argv) {
+  uint64_t cycles = 1000000000;
+  uint32_t seed = 0;
+  bool benchmark = false;
+
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    if (arg == "--cycles" && (i + 1) < argc) {
+      cycles = std::strtoull(argv[++i], nullptr, 0);
+    } else if (arg == "--seed" && (i + 1) < argc) {
+      seed = std::strtoul(argv[++i], nullptr, 0);
+    } else if (arg == "--benchmark") {
+      benchmark = true;
+    } else {
+      fmt::print(stderr,
+                 "usage: {} [--cycles N] [--seed N] [--benchmark]\n",
+                 argv[0]);
+      return 1;
+    }
+  }
+
+  if (benchmark) {
+    RunBenchmarks(cycles);
+    return 0;
+  }
+
+  test::TrajectoryFuzz fuzz(seed);
+  const auto result = fuzz.Run(cycles);
+
+  fmt::print("cycles:    {}\n", result.cycles);
+  fmt::print("episodes:  {}\n", result.episodes);
+  fmt::print("max drift: {} rev\n", result.max_drift);
+  fmt::print("failures:  {}\n", result.failures);
+  if (result.failures) {
+    fmt::print("first:     {}\n", result.first_failure);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,172 @@
+// Copyright 2023 mjbots Robotic Systems, LLC.  info@mjbots.com
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "mjlib/base/visitor.h"
+
+namespace moteus {
+
+/// A lumped parameter thermal model of the FETs and the motor
+/// winding, used to predict how long the present load can be
+/// sustained before the temperature derating begins.
+///
+/// Each is a single thermal mass coupled to an unknown ambient:
+///
+///   time_constant * d(rise)/dt = thermal_resistance * power - rise
+///
+/// The model tracks only the rise due to self heating.  The ambient
+/// is taken as the measured temperature minus that rise, so errors in
+/// the model parameters do not accumulate in the prediction.
+class ThermalModel {
+ public:
+  struct Config {
+    // The effective resistance of the FETs in each phase, in ohms.
+    float fet_resistance_ohm = 0.0f;
+
+    // Degrees C per W.  If 0, the FETs are not modeled.
+    float fet_thermal_resistance = 0.0f;
+    float fet_time_constant_s = 0.0f;
+
+    // The electrical resistance of the motor is taken from the motor
+    // calibration.  If the thermal resistance is 0, the motor is not
+    // modeled.
+    float motor_thermal_resistance = 0.0f;
+    float motor_time_constant_s = 0.0f;
+
+    bool enabled() const {
+      return fet_thermal_resistance > 0.0f || motor_thermal_resistance > 0.0f;
+    }
+
+    template <typename Archive>
+    void Serialize(Archive* a) {
+      a->Visit(MJ_NVP(fet_resistance_ohm));
+      a->Visit(MJ_NVP(fet_thermal_resistance));
+      a->Visit(MJ_NVP(fet_time_constant_s));
+      a->Visit(MJ_NVP(motor_thermal_resistance));
+      a->Visit(MJ_NVP(motor_time_constant_s));
+    }
+  };
+
+  struct State {
+    // The temperature rise above ambient due to self heating, in C.
+    float fet_rise_C = 0.0f;
+    float motor_rise_C = 0.0f;
+
+    // The time until the temperature derating would begin at the
+    // most recent load, or infinity if it never would.
+    float time_to_derate_s = std::numeric_limits<float>::infinity();
+
+    template <typename Archive>
+    void Serialize(Archive* a) {
+      a->Visit(MJ_NVP(fet_rise_C));
+      a->Visit(MJ_NVP(motor_rise_C));
+      a->Visit(MJ_NVP(time_to_derate_s));
+    }
+  };
+
+  struct Inputs {
+    // The mean of d_A^2 + q_A^2 over the update period.
+    float current2_A2 = 0.0f;
+    float motor_resistance_ohm = 0.0f;
+
+    float fet_temp_C = 0.0f;
+    float fet_derate_C = std::numeric_limits<float>::infinity();
+
+    // NaN if there is no motor temperature sensor.
+    float motor_temp_C = std::numeric_limits<float>::quiet_NaN();
+    float motor_derate_C = std::numeric_limits<float>::infinity();
+  };
+
+  ThermalModel(const Config* config, State* state)
+      : config_(config), state_(state) {}
+
+  /// Recalculate the filter constants, which must be done whenever
+  /// the config or the update period changes.
+  void UpdateConfig(float period_s) {
+    fet_alpha_ = Alpha(config_->fet_time_constant_s, period_s);
+    motor_alpha_ = Alpha(config_->motor_time_constant_s, period_s);
+  }
+
+  void Update(const Inputs& inputs) {
+    // The currents are amplitude invariant, so the power in the
+    // three phases is 1.5 * R * I^2.
+    const float fet_power_W =
+        1.5f * config_->fet_resistance_ohm * inputs.current2_A2;
+    const float motor_power_W =
+        1.5f * inputs.motor_resistance_ohm * inputs.current2_A2;
+
+    const float fet_steady_rise_C =
+        fet_power_W * config_->fet_thermal_resistance;
+    const float motor_steady_rise_C =
+        motor_power_W * config_->motor_thermal_resistance;
+
+    state_->fet_rise_C +=
+        fet_alpha_ * (fet_steady_rise_C - state_->fet_rise_C);
+    state_->motor_rise_C +=
+        motor_alpha_ * (motor_steady_rise_C - state_->motor_rise_C);
+
+    float result = std::numeric_limits<float>::infinity();
+    if (config_->fet_thermal_resistance > 0.0f) {
+      result = std::min(
+          result,
+          TimeToReach(inputs.fet_temp_C,
+                      inputs.fet_temp_C - state_->fet_rise_C +
+                      fet_steady_rise_C,
+                      inputs.fet_derate_C,
+                      config_->fet_time_constant_s));
+    }
+    if (config_->motor_thermal_resistance > 0.0f &&
+        std::isfinite(inputs.motor_temp_C)) {
+      result = std::min(
+          result,
+          TimeToReach(inputs.motor_temp_C,
+                      inputs.motor_temp_C - state_->motor_rise_C +
+                      motor_steady_rise_C,
+                      inputs.motor_derate_C,
+                      config_->motor_time_constant_s));
+    }
+    state_->time_to_derate_s = result;
+  }
+
+  /// The time for a first order system starting at @p temperature_C
+  /// and settling at @p steady_C to reach @p limit_C.
+  static float TimeToReach(float temperature_C, float steady_C,
+                           float limit_C, float time_constant_s) {
+    if (!(temperature_C < limit_C)) { return 0.0f; }
+    if (!(steady_C > limit_C)) {
+      return std::numeric_limits<float>::infinity();
+    }
+    return time_constant_s *
+        std::log((steady_C - temperature_C) / (steady_C - limit_C));
+  }
+
+ private:
+  static float Alpha(float time_constant_s, float period_s) {
+    if (!(time_constant_s > 0.0f)) { return 1.0f; }
+    return 1.0f - std::exp(-period_s / time_constant_s);
+  }
+
+  const Config* const config_;
+  State* const state_;
+
+  float fet_alpha_ = 1.0f;
+  float motor_alpha_ = 1.0f;
+};
+
+}
@@ -14,6 +14,9 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <deque>
 #include <iostream>
 #include <memory>
 #include <mutex>
@@ -83,6 +86,11 @@ class Controller {
 
     int64_t diagnostic_retry_sleep_ns = 200000;
 
+    // When sending a batch of diagnostic commands, at most this many
+    // bytes of commands are queued in the controller at once.  It
+    // must be less than the controller's tunnel receive buffer.
+    size_t diagnostic_batch_window = 192;
+
     // Specify a transport to be used.  If left unset, a global common
     // transport will be constructed to be shared with all Controller
     // instances in this process.  That will attempt to auto-detect a
@@ -424,6 +432,67 @@ class Controller {
   }
 
 
+  /////////////////////////////////////////
+  // Heartbeat
+
+  CanFdFrame MakeHeartbeat(const Heartbeat::Command& cmd = {},
+                           const Heartbeat::Format* command_override = nullptr,
+                           const Query::Format* query_override = nullptr) {
+    return MakeFrame(Heartbeat(), cmd,
+                     (command_override == nullptr ?
+                      Heartbeat::Format() : *command_override),
+                     query_override);
+  }
+
+  Optional<Result> SetHeartbeat(const Heartbeat::Command& cmd = {},
+                                const Heartbeat::Format* command_override = nullptr,
+                                const Query::Format* query_override = nullptr) {
+    return ExecuteSingleCommand(
+        MakeHeartbeat(cmd, command_override, query_override));
+  }
+
+  void AsyncHeartbeat(const Heartbeat::Command& cmd,
+                      Result* result, CompletionCallback callback,
+                      const Heartbeat::Format* command_override = nullptr,
+                      const Query::Format* query_override = nullptr) {
+    AsyncStartSingleCommand(
+        MakeHeartbeat(cmd, command_override, query_override),
+        result, callback);
+  }
+
+
+  /////////////////////////////////////////
+  // SharedTime
+  //
+  // To keep several devices in one time base, send this from a
+  // Controller with an id of 0x7f (the broadcast address).
+
+  CanFdFrame MakeSharedTime(const SharedTime::Command& cmd,
+                            const SharedTime::Format* command_override = nullptr,
+                            const Query::Format* query_override = nullptr) {
+    return MakeFrame(SharedTime(), cmd,
+                     (command_override == nullptr ?
+                      SharedTime::Format() : *command_override),
+                     query_override);
+  }
+
+  Optional<Result> SetSharedTime(const SharedTime::Command& cmd,
+                                 const SharedTime::Format* command_override = nullptr,
+                                 const Query::Format* query_override = nullptr) {
+    return ExecuteSingleCommand(
+        MakeSharedTime(cmd, command_override, query_override));
+  }
+
+  void AsyncSharedTime(const SharedTime::Command& cmd,
+                       Result* result, CompletionCallback callback,
+                       const SharedTime::Format* command_override = nullptr,
+                       const Query::Format* query_override = nullptr) {
+    AsyncStartSingleCommand(
+        MakeSharedTime(cmd, command_override, query_override),
+        result, callback);
+  }
+
+
   /////////////////////////////////////////
   // ClockTrim
 
@@ -485,6 +554,36 @@ class Controller {
     context->Start();
   }
 
+  /// Send multiple diagnostic commands without waiting for each
+  /// response before sending the next.  One response is returned per
+  /// message.  A message which fails has the "ERR" line as its
+  /// response.
+  std::vector<std::string> DiagnosticCommandBatch(
+      const std::vector<std::string>& messages,
+      DiagnosticReplyMode reply_mode = kExpectOK) {
+    BlockingCallback cbk;
+    std::vector<std::string> responses;
+    AsyncDiagnosticCommandBatch(
+        messages, &responses, cbk.callback(), reply_mode);
+    cbk.Wait();
+    return responses;
+  }
+
+  void AsyncDiagnosticCommandBatch(const std::vector<std::string>& messages,
+                                   std::vector<std::string>* results,
+                                   CompletionCallback callback,
+                                   DiagnosticReplyMode reply_mode = kExpectOK) {
+    auto context = std::make_shared<AsyncDiagnosticBatchContext>();
+    context->messages = messages;
+    context->results = results;
+    context->controller = this;
+    context->transport = transport();
+    context->callback = callback;
+    context->reply_mode = reply_mode;
+
+    context->Start();
+  }
+
   void DiagnosticWrite(const std::string& message, int channel = 1) {
     BlockingCallback cbk;
     AsyncDiagnosticWrite(message, channel, cbk.callback());
@@ -586,6 +685,115 @@ class Controller {
   }
 
 
+  /////////////////////////////////////////
+  // Multi-controller homing
+
+  struct HomeOptions {
+    // The velocity to move at while searching, in revolutions per
+    // second.
+    double velocity = 0.1;
+
+    // If finite, the maximum torque to use while searching.
+    double maximum_torque = NaN;
+
+    // Each controller is complete once it reports at least this home
+    // state.
+    HomeState home_state = HomeState::kRotor;
+
+    // If true, discard any existing homing before starting.
+    bool require_reindex = true;
+
+    double period_s = 0.01;
+    double timeout_s = 10.0;
+
+    HomeOptions() {}
+  };
+
+  /// Simultaneously home several controllers, for instance by
+  /// searching for an index pulse.
+  ///
+  /// Each controller is moved at a constant velocity until it reports
+  /// the desired home state, after which it is held in place.  Every
+  /// controller is commanded and queried in a single Transport::Cycle
+  /// per iteration, so all controllers must share a transport.
+  ///
+  /// Returns one entry per controller, true if it was homed before
+  /// the timeout elapsed.
+  static std::vector<bool> HomeAll(
+      const std::vector<std::shared_ptr<Controller>>& controllers,
+      const HomeOptions& options = {}) {
+    std::vector<bool> homed(controllers.size(), false);
+    if (controllers.empty()) { return homed; }
+
+    auto* const transport = controllers.front()->transport();
+
+    std::vector<CanFdFrame> frames;
+    std::vector<CanFdFrame> replies;
+
+    if (options.require_reindex) {
+      for (const auto& c : controllers) {
+        frames.push_back(c->MakeRequireReindex());
+      }
+      transport->BlockingCycle(&frames[0], frames.size(), &replies);
+    }
+
+    auto make_frames = [&](bool query) {
+      frames.clear();
+      for (size_t i = 0; i < controllers.size(); i++) {
+        const auto& c = controllers[i];
+
+        PositionMode::Format position_format = c->options_.position_format;
+        if (std::isfinite(options.maximum_torque)) {
+          position_format.maximum_torque = kFloat;
+        }
+
+        Query::Format query_format = c->options_.query_format;
+        query_format.home_state = kInt8;
+
+        // A NaN position lets the controller move at the commanded
+        // velocity, or hold wherever it is once stopped.
+        PositionMode::Command cmd;
+        cmd.position = NaN;
+        cmd.velocity = (homed[i] || !query) ? 0.0 : options.velocity;
+        cmd.maximum_torque = options.maximum_torque;
+
+        frames.push_back(c->MakePosition(
+            cmd, &position_format, query ? &query_format : nullptr));
+      }
+    };
+
+    const auto start = Fdcanusb::GetNow();
+    const auto timeout_ns = static_cast<int64_t>(options.timeout_s * 1e9);
+
+    while (std::find(homed.begin(), homed.end(), false) != homed.end() &&
+           (Fdcanusb::GetNow() - start) < timeout_ns) {
+      make_frames(true);
+      replies.clear();
+      transport->BlockingCycle(&frames[0], frames.size(), &replies);
+
+      for (size_t i = 0; i < controllers.size(); i++) {
+        const auto maybe_result = controllers[i]->FindResult(replies);
+        if (!!maybe_result &&
+            static_cast<int>(maybe_result->values.home_state) >=
+            static_cast<int>(options.home_state)) {
+          homed[i] = true;
+        }
+      }
+
+      if (std::find(homed.begin(), homed.end(), false) != homed.end()) {
+        ::usleep(static_cast<int>(options.period_s * 1e6));
+      }
+    }
+
+    // Leave every controller holding position, whether or not it was
+    // homed.
+    make_frames(false);
+    transport->BlockingCycle(&frames[0], frames.size(), &replies);
+
+    return homed;
+  }
+
+
   /////////////////////////////////////////
   // Schema version checking
 
@@ -860,6 +1068,171 @@ class Controller {
     }
   };
 
+  // A helper context to pipeline a sequence of diagnostic channel
+  // commands.
+  struct AsyncDiagnosticBatchContext
+      : public std::enable_shared_from_this<AsyncDiagnosticBatchContext> {
+    std::vector<std::string> messages;
+    std::vector<std::string>* results = nullptr;
+    CompletionCallback callback;
+    DiagnosticReplyMode reply_mode = {};
+
+    Controller* controller = nullptr;
+    Transport* transport = nullptr;
+
+    CanFdFrame output_frame_;
+    std::vector<CanFdFrame> replies;
+
+    size_t next_message = 0;
+    std::deque<size_t> outstanding;
+    size_t outstanding_bytes = 0;
+
+    int empty_replies = 0;
+    std::string remaining_command;
+    std::string current_line;
+    std::ostringstream output;
+
+    void Start() {
+      results->clear();
+      if (messages.empty()) {
+        transport->Post(std::bind(callback, 0));
+        return;
+      }
+
+      Fill();
+      DoWrite();
+    }
+
+    void Callback(int error) {
+      if (error != 0) {
+        transport->Post(std::bind(callback, error));
+        return;
+      }
+
+      ProcessReplies();
+
+      if (results->size() == messages.size()) {
+        transport->Post(std::bind(callback, 0));
+        return;
+      }
+
+      Fill();
+
+      if (remaining_command.size()) {
+        DoWrite();
+      } else {
+        DoRead();
+      }
+    }
+
+    // Queue as many commands as will fit in the window.  At least
+    // one is always outstanding.
+    void Fill() {
+      while (next_message < messages.size()) {
+        const auto size = messages[next_message].size() + 1;
+        if (!outstanding.empty() &&
+            (outstanding_bytes + size) >
+            controller->options_.diagnostic_batch_window) {
+          break;
+        }
+        remaining_command += messages[next_message] + "\n";
+        outstanding.push_back(size);
+        outstanding_bytes += size;
+        next_message++;
+      }
+    }
+
+    void DoWrite() {
+      DiagnosticWrite::Command write;
+      write.data = remaining_command.data();
+      const auto to_write = std::min<size_t>(48, remaining_command.size());
+      write.size = to_write;
+
+      output_frame_ = controller->DefaultFrame(kNoReply);
+      WriteCanData write_frame(output_frame_.data, &output_frame_.size);
+      DiagnosticWrite::Make(&write_frame, write, {});
+
+      auto s = shared_from_this();
+      transport->Cycle(
+          &output_frame_, 1, nullptr,
+          [s, to_write](int v) {
+            s->remaining_command = s->remaining_command.substr(to_write);
+            s->Callback(v);
+          });
+    }
+
+    void DoRead() {
+      if (empty_replies >= 5) {
+        transport->Post(std::bind(callback, ETIMEDOUT));
+        return;
+      } else if (empty_replies >= 2) {
+        ::usleep(controller->options_.diagnostic_retry_sleep_ns / 1000);
+      }
+
+      DiagnosticRead::Command read;
+      output_frame_ = controller->DefaultFrame(kReplyRequired);
+      WriteCanData write_frame(output_frame_.data, &output_frame_.size);
+      DiagnosticRead::Make(&write_frame, read, {});
+
+      auto s = shared_from_this();
+
+      transport->Cycle(
+          &output_frame_, 1, &replies,
+          [s](int v) {
+            s->Callback(v);
+          });
+    }
+
+    void FinishOne(const std::string& response) {
+      results->push_back(response);
+      output.str("");
+      outstanding_bytes -= outstanding.front();
+      outstanding.pop_front();
+    }
+
+    void ProcessReplies() {
+      for (const auto& reply : replies) {
+        if (reply.source != controller->options_.id ||
+            reply.destination != controller->options_.source ||
+            reply.can_prefix != controller->options_.can_prefix) {
+          continue;
+        }
+
+        const auto parsed = DiagnosticResponse::Parse(reply.data, reply.size);
+        if (parsed.channel != 1) { continue; }
+
+        if (parsed.size == 0) {
+          empty_replies++;
+        } else {
+          empty_replies = 0;
+        }
+
+        current_line += std::string(
+            reinterpret_cast<const char*>(parsed.data), parsed.size);
+      }
+      replies.clear();
+
+      size_t first_newline = std::string::npos;
+      while (!outstanding.empty() &&
+             (first_newline = current_line.find_first_of("\r\n"))
+             != std::string::npos) {
+        const auto this_line = current_line.substr(0, first_newline);
+        current_line = current_line.substr(first_newline + 1);
+
+        if (this_line.empty()) { continue; }
+
+        if (reply_mode == kExpectSingleLine ||
+            this_line.compare(0, 3, "ERR") == 0) {
+          FinishOne(this_line);
+        } else if (this_line == "OK") {
+          FinishOne(output.str());
+        } else {
+          output << this_line << "\r\n";
+        }
+      }
+    }
+  };
+
   struct AsyncDiagnosticWriteContext
       : public std::enable_shared_from_this<AsyncDiagnosticWriteContext> {
     std::string message;
@@ -248,6 +248,10 @@ class WriteCanData {
     WriteMapped(value, 0.05, 0.001, 0.00001, res);
   }
 
+  void WriteJerk(double value, Resolution res) {
+    WriteMapped(value, 10.0, 1.0, 0.001, res);
+  }
+
   void WriteTorque(double value, Resolution res) {
     WriteMapped(value, 0.5, 0.01, 0.001, res);
   }
@@ -272,6 +276,24 @@ class WriteCanData {
     WriteMapped(value, 0.01, 0.001, 0.000001, res);
   }
 
+  /// Write a time in the shared time base.  As int32, it is the
+  /// number of microseconds, wrapped modulo 2^32 rather than
+  /// saturated.
+  void WriteSharedTime(double value, Resolution res) {
+    if (res != Resolution::kInt32 || !::isfinite(value)) {
+      WriteTime(value, res);
+      return;
+    }
+    const double wrapped = ::fmod(::round(value * 1e6), 4294967296.0);
+    const uint32_t us = static_cast<uint32_t>(
+        static_cast<int64_t>(wrapped < 0.0 ? wrapped + 4294967296.0 : wrapped));
+    int32_t result = 0;
+    ::memcpy(&result, &us, sizeof(result));
+    // The minimum value is reserved to mean "unset".
+    Write<int32_t>(
+        result == detail::numeric_limits<int32_t>::min() ? result + 1 : result);
+  }
+
   void WriteCurrent(double value, Resolution res) {
     WriteMapped(value, 1.0, 0.1, 0.001, res);
   }
@@ -449,6 +471,7 @@ class MultiplexParser {
   static constexpr int8_t kTime = 7;
   static constexpr int8_t kCurrent = 8;
   static constexpr int8_t kTheta = 9;
+  static constexpr int8_t kDuration = 10;
 
   double ReadConcrete(Resolution res, int8_t concrete_type) {
 #ifndef ARDUINO
@@ -466,6 +489,7 @@ class MultiplexParser {
       0.01, 0.001, 0.000001,   // kTime
       1.0, 0.1, 0.001,         // kCurrent
       1.0 / 127.0 * M_PI, 1.0 / 32767.0 * M_PI, 1.0 / 2147483647.0 * M_PI, // kTheta
+      1.0, 0.1, 0.001,         // kDuration
     };
 
 #ifndef ARDUINO
@@ -535,6 +559,10 @@ class MultiplexParser {
     return ReadConcrete(res, kCurrent);
   }
 
+  double ReadDuration(Resolution res) {
+    return ReadConcrete(res, kDuration);
+  }
+
   void Ignore(Resolution res) {
     offset_ += ResolutionSize(res);
   }
@@ -549,6 +577,19 @@ class MultiplexParser {
     return size_ - offset_;
   }
 
+  /// The number of values left in the reply block which held the
+  /// register most recently returned by next().
+  int8_t block_remaining() const {
+    return remaining_;
+  }
+
+  /// Move past the next @p count registers of the current block,
+  /// after their values have been consumed with ReadRaw.
+  void SkipRegisters(int8_t count) {
+    remaining_ -= count;
+    current_register_ += count;
+  }
+
   static int8_t ResolutionSize(Resolution res) {
     switch (res) {
       case Resolution::kInt8: return 1;
@@ -149,6 +149,7 @@ enum Register : uint16_t {
   kControlPositionError = 0x03b,
   kControlVelocityError = 0x03c,
   kControlTorqueError = 0x03d,
+  kLoadTorque = 0x03e,
 
   kCommandStayWithinLowerBound = 0x040,
   kCommandStayWithinUpperBound = 0x041,
@@ -186,6 +187,54 @@ enum Register : uint16_t {
 
   kMillisecondCounter = 0x070,
   kClockTrim = 0x071,
+  kCommandLatency = 0x072,
+  kControlCycle = 0x073,
+  kSharedTime = 0x074,
+
+  kAuxSnapshotGpio = 0x078,
+  kAuxSnapshotAux1Analog1 = 0x079,
+  kAuxSnapshotAux1Analog2 = 0x07a,
+  kAuxSnapshotAux1Analog3 = 0x07b,
+  kAuxSnapshotAux1Analog4 = 0x07c,
+  kAuxSnapshotAux1Analog5 = 0x07d,
+  kAuxSnapshotAux2Analog1 = 0x07e,
+  kAuxSnapshotAux2Analog2 = 0x07f,
+  kAuxSnapshotAux2Analog3 = 0x080,
+  kAuxSnapshotAux2Analog4 = 0x081,
+  kAuxSnapshotAux2Analog5 = 0x082,
+
+  kAuxAverageGpio = 0x088,
+  kAuxAverageAux1Analog1 = 0x089,
+  kAuxAverageAux1Analog2 = 0x08a,
+  kAuxAverageAux1Analog3 = 0x08b,
+  kAuxAverageAux1Analog4 = 0x08c,
+  kAuxAverageAux1Analog5 = 0x08d,
+  kAuxAverageAux2Analog1 = 0x08e,
+  kAuxAverageAux2Analog2 = 0x08f,
+  kAuxAverageAux2Analog3 = 0x090,
+  kAuxAverageAux2Analog4 = 0x091,
+  kAuxAverageAux2Analog5 = 0x092,
+
+  kStatsQCurrentMin = 0x0a0,
+  kStatsQCurrentMax = 0x0a1,
+  kStatsQCurrentMean = 0x0a2,
+  kStatsTorqueMin = 0x0a3,
+  kStatsTorqueMax = 0x0a4,
+  kStatsTorqueMean = 0x0a5,
+  kStatsVelocityMin = 0x0a6,
+  kStatsVelocityMax = 0x0a7,
+  kStatsVelocityMean = 0x0a8,
+  kStatsCount = 0x0a9,
+
+  kHeartbeat = 0x0b0,
+  kTimeoutCause = 0x0b1,
+  kCommandTimeoutCount = 0x0b2,
+  kHeartbeatTimeoutCount = 0x0b3,
+  kMissedHeartbeatCount = 0x0b4,
+
+  kTimeToDerate = 0x0c0,
+  kFetTemperatureRise = 0x0c1,
+  kMotorTemperatureRise = 0x0c2,
 
   kRegisterMapVersion = 0x102,
   kSerialNumber = 0x120,
@@ -262,6 +311,20 @@ struct Query {
   static constexpr int16_t kMaxExtra = 8;
 #endif
 
+  // The registers of the aux snapshot block, which are read
+  // together.
+  static constexpr int16_t kAuxSnapshotSize = 11;
+
+  // The GPIO inputs and analog inputs of both aux ports, from either
+  // the snapshot or average register block.
+  struct AuxSnapshot {
+    bool valid = false;
+    uint8_t aux1_gpio = 0;
+    uint8_t aux2_gpio = 0;
+    double aux1_analog[5] = {};
+    double aux2_analog[5] = {};
+  };
+
   struct Result {
     Mode mode = Mode::kStopped;
     double position = NaN;
@@ -280,6 +343,8 @@ struct Query {
     int8_t aux1_gpio = 0;
     int8_t aux2_gpio = 0;
 
+    AuxSnapshot aux_snapshot;
+
     // Before gcc-12, initializating non-POD array types can be
     // painful if done in the idiomatic way with ={} inline.  Instead
     // we do it in the constructor.
@@ -313,6 +378,12 @@ struct Query {
     Resolution aux1_gpio = kIgnore;
     Resolution aux2_gpio = kIgnore;
 
+    // Read the whole aux snapshot block.  kInt16 is the most compact
+    // form.  If aux_snapshot_average is set, the analog inputs are
+    // averaged over the interval since they were last read this way.
+    Resolution aux_snapshot = kIgnore;
+    bool aux_snapshot_average = false;
+
     // Any values here must be sorted by register number.
     ItemFormat extra[kMaxExtra];
 
@@ -377,6 +448,22 @@ struct Query {
       reply_size += combiner.reply_size();
     }
 
+    if (format.aux_snapshot != kIgnore) {
+      Resolution resolutions[kAuxSnapshotSize];
+      for (auto& resolution : resolutions) {
+        resolution = format.aux_snapshot;
+      }
+      WriteCombiner combiner(
+          frame, 0x10,
+          format.aux_snapshot_average ?
+          Register::kAuxAverageGpio : Register::kAuxSnapshotGpio,
+          resolutions, kAuxSnapshotSize);
+      for (uint16_t i = 0; i < kAuxSnapshotSize; i++) {
+        combiner.MaybeWrite();
+      }
+      reply_size += combiner.reply_size();
+    }
+
     {
       const int16_t size = [&]() {
         for (int16_t i = 0; i < kMaxExtra; i++) {
@@ -510,6 +597,13 @@ struct Query {
           break;
         }
         default: {
+          if ((current.value >= Register::kAuxSnapshotGpio &&
+               current.value <= Register::kAuxSnapshotAux2Analog5) ||
+              (current.value >= Register::kAuxAverageGpio &&
+               current.value <= Register::kAuxAverageAux2Analog5)) {
+            ParseAuxSnapshot(parser, current.value, res, &result.aux_snapshot);
+            break;
+          }
           if (extra_index < kMaxExtra) {
             result.extra[extra_index].register_number = current.value;
             result.extra[extra_index].value =
@@ -525,6 +619,51 @@ struct Query {
     }
   }
 
+  static void ParseAuxSnapshot(MultiplexParser* parser,
+                               uint16_t register_number,
+                               Resolution res,
+                               AuxSnapshot* snapshot) {
+    const int16_t offset =
+        register_number - (register_number >= Register::kAuxAverageGpio ?
+                           Register::kAuxAverageGpio :
+                           Register::kAuxSnapshotGpio);
+    snapshot->valid = true;
+
+    if (offset == 0 && res == kInt16 &&
+        parser->block_remaining() >= kAuxSnapshotSize - 1 &&
+        parser->remaining() >= kAuxSnapshotSize * 2) {
+      // The whole block is present in its packed form, so decode it
+      // in one go.
+      int16_t values[kAuxSnapshotSize] = {};
+      parser->ReadRaw(reinterpret_cast<uint8_t*>(&values[0]),
+                      sizeof(values));
+      parser->SkipRegisters(kAuxSnapshotSize - 1);
+
+      snapshot->aux1_gpio = values[0] & 0xff;
+      snapshot->aux2_gpio = (values[0] >> 8) & 0xff;
+      for (int8_t i = 0; i < 5; i++) {
+        snapshot->aux1_analog[i] = ScaleAuxAnalog(values[1 + i]);
+        snapshot->aux2_analog[i] = ScaleAuxAnalog(values[6 + i]);
+      }
+      return;
+    }
+
+    if (offset == 0) {
+      const auto value = parser->ReadInt(res);
+      snapshot->aux1_gpio = value & 0xff;
+      snapshot->aux2_gpio = (value >> 8) & 0xff;
+    } else if (offset <= 5) {
+      snapshot->aux1_analog[offset - 1] = parser->ReadPwm(res);
+    } else {
+      snapshot->aux2_analog[offset - 6] = parser->ReadPwm(res);
+    }
+  }
+
+  static double ScaleAuxAnalog(int16_t value) {
+    if (value == detail::numeric_limits<int16_t>::min()) { return NaN; }
+    return value / 32767.0;
+  }
+
   static double ParseGeneric(MultiplexParser* parser,
                              int16_t register_number,
                              Resolution resolution) {
@@ -630,8 +769,22 @@ struct Query {
       // { R::kAux2AnalogIn5, 1, MP::kPwm, },
 
       { R::kMillisecondCounter, 2, MP::kInt, },
+      { R::kSharedTime, 1, MP::kTime, },
       // { R::kClockTrim, 1, MP::kInt, },
 
+      { R::kAuxSnapshotGpio, 1, MP::kInt, },
+      { R::kAuxSnapshotAux1Analog1, 10, MP::kPwm, },
+      { R::kAuxAverageGpio, 1, MP::kInt, },
+      { R::kAuxAverageAux1Analog1, 10, MP::kPwm, },
+
+      { R::kStatsQCurrentMin, 3, MP::kCurrent, },
+      { R::kStatsTorqueMin, 3, MP::kTorque, },
+      { R::kStatsVelocityMin, 3, MP::kVelocity, },
+      { R::kStatsCount, 1, MP::kInt, },
+      { R::kHeartbeat, 5, MP::kInt, },
+      { R::kTimeToDerate, 1, MP::kDuration, },
+      { R::kFetTemperatureRise, 2, MP::kTemperature, },
+
       { R::kRegisterMapVersion, 1, MP::kInt, },
       { R::kSerialNumber1,  3, MP::kInt, },
       // { R::kSerialNumber2, 1, MP::kInt, },
@@ -790,6 +943,8 @@ struct PositionMode {
     double velocity_limit = NaN;
     double accel_limit = NaN;
     double fixed_voltage_override = NaN;
+    double jerk_limit = NaN;
+    double arrival_time = NaN;
   };
 
   struct Format {
@@ -804,6 +959,8 @@ struct PositionMode {
     Resolution velocity_limit = kIgnore;
     Resolution accel_limit = kIgnore;
     Resolution fixed_voltage_override = kIgnore;
+    Resolution jerk_limit = kIgnore;
+    Resolution arrival_time = kIgnore;
   };
 
   static uint8_t Make(WriteCanData* frame,
@@ -827,6 +984,8 @@ struct PositionMode {
       format.velocity_limit,
       format.accel_limit,
       format.fixed_voltage_override,
+      format.jerk_limit,
+      format.arrival_time,
     };
     WriteCombiner combiner(
         frame, 0x00,
@@ -868,6 +1027,12 @@ struct PositionMode {
       frame->WriteVoltage(command.fixed_voltage_override,
                           format.fixed_voltage_override);
     }
+    if (combiner.MaybeWrite()) {
+      frame->WriteJerk(command.jerk_limit, format.jerk_limit);
+    }
+    if (combiner.MaybeWrite()) {
+      frame->WriteSharedTime(command.arrival_time, format.arrival_time);
+    }
     return 0;
   }
 };
@@ -1150,6 +1315,18 @@ struct RequireReindex {
   }
 };
 
+struct Heartbeat {
+  struct Command {};
+  struct Format {};
+
+  static uint8_t Make(WriteCanData* frame, const Command&, const Format&) {
+    frame->Write<int8_t>(Multiplex::kWriteInt8 | 0x01);
+    frame->WriteVaruint(Register::kHeartbeat);
+    frame->Write<int8_t>(1);
+    return 0;
+  }
+};
+
 struct DiagnosticWrite {
   struct Command {
     int8_t channel = 1;
@@ -1232,5 +1409,33 @@ struct ClockTrim {
   }
 };
 
+/// Set the shared time base used by PositionMode::arrival_time.
+/// This is normally sent to the broadcast ID so that all devices
+/// receive it at the same instant.
+struct SharedTime {
+  struct Command {
+    double time = 0.0;
+  };
+
+  struct Format {
+    Resolution time = kInt32;
+  };
+
+  static uint8_t Make(WriteCanData* frame,
+                      const Command& command,
+                      const Format& format) {
+    const Resolution kResolutions[] = { format.time };
+    WriteCombiner combiner(
+        frame, 0x00,
+        Register::kSharedTime,
+        kResolutions,
+        sizeof(kResolutions) / sizeof(*kResolutions));
+    if (combiner.MaybeWrite()) {
+      frame->WriteSharedTime(command.time, format.time);
+    }
+    return 0;
+  }
+};
+
 }
 }
@@ -880,6 +880,309 @@ class Socketcan : public details::TimeoutTransport {
 };
 
 
+/// Communicates with devices on a RS485 bus using the multiplex
+/// stream framing:
+///
+///  - uint16 0xab54 header
+///  - uint8 source ID, with the high bit set if a reply is required
+///  - uint8 destination ID
+///  - varuint payload size
+///  - payload, identical to that of a CAN-FD frame
+///  - uint16 CRC-CCITT of all the preceding bytes
+///
+/// The bus is half-duplex, so by default each frame waits for its
+/// reply before the next is sent.
+class Rs485 : public details::TimeoutTransport {
+ public:
+  struct Options : details::TimeoutTransport::Options {
+    int baud_rate = 3000000;
+
+    Options() {
+      max_pipeline = 1;
+
+      // There is no acknowledgement of frames which do not require
+      // a reply, so there is nothing to wait for.
+      min_ok_wait_ns = 0;
+    }
+  };
+
+  Rs485(const std::string& device, const Options& options = {})
+      : details::TimeoutTransport(options),
+        options_(options) {
+    Open(device);
+  }
+
+  // This constructor overload is intended for use in unit tests,
+  // where the file descriptors will likely be pipes.
+  Rs485(int read_fd, int write_fd, const Options& options = {})
+      : details::TimeoutTransport(options),
+        options_(options) {
+    read_fd_ = read_fd;
+    write_fd_ = write_fd;
+  }
+
+  virtual ~Rs485() {
+    std::atomic_store(&UNPROTECTED_event_loop_, {});
+
+    if (read_fd_ == write_fd_) {
+      write_fd_.release();
+    }
+  }
+
+  static constexpr uint16_t kHeader = 0xab54;
+
+  static uint16_t Crc(const uint8_t* data, size_t size) {
+    uint16_t crc = 0xffff;
+    for (size_t i = 0; i < size; i++) {
+      crc ^= static_cast<uint16_t>(data[i]) << 8;
+      for (int bit = 0; bit < 8; bit++) {
+        crc = (crc & 0x8000) ?
+            static_cast<uint16_t>((crc << 1) ^ 0x1021) :
+            static_cast<uint16_t>(crc << 1);
+      }
+    }
+    return crc;
+  }
+
+  /// Append the framed form of @p frame to @p output, returning the
+  /// number of bytes written.
+  static size_t Encode(const CanFdFrame& frame, uint8_t* output) {
+    size_t pos = 0;
+    output[pos++] = kHeader & 0xff;
+    output[pos++] = kHeader >> 8;
+    // The arbitration ID has the same layout as on CAN.
+    output[pos++] = (frame.arbitration_id >> 8) & 0xff;
+    output[pos++] = frame.arbitration_id & 0xff;
+    uint32_t size = frame.size;
+    do {
+      output[pos++] = (size & 0x7f) | ((size >= 0x80) ? 0x80 : 0x00);
+      size >>= 7;
+    } while (size);
+    std::memcpy(&output[pos], frame.data, frame.size);
+    pos += frame.size;
+    const uint16_t crc = Crc(output, pos);
+    output[pos++] = crc & 0xff;
+    output[pos++] = crc >> 8;
+    return pos;
+  }
+
+ private:
+  static speed_t BaudConstant(int baud_rate) {
+    switch (baud_rate) {
+      case 115200: { return B115200; }
+      case 230400: { return B230400; }
+      case 460800: { return B460800; }
+      case 921600: { return B921600; }
+      case 1000000: { return B1000000; }
+      case 1500000: { return B1500000; }
+      case 2000000: { return B2000000; }
+      case 3000000: { return B3000000; }
+      case 4000000: { return B4000000; }
+    }
+    Fail("unsupported RS485 baud rate: " + std::to_string(baud_rate));
+    return B0;
+  }
+
+  void Open(const std::string& device) {
+    if (device.empty()) {
+      Fail("no RS485 device specified");
+    }
+
+    const int fd = ::open(device.c_str(), O_RDWR | O_NOCTTY);
+    FailIfErrno(fd == -1);
+
+    struct termios toptions;
+    FailIfErrno(::tcgetattr(fd, &toptions) < 0);
+    ::cfmakeraw(&toptions);
+    const auto speed = BaudConstant(options_.baud_rate);
+    FailIfErrno(::cfsetispeed(&toptions, speed) < 0);
+    FailIfErrno(::cfsetospeed(&toptions, speed) < 0);
+    FailIfErrno(::tcsetattr(fd, TCSAFLUSH, &toptions) < 0);
+
+    read_fd_ = fd;
+    write_fd_ = fd;
+  }
+
+  virtual int CHILD_GetReadFd() const override {
+    return read_fd_;
+  }
+
+  virtual void CHILD_SendCanFdFrame(const CanFdFrame& frame) override {
+    // The largest frame is 64 bytes of payload plus 8 of framing.
+    if ((sizeof(tx_buffer_) - tx_buffer_size_) < 80) {
+      CHILD_FlushTransmit();
+    }
+    tx_buffer_size_ += Encode(frame, &tx_buffer_[tx_buffer_size_]);
+  }
+
+  virtual void CHILD_FlushTransmit() override {
+    // Anything received so far, like a reply which arrived after an
+    // earlier request timed out, cannot be for what we send now.
+    DiscardInput();
+
+    for (size_t n = 0; n < tx_buffer_size_; ) {
+      int ret = ::write(write_fd_, &tx_buffer_[n], tx_buffer_size_ - n);
+      if (ret < 0) {
+        if (errno == EINTR || errno == EAGAIN) { continue; }
+
+        FailIfErrno(true);
+      } else {
+        n += ret;
+      }
+    }
+    tx_buffer_size_ = 0;
+  }
+
+  virtual ConsumeCount CHILD_ConsumeData(
+      std::vector<CanFdFrame>* replies,
+      int expected_ok_count,
+      std::vector<int>* expected_reply_count) override {
+    const int to_read = sizeof(rx_buffer_) - rx_buffer_size_;
+    const int read_ret = ::read(
+        read_fd_, &rx_buffer_[rx_buffer_size_], to_read);
+    if (read_ret < 0) {
+      if (errno == EINTR || errno == EAGAIN) { return {}; }
+      FailIfErrno(true);
+    }
+    rx_buffer_size_ += read_ret;
+
+    ConsumeCount result;
+    while (true) {
+      CanFdFrame this_frame;
+      const auto status = ParseFrame(&this_frame);
+      if (status == kIncomplete) { break; }
+      if (status == kInvalid) { continue; }
+
+      // Frames which request a reply are not from a device, but are
+      // likely our own transmissions echoed back by the adapter.
+      if (this_frame.arbitration_id & 0x8000) { continue; }
+
+      // Only replies from a device we are waiting on are kept.
+      if (!expected_reply_count || this_frame.source < 0) { continue; }
+      const size_t source = static_cast<size_t>(this_frame.source);
+      if (source >= expected_reply_count->size() ||
+          (*expected_reply_count)[source] == 0) {
+        continue;
+      }
+      (*expected_reply_count)[source]--;
+
+      result.rcv++;
+
+      if (replies) {
+        replies->emplace_back(std::move(this_frame));
+      }
+    }
+
+    if (rx_buffer_size_ >= sizeof(rx_buffer_)) {
+      // This can only happen if we are receiving garbage.  Start
+      // over.
+      rx_buffer_size_ = 0;
+    }
+
+    // There are no acknowledgements on RS485, every frame is complete
+    // once written.  We only report that once an expected reply has
+    // arrived, so that echoes, noise and other devices do not cut
+    // short the wait for one.
+    if (result.rcv) { result.ok = expected_ok_count; }
+
+    return result;
+  }
+
+  void DiscardInput() {
+    rx_buffer_size_ = 0;
+
+    while (true) {
+      struct pollfd fds[1] = {};
+      fds[0].fd = read_fd_;
+      fds[0].events = POLLIN;
+      if (::poll(&fds[0], 1, 0) <= 0) { return; }
+
+      uint8_t discard[256] = {};
+      const int ret = ::read(read_fd_, discard, sizeof(discard));
+      if (ret <= 0) { return; }
+    }
+  }
+
+  enum ParseStatus {
+    kComplete,
+    kIncomplete,
+    kInvalid,
+  };
+
+  void Discard(size_t size) {
+    std::memmove(&rx_buffer_[0], &rx_buffer_[size], rx_buffer_size_ - size);
+    rx_buffer_size_ -= size;
+  }
+
+  ParseStatus ParseFrame(CanFdFrame* frame) {
+    // Find the start of a frame.
+    size_t start = 0;
+    while (start + 1 < rx_buffer_size_ &&
+           !(rx_buffer_[start] == (kHeader & 0xff) &&
+             rx_buffer_[start + 1] == (kHeader >> 8))) {
+      start++;
+    }
+    Discard(start);
+
+    size_t pos = 4;
+    if (rx_buffer_size_ < pos) { return kIncomplete; }
+
+    uint32_t size = 0;
+    for (int shift = 0; ; shift += 7) {
+      if (pos >= rx_buffer_size_) { return kIncomplete; }
+      const uint8_t byte = rx_buffer_[pos++];
+      size |= static_cast<uint32_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) { break; }
+      if (shift >= 28) {
+        Discard(1);
+        return kInvalid;
+      }
+    }
+
+    if (size > sizeof(frame->data)) {
+      Discard(1);
+      return kInvalid;
+    }
+
+    if (rx_buffer_size_ < pos + size + 2) { return kIncomplete; }
+
+    const uint16_t expected_crc = Crc(rx_buffer_, pos + size);
+    const uint16_t actual_crc =
+        rx_buffer_[pos + size] | (rx_buffer_[pos + size + 1] << 8);
+    if (expected_crc != actual_crc) {
+      Discard(1);
+      return kInvalid;
+    }
+
+    frame->source = rx_buffer_[2] & 0x7f;
+    frame->destination = rx_buffer_[3] & 0x7f;
+    frame->arbitration_id = (rx_buffer_[2] << 8) | rx_buffer_[3];
+    frame->can_prefix = 0;
+    frame->size = size;
+    std::memcpy(frame->data, &rx_buffer_[pos], size);
+
+    Discard(pos + size + 2);
+    return kComplete;
+  }
+
+  // This is set in the parent, then used in the child.
+  const Options options_;
+
+  // We have these scoped file descriptors first in our member list,
+  // so they will only be closed after the threaded event loop has
+  // been destroyed during destruction.
+  details::FileDescriptor read_fd_;
+  details::FileDescriptor write_fd_;
+
+  // The following variables are only used in the child.
+  uint8_t rx_buffer_[4096] = {};
+  size_t rx_buffer_size_ = 0;
+
+  uint8_t tx_buffer_[4096] = {};
+  size_t tx_buffer_size_ = 0;
+};
+
+
 /// A factory which can create transports given an optional set of
 /// commandline arguments.
 class TransportFactory {
@@ -1020,6 +1323,62 @@ class SocketcanFactory : public TransportFactory {
   }
 };
 
+class Rs485Factory : public TransportFactory {
+ public:
+  virtual ~Rs485Factory() {}
+
+  virtual int priority() override { return 12; }
+  virtual std::string name() override { return "rs485"; }
+
+  virtual TransportArgPair make(const std::vector<std::string>& args_in) override {
+    auto args = args_in;
+
+    Rs485::Options options;
+    std::string device;
+
+    {
+      auto it = std::find(args.begin(), args.end(), "--rs485");
+      if (it != args.end()) {
+        if ((it + 1) != args.end()) {
+          device = *(it + 1);
+          args.erase(it, it + 2);
+        } else {
+          throw std::runtime_error("--rs485 requires a path");
+        }
+      }
+    }
+
+    {
+      auto it = std::find(args.begin(), args.end(), "--rs485-baud");
+      if (it != args.end()) {
+        if ((it + 1) != args.end()) {
+          options.baud_rate = std::stoi(*(it + 1));
+          args.erase(it, it + 2);
+        } else {
+          throw std::runtime_error("--rs485-baud requires a value");
+        }
+      }
+    }
+
+    auto result = std::make_shared<Rs485>(device, options);
+    return TransportArgPair(result, args);
+  }
+
+  virtual std::vector<Argument> cmdline_arguments() override {
+    return {
+      { "--rs485", 1, "path to RS485 serial device" },
+      { "--rs485-baud", 1, "RS485 baud rate" },
+    };
+  }
+
+  virtual bool is_args_set(const std::vector<std::string>& args) override {
+    for (const auto& arg : args) {
+      if (arg == "--rs485") { return true; }
+    }
+    return false;
+  }
+};
+
 class TransportRegistry {
  public:
   template <typename T>
@@ -1107,6 +1466,7 @@ class TransportRegistry {
   TransportRegistry() {
     Register<FdcanusbFactory>();
     Register<SocketcanFactory>();
+    Register<Rs485Factory>();
   }
 
   std::vector<std::shared_ptr<TransportFactory>> items_;
@@ -16,6 +16,7 @@
 
 #include <boost/test/auto_unit_test.hpp>
 
+#include <cmath>
 #include <string>
 
 using namespace mjbots;
@@ -203,6 +204,67 @@ BOOST_AUTO_TEST_CASE(GenericQueryParse) {
   BOOST_TEST(result.values[6].value == 64.0);
 }
 
+BOOST_AUTO_TEST_CASE(QueryAuxSnapshot) {
+  moteus::CanData frame;
+  moteus::WriteCanData write_frame(&frame);
+  moteus::Query::Format fmt;
+  fmt.mode = moteus::kIgnore;
+  fmt.position = moteus::kIgnore;
+  fmt.velocity = moteus::kIgnore;
+  fmt.torque = moteus::kIgnore;
+  fmt.voltage = moteus::kIgnore;
+  fmt.temperature = moteus::kIgnore;
+  fmt.fault = moteus::kIgnore;
+  fmt.aux_snapshot = moteus::kInt16;
+  fmt.aux_snapshot_average = true;
+
+  const auto reply_size = moteus::Query::Make(&write_frame, fmt);
+  BOOST_TEST(Hexify(frame) == "140b8801");
+  BOOST_TEST(reply_size == 26);
+
+  moteus::CanData reply{
+    {
+      0x24, 0x0b, 0x88, 0x01,
+      0x05, 0x02,  // gpio
+      0xff, 0x7f,  // aux1 analog 1
+      0x00, 0x00,
+      0x00, 0x00,
+      0x00, 0x00,
+      0x00, 0x00,
+      0x00, 0x00,  // aux2 analog 1
+      0x00, 0x80,  // aux2 analog 2
+      0x00, 0x00,
+      0x00, 0x00,
+      0xff, 0x3f,  // aux2 analog 5
+    },
+    26,
+  };
+
+  const auto result = moteus::Query::Parse(&reply);
+  BOOST_TEST(result.aux_snapshot.valid);
+  BOOST_TEST(result.aux_snapshot.aux1_gpio == 5);
+  BOOST_TEST(result.aux_snapshot.aux2_gpio == 2);
+  BOOST_TEST(result.aux_snapshot.aux1_analog[0] == 1.0);
+  BOOST_TEST(std::isnan(result.aux_snapshot.aux2_analog[1]));
+  BOOST_TEST(result.aux_snapshot.aux2_analog[4] == 16383 / 32767.0);
+  BOOST_TEST(result.extra[0].register_number ==
+             std::numeric_limits<int16_t>::max());
+
+  // Partial blocks, or other resolutions, are decoded one register
+  // at a time.
+  moteus::CanData partial{
+    {
+      0x2d, 0x7b,
+      0x00, 0x00, 0x00, 0x3f,  // aux1 analog 3
+    },
+    6,
+  };
+  const auto partial_result = moteus::Query::Parse(&partial);
+  BOOST_TEST(partial_result.aux_snapshot.valid);
+  BOOST_TEST(partial_result.aux_snapshot.aux1_analog[2] == 0.5);
+  BOOST_TEST(partial_result.aux_snapshot.aux1_analog[0] == 0.0);
+}
+
 BOOST_AUTO_TEST_CASE(PositionDefaults) {
   moteus::CanData frame;
   moteus::WriteCanData write_frame(&frame);
@@ -228,6 +290,7 @@ BOOST_AUTO_TEST_CASE(PositionMaximal) {
   cmd.velocity_limit = 5.0;
   cmd.accel_limit = 2.0;
   cmd.fixed_voltage_override = 4.0;
+  cmd.jerk_limit = 100.0;
 
   moteus::PositionMode::Format fmt;
   fmt.position = moteus::kInt16;
@@ -241,10 +304,11 @@ BOOST_AUTO_TEST_CASE(PositionMaximal) {
   fmt.velocity_limit = moteus::kInt16;
   fmt.accel_limit = moteus::kInt16;
   fmt.fixed_voltage_override = moteus::kInt16;
+  fmt.jerk_limit = moteus::kInt16;
 
   const auto reply_size = moteus::PositionMode::Make(&write_frame, cmd, fmt);
 
-  BOOST_TEST(Hexify(frame) == "01000a040b20c409d0076400ff1fff0f2003204ec800204ed0072800");
+  BOOST_TEST(Hexify(frame) == "01000a040c20c409d0076400ff1fff0f2003204ec800204ed00728006400");
   BOOST_TEST(reply_size == 0);
 }
 
@@ -419,3 +483,27 @@ BOOST_AUTO_TEST_CASE(ClockTrim) {
   BOOST_TEST(Hexify(frame) == "097105000000");
   BOOST_TEST(reply_size == 0);
 }
+
+BOOST_AUTO_TEST_CASE(SharedTime) {
+  {
+    moteus::CanData frame;
+    moteus::WriteCanData write_frame(&frame);
+
+    // The time wraps rather than saturating.
+    moteus::SharedTime::Command cmd;
+    cmd.time = 4294.967296 + 1.5;
+
+    moteus::SharedTime::Make(&write_frame, cmd, {});
+    BOOST_TEST(Hexify(frame) == "097460e31600");
+  }
+  {
+    moteus::CanData frame;
+    moteus::WriteCanData write_frame(&frame);
+
+    moteus::SharedTime::Command cmd;
+    cmd.time = -0.000001;
+
+    moteus::SharedTime::Make(&write_frame, cmd, {});
+    BOOST_TEST(Hexify(frame) == "0974ffffffff");
+  }
+}
@@ -16,6 +16,7 @@
 
 #include <boost/test/auto_unit_test.hpp>
 
+#include <map>
 #include <string>
 
 using namespace mjbots;
@@ -401,6 +402,183 @@ std::string Hexify(const uint8_t* data, size_t size) {
 }
 }
 
+BOOST_AUTO_TEST_CASE(Rs485Crc) {
+  const std::string check = "123456789";
+  BOOST_TEST(moteus::Rs485::Crc(
+                 reinterpret_cast<const uint8_t*>(check.data()),
+                 check.size()) == 0x29b1);
+}
+
+namespace {
+std::string Rs485Encode(uint32_t arbitration_id, const std::string& data) {
+  moteus::CanFdFrame frame;
+  frame.arbitration_id = arbitration_id;
+  std::memcpy(frame.data, data.data(), data.size());
+  frame.size = data.size();
+  uint8_t buf[128] = {};
+  const auto size = moteus::Rs485::Encode(frame, buf);
+  return std::string(reinterpret_cast<const char*>(buf), size);
+}
+}
+
+BOOST_AUTO_TEST_CASE(Rs485BasicSingle) {
+  RwPipe pipe;
+  moteus::Rs485::Options options;
+  options.min_rcv_wait_ns = 200000000;
+  moteus::Rs485 dut(pipe.read_fds[0], pipe.write_fds[1], options);
+
+  std::optional<int> result_errno;
+
+  const auto completed = [&](int errno_in) {
+    result_errno = errno_in;
+  };
+
+  moteus::CanFdFrame frame;
+
+  frame.destination = 5;
+  frame.source = 2;
+  frame.reply_required = true;
+
+  frame.arbitration_id = 0x8205;
+  frame.data[0] = 0x20;
+  frame.data[1] = 0x21;
+  frame.data[2] = 0x22;
+  frame.size = 3;
+
+  std::vector<moteus::CanFdFrame> replies;
+
+  dut.Cycle(&frame, 1, &replies, completed);
+
+  const std::string expected = Rs485Encode(0x8205, "\x20\x21\x22");
+  {
+    char buf[64] = {};
+    const auto result = ::fread(buf, expected.size(), 1, pipe.test_read);
+    moteus::Rs485::FailIfErrno(result != 1);
+    BOOST_TEST(Hexify(reinterpret_cast<const uint8_t*>(buf),
+                      expected.size()) ==
+               Hexify(reinterpret_cast<const uint8_t*>(expected.data()),
+                      expected.size()));
+    BOOST_TEST(std::string(buf, 6) == "\x54\xab\x82\x05\x03\x20");
+  }
+
+  BOOST_TEST(!result_errno);
+
+  // Our own transmission echoed back, followed by some garbage and a
+  // frame with a bad checksum, are all ignored.
+  std::string corrupt = Rs485Encode(0x0502, "\x99");
+  corrupt.back() ^= 0x01;
+  pipe.Write(expected + "\x01\x54\x02" + corrupt);
+  ::usleep(100000);
+
+  BOOST_TEST(!result_errno);
+
+  pipe.Write(Rs485Encode(0x0502, "\x12\x34\x56"));
+  ::usleep(100000);
+
+  BOOST_TEST(!!result_errno);
+  BOOST_TEST(*result_errno == 0);
+
+  BOOST_TEST(replies.size() == 1);
+  const auto& r = replies[0];
+  BOOST_TEST(r.destination == 2);
+  BOOST_TEST(r.source == 5);
+  BOOST_TEST(r.arbitration_id == 0x0502);
+  BOOST_TEST(r.size == 3);
+  BOOST_TEST(r.data[0] == 0x12);
+  BOOST_TEST(r.data[1] == 0x34);
+  BOOST_TEST(r.data[2] == 0x56);
+}
+
+BOOST_AUTO_TEST_CASE(Rs485LateReply) {
+  RwPipe pipe;
+  moteus::Rs485::Options options;
+  options.min_rcv_wait_ns = 50000000;
+  options.rx_extra_wait_ns = 50000000;
+  moteus::Rs485 dut(pipe.read_fds[0], pipe.write_fds[1], options);
+
+  std::optional<int> result_errno;
+
+  const auto completed = [&](int errno_in) {
+    result_errno = errno_in;
+  };
+
+  moteus::CanFdFrame frame;
+  frame.destination = 5;
+  frame.source = 0;
+  frame.reply_required = true;
+  frame.arbitration_id = 0x8005;
+  frame.data[0] = 0x11;
+  frame.data[1] = 0x00;
+  frame.size = 2;
+
+  const std::string expected = Rs485Encode(0x8005, std::string("\x11\x00", 2));
+  const auto read_sent = [&]() {
+    char buf[64] = {};
+    const auto result = ::fread(buf, expected.size(), 1, pipe.test_read);
+    moteus::Rs485::FailIfErrno(result != 1);
+    return std::string(buf, expected.size());
+  };
+
+  std::vector<moteus::CanFdFrame> replies;
+
+  // The first request times out.
+  dut.Cycle(&frame, 1, &replies, completed);
+  BOOST_TEST(read_sent() == expected);
+  ::usleep(150000);
+  BOOST_TEST(!!result_errno);
+  BOOST_TEST(replies.size() == 0);
+
+  // Its reply arrives before the next request is sent.
+  pipe.Write(Rs485Encode(0x0500, "\x21\x01"));
+  ::usleep(20000);
+
+  result_errno = {};
+  dut.Cycle(&frame, 1, &replies, completed);
+  BOOST_TEST(read_sent() == expected);
+
+  // A frame from some other device does not complete the cycle.
+  pipe.Write(Rs485Encode(0x0700, "\x21\x02"));
+  ::usleep(20000);
+  BOOST_TEST(!result_errno);
+
+  pipe.Write(Rs485Encode(0x0500, "\x21\x03"));
+  ::usleep(20000);
+
+  BOOST_TEST(!!result_errno);
+  BOOST_TEST_REQUIRE(replies.size() == 1);
+  BOOST_TEST(replies[0].source == 5);
+  BOOST_TEST(replies[0].data[1] == 0x03);
+}
+
+BOOST_AUTO_TEST_CASE(Rs485NoResponse) {
+  RwPipe pipe;
+  moteus::Rs485 dut(pipe.read_fds[0], pipe.write_fds[1]);
+
+  std::optional<int> result_errno;
+
+  const auto completed = [&](int errno_in) {
+    result_errno = errno_in;
+  };
+
+  moteus::CanFdFrame frame;
+  frame.arbitration_id = 0x123;
+  frame.reply_required = false;
+  frame.data[0] = 0x45;
+  frame.data[1] = 0x67;
+  frame.size = 2;
+
+  std::vector<moteus::CanFdFrame> replies;
+
+  dut.Cycle(&frame, 1, &replies, completed);
+  ::usleep(100000);
+
+  // With nothing to wait for, we complete as soon as the frame is
+  // written.
+  BOOST_TEST(!!result_errno);
+  BOOST_TEST(*result_errno == 0);
+  BOOST_TEST(replies.size() == 0);
+}
+
 BOOST_AUTO_TEST_CASE(ControllerBasic) {
   auto impl = std::make_shared<SyncTestTransport>();
 
@@ -905,18 +1083,23 @@ class DiagnosticTestTransport : public PostTransport {
   }
 
   void ProcessClientToServer() {
-    const auto maybe_newline = client_to_server.find_first_of("\r\n");
-    if (maybe_newline == std::string::npos) { return; }
-
-    const auto line = client_to_server.substr(0, maybe_newline);
-    client_to_server = client_to_server.substr(maybe_newline + 1);
-    ProcessClientToServerLine(line);
+    while (true) {
+      const auto maybe_newline = client_to_server.find_first_of("\r\n");
+      if (maybe_newline == std::string::npos) { return; }
+
+      const auto line = client_to_server.substr(0, maybe_newline);
+      client_to_server = client_to_server.substr(maybe_newline + 1);
+      max_pending = std::max(max_pending, client_to_server.size());
+      ProcessClientToServerLine(line);
+    }
   }
 
   void ProcessClientToServerLine(const std::string& line) {
     if (StartsWith(line, "conf get ")) {
       // We'll reply with all conf gets in the same way.
       server_to_client += "4.0000\r\n";
+    } else if (StartsWith(line, "conf set bad")) {
+      server_to_client += "ERR error setting\r\n";
     } else if (StartsWith(line, "conf set ")) {
       server_to_client += "OK\r\n";
     } else if (line == "conf enumerate") {
@@ -931,7 +1114,7 @@ class DiagnosticTestTransport : public PostTransport {
 
   std::string client_to_server;
   std::string server_to_client;
-
+  size_t max_pending = 0;
 };
 }
 
@@ -997,6 +1180,44 @@ BOOST_AUTO_TEST_CASE(ControllerAsyncDiagnosticTest) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(ControllerDiagnosticBatchTest) {
+  auto transport = std::make_shared<DiagnosticTestTransport>();
+  moteus::Controller::Options options;
+  options.transport = transport;
+  options.diagnostic_batch_window = 64;
+  moteus::Controller dut(options);
+
+  {
+    std::vector<std::string> messages;
+    for (int i = 0; i < 20; i++) {
+      messages.push_back("conf set servo.pid_position.kp " + std::to_string(i));
+    }
+    messages[5] = "conf set bad.value 1";
+    messages.push_back("conf enumerate");
+
+    const auto result = dut.DiagnosticCommandBatch(messages);
+    BOOST_TEST(result.size() == 21);
+    BOOST_TEST(result[0] == "");
+    BOOST_TEST(result[5] == "ERR error setting");
+    BOOST_TEST(result[19] == "");
+    BOOST_TEST(result[20] == "id.id 0\r\nstuff.bar 1\r\nbing.baz 234\r\n");
+
+    // Multiple commands were queued at once, but never more than the
+    // window.
+    BOOST_TEST(transport->max_pending > 0);
+    BOOST_TEST(transport->max_pending < 64);
+  }
+
+  {
+    const auto result = dut.DiagnosticCommandBatch(
+        {"conf get servo.pid_position.kp", "conf get servo.pid_position.kd"},
+        moteus::Controller::kExpectSingleLine);
+    BOOST_TEST(result.size() == 2);
+    BOOST_TEST(result[0] == "4.0000");
+    BOOST_TEST(result[1] == "4.0000");
+  }
+}
+
 BOOST_AUTO_TEST_CASE(ControllerDiagnosticWrite) {
   auto transport = std::make_shared<SyncTestTransport>();
   moteus::Controller::Options options;
@@ -1092,6 +1313,108 @@ class PositionWaitTestTransport : public PostTransport {
 };
 }
 
+namespace {
+// Reports each controller as homed after it has been queried a
+// controller specific number of times.
+class HomingTestTransport : public PostTransport {
+ public:
+  virtual void Cycle(const moteus::CanFdFrame* frames,
+                     size_t size,
+                     std::vector<moteus::CanFdFrame>* replies,
+                     moteus::CompletionCallback completed_callback) {
+    cycle_sizes.push_back(size);
+
+    for (size_t i = 0; i < size; i++) {
+      const auto& f = frames[i];
+      sent.push_back(f);
+      if (!f.reply_required) { continue; }
+
+      // Only frames which query the home state count.
+      if (std::string(reinterpret_cast<const char*>(f.data), f.size).find(
+              '\x0c') == std::string::npos) {
+        continue;
+      }
+
+      const int count = ++counts[f.destination];
+
+      moteus::CanFdFrame qr;
+      qr.source = f.destination;
+      qr.destination = f.source;
+      qr.can_prefix = f.can_prefix;
+      qr.arbitration_id = (qr.source << 8) | qr.destination;
+      qr.data[0] = 0x21;
+      qr.data[1] = 0x0c;
+      qr.data[2] = count >= cycles_to_home[f.destination] ? 1 : 0;
+      qr.size = 3;
+      replies->push_back(qr);
+    }
+
+    Post(std::bind(completed_callback, 0));
+    ProcessQueue();
+  }
+
+  std::map<int, int> cycles_to_home;
+  std::map<int, int> counts;
+  std::vector<size_t> cycle_sizes;
+  std::vector<moteus::CanFdFrame> sent;
+};
+
+// Return the position written by a command frame, or a finite
+// sentinel if it contains none.
+double WrittenPosition(const moteus::CanFdFrame& frame) {
+  moteus::MultiplexParser parser(frame.data, frame.size);
+  while (parser.remaining()) {
+    const auto cmd = static_cast<uint8_t>(parser.Read<int8_t>());
+    if (cmd >= 0x20) { break; }
+
+    int count = cmd & 0x03;
+    if (count == 0) { count = parser.ReadVaruint(); }
+    auto reg = parser.ReadVaruint();
+
+    // Reads carry no data.
+    if (cmd >= 0x10) { continue; }
+
+    const auto res = static_cast<moteus::Resolution>((cmd >> 2) & 0x03);
+    for (int i = 0; i < count; i++, reg++) {
+      const double value = parser.ReadPosition(res);
+      if (reg == moteus::Register::kCommandPosition) { return value; }
+    }
+  }
+  return 1e9;
+}
+}
+
+BOOST_AUTO_TEST_CASE(ControllerHomeAll) {
+  auto transport = std::make_shared<HomingTestTransport>();
+  transport->cycles_to_home = {{1, 3}, {2, 6}, {3, 1}};
+
+  std::vector<std::shared_ptr<moteus::Controller>> controllers;
+  for (int id : {1, 2, 3}) {
+    moteus::Controller::Options options;
+    options.id = id;
+    options.transport = transport;
+    controllers.push_back(std::make_shared<moteus::Controller>(options));
+  }
+
+  moteus::Controller::HomeOptions options;
+  options.period_s = 0.0;
+  const auto result = moteus::Controller::HomeAll(controllers, options);
+
+  BOOST_TEST(result == std::vector<bool>({true, true, true}),
+             tt::per_element());
+
+  // One cycle for the reindex, one per iteration until the slowest
+  // is homed, and one final hold.
+  BOOST_TEST(transport->cycle_sizes == std::vector<size_t>(8, 3),
+             tt::per_element());
+
+  // The search and the final hold must not command a position.
+  BOOST_TEST(transport->sent.size() == 24);
+  for (size_t i = 3; i < transport->sent.size(); i++) {
+    BOOST_TEST(std::isnan(WrittenPosition(transport->sent[i])));
+  }
+}
+
 BOOST_AUTO_TEST_CASE(ControllerPositionWait) {
   auto impl = std::make_shared<PositionWaitTestTransport>();
 
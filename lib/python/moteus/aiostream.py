@@ -88,6 +88,12 @@ class AioStream:
             if not block or remaining == 0:
                 return accumulated_result
 
+    def discard_input(self):
+        '''Drop any data which has been received but not yet read.'''
+        with self._read_lock:
+            if hasattr(self.fd, 'reset_input_buffer'):
+                self.fd.reset_input_buffer()
+
     def write(self, data: Union[bytearray, bytes, memoryview]) -> int:
         self._write_data += data
 
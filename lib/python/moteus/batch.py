@@ -0,0 +1,134 @@
+# Copyright 2023 mjbots Robotic Systems, LLC.  info@mjbots.com
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import asyncio
+
+
+class BatchTransport:
+    """Wraps another transport, so that calls to 'cycle' from
+    concurrent coroutines are coalesced into a single call of the
+    wrapped transport.  This lets code which commands each controller
+    from its own coroutine run with the bus efficiency of one 'cycle'
+    for all of them:
+
+      transport = moteus.BatchTransport(moteus.Fdcanusb())
+      controllers = [moteus.Controller(id=x, transport=transport)
+                     for x in [1, 2, 3]]
+      results = await asyncio.gather(
+          *[c.set_position(position=math.nan, query=True)
+            for c in controllers])
+
+    Calls made within the same event loop iteration are coalesced, as
+    are any made while a previous batch is in progress.
+    """
+
+    def __init__(self, transport, window_us=0):
+        """Args:
+
+          transport: the transport to send batches through
+          window_us: if non-zero, how long to wait after the first
+            call for others to join a batch.  The resolution is that
+            of the event loop timer, typically around 1ms.
+        """
+        self._transport = transport
+        self._window_s = window_us * 1e-6
+        self._pending = []
+        self._task = None
+
+    async def cycle(self, commands):
+        future = asyncio.get_running_loop().create_future()
+        self._pending.append((list(commands), future))
+        if self._task is None:
+            self._task = asyncio.create_task(self._run())
+        return await future
+
+    async def write(self, command):
+        await self._transport.write(command)
+
+    async def read(self):
+        return await self._transport.read()
+
+    async def _run(self):
+        try:
+            # Give every coroutine which is ready in this iteration,
+            # or within the window, a chance to join.
+            await asyncio.sleep(self._window_s)
+
+            while self._pending:
+                batch, self._pending = self._pending, []
+                await self._cycle_batch(batch)
+        finally:
+            self._task = None
+
+    async def _cycle_batch(self, batch):
+        commands = [x for commands, _ in batch for x in commands]
+        try:
+            results = await self._transport.cycle(commands)
+        except Exception as e:
+            for _, future in batch:
+                if not future.done():
+                    future.set_exception(e)
+            return
+
+        for (_, future), result in zip(batch, _distribute(batch, results)):
+            if not future.done():
+                future.set_result(result)
+
+
+def _distribute(batch, results):
+    '''Split the results of a combined 'cycle' into the results for
+    each call in batch.
+
+    Transports like Router may return results in a different order
+    than the commands, so each result which names its source is given
+    to the first outstanding command addressed to that source.  Any
+    others are assigned by position if the transport returned one
+    result per command, or else to the outstanding commands in order.
+    '''
+    sizes = [len(commands) for commands, _ in batch]
+    per_command = len(results) == sum(sizes)
+
+    slots = [(index, offset, command)
+             for index, (commands, _) in enumerate(batch)
+             for offset, command in enumerate(commands)]
+    replies = [[None] * size for size in sizes]
+    outstanding = [x for x in slots if x[2].reply_required]
+
+    def assign(slot, result):
+        index, offset, _ = slot
+        replies[index][offset] = result
+        if slot in outstanding:
+            outstanding.remove(slot)
+
+    unmatched = []
+    for position, result in enumerate(results):
+        source = getattr(result, 'id', None)
+        slot = next((x for x in outstanding
+                     if source is not None and x[2].destination == source),
+                    None)
+        if slot is not None:
+            assign(slot, result)
+        elif result is not None:
+            unmatched.append((position, result))
+
+    for position, result in unmatched:
+        slot = slots[position] if per_command else None
+        if slot is not None and replies[slot[0]][slot[1]] is None:
+            assign(slot, result)
+        elif outstanding:
+            assign(outstanding[0], result)
+
+    if per_command:
+        return replies
+    return [[x for x in y if x is not None] for y in replies]
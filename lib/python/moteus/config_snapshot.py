@@ -0,0 +1,145 @@
+# Copyright 2023 mjbots Robotic Systems, LLC.  info@mjbots.com
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+'''A binary copy of the complete persistent configuration of a
+controller, as reported by the "conf schema" and "conf data"
+commands.'''
+
+import hashlib
+import io
+import struct
+
+from . import reader
+
+
+MAGIC = b'MOTEUSCFG\x01'
+
+
+class SchemaMismatchError(RuntimeError):
+    pass
+
+
+def _format_float32(value):
+    # Use the shortest representation which reproduces the same
+    # float32, so that values like 0.005 are not printed as
+    # 0.00499999989.
+    for precision in range(6, 10):
+        result = f'{value:.{precision}g}'
+        if struct.pack('<f', float(result)) == struct.pack('<f', value):
+            return result
+    return repr(value)
+
+
+def _flatten(prefix, type_class, value, result):
+    if isinstance(type_class, reader.ObjectType):
+        for field, item in zip(type_class.fields, value):
+            _flatten(f'{prefix}.{field.name}', field.type_class, item, result)
+    elif (isinstance(type_class, reader.FixedArrayType) or
+          isinstance(type_class, reader.ArrayType)):
+        for index, item in enumerate(value):
+            _flatten(f'{prefix}.{index}', type_class.type_class, item, result)
+    elif isinstance(type_class, reader.NullType):
+        pass
+    elif isinstance(type_class, reader.EnumType):
+        result.append((prefix, str(int(value))))
+    elif isinstance(type_class, reader.BooleanType):
+        result.append((prefix, '1' if value else '0'))
+    elif isinstance(type_class, reader.Float32Type):
+        result.append((prefix, _format_float32(value)))
+    else:
+        result.append((prefix, str(value)))
+
+
+def _write_sized(fp, data):
+    fp.write(struct.pack('<I', len(data)))
+    fp.write(data)
+
+
+def _read_sized(fp):
+    size_data = fp.read(4)
+    if len(size_data) != 4:
+        raise EOFError()
+    size, = struct.unpack('<I', size_data)
+    data = fp.read(size)
+    if len(data) != size:
+        raise EOFError()
+    return data
+
+
+def schema_hash(schemas):
+    '''Return a hash identifying a sequence of (name, schema) tuples.'''
+    h = hashlib.sha256()
+    for name, schema in schemas:
+        h.update(struct.pack('<I', len(name)))
+        h.update(name.encode('latin1'))
+        h.update(struct.pack('<I', len(schema)))
+        h.update(schema)
+    return h.digest()
+
+
+class ConfigSnapshot:
+    def __init__(self, groups):
+        '''groups is a list of (name, schema, data) tuples.'''
+        self.groups = groups
+
+    def schema_hash(self):
+        return schema_hash([(name, schema) for name, schema, _ in self.groups])
+
+    def items(self):
+        '''Return a list of (key, value) strings, in the same form as
+        "conf enumerate".'''
+        result = []
+        for name, schema, data in self.groups:
+            type_class = reader.Type.from_binary(io.BytesIO(schema))
+            value = reader.Decoder(type_class).decode(data)
+            _flatten(name, type_class, value, result)
+        return result
+
+    def to_text(self):
+        return '\n'.join(f'{key} {value}'
+                         for key, value in self.items()).encode('latin1')
+
+    def serialize(self):
+        fp = io.BytesIO()
+        fp.write(MAGIC)
+        fp.write(self.schema_hash())
+        fp.write(struct.pack('<I', len(self.groups)))
+        for name, schema, data in self.groups:
+            _write_sized(fp, name.encode('latin1'))
+            _write_sized(fp, schema)
+            _write_sized(fp, data)
+        return fp.getvalue()
+
+    @staticmethod
+    def is_snapshot(data):
+        return data.startswith(MAGIC)
+
+    @staticmethod
+    def deserialize(data):
+        fp = io.BytesIO(data)
+        if fp.read(len(MAGIC)) != MAGIC:
+            raise RuntimeError('not a config snapshot')
+        expected_hash = fp.read(32)
+        count, = struct.unpack('<I', fp.read(4))
+        groups = []
+        for _ in range(count):
+            name = _read_sized(fp).decode('latin1')
+            schema = _read_sized(fp)
+            data = _read_sized(fp)
+            groups.append((name, schema, data))
+
+        result = ConfigSnapshot(groups)
+        if result.schema_hash() != expected_hash:
+            raise RuntimeError('config snapshot is corrupt')
+        return result
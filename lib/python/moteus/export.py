@@ -19,25 +19,37 @@ ALL = [
     'aiostream',
     'make_transport_args', 'get_singleton_transport',
     'Fdcanusb', 'Router', 'Controller', 'Register', 'Transport',
+    'BatchTransport',
     'PythonCan',
+    'Rs485',
     'Mode', 'QueryResolution', 'PositionResolution', 'Command', 'CommandError',
+    'HomeState', 'home_all',
+    'SharedClock',
+    'AuxSnapshot', 'parse_aux_snapshot',
     'Stream',
     'TRANSPORT_FACTORIES',
     'INT8', 'INT16', 'INT32', 'F32', 'IGNORE',
     'reader',
+    'thermal',
 ]
+from moteus.batch import BatchTransport
 from moteus.command import Command
 from moteus.fdcanusb import Fdcanusb
 from moteus.router import Router
 from moteus.transport import Transport
 from moteus.pythoncan import PythonCan
+from moteus.rs485 import Rs485
 from moteus.moteus import (
     CommandError,
     Controller, Register, Mode, QueryResolution, PositionResolution, Stream,
+    HomeState, home_all,
+    SharedClock,
+    AuxSnapshot, parse_aux_snapshot,
     make_transport_args, get_singleton_transport,
     TRANSPORT_FACTORIES)
 from moteus.multiplex import (INT8, INT16, INT32, F32, IGNORE)
 import moteus.reader as reader
+import moteus.thermal as thermal
 import moteus.aiostream as aiostream
 
 try:
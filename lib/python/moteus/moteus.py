@@ -14,18 +14,22 @@
 
 import asyncio
 import argparse
+import collections
 import copy
 import enum
 import importlib_metadata
 import io
 import math
 import struct
+import time
 
 from . import multiplex as mp
 from . import command as cmd
 from . import fdcanusb
 from . import pythoncan
+from . import rs485
 
+import moteus.config_snapshot
 import moteus.reader
 
 class FdcanusbFactory:
@@ -91,10 +95,34 @@ class PythonCanFactory:
         return pythoncan.PythonCan(**kwargs)
 
 
+class Rs485Factory:
+    PRIORITY = 12
+
+    name = 'rs485'
+
+    def add_args(self, parser):
+        parser.add_argument('--rs485', type=str, metavar='FILE',
+                            help='path to RS485 serial device')
+        parser.add_argument('--rs485-baud', type=int, metavar='BAUD',
+                            help='RS485 baud rate (default: 3000000)')
+
+    def is_args_set(self, args):
+        return args and args.rs485
+
+    def __call__(self, args):
+        if not args or not args.rs485:
+            raise RuntimeError('no RS485 device specified')
+        kwargs = {}
+        if args.rs485_baud:
+            kwargs['baudrate'] = args.rs485_baud
+        return rs485.Rs485(args.rs485, **kwargs)
+
+
 '''External callers may insert additional factories into this list.'''
 TRANSPORT_FACTORIES = [
     FdcanusbFactory(),
     PythonCanFactory(),
+    Rs485Factory(),
 ] + [ep.load()() for ep in
      importlib_metadata.entry_points().select(group='moteus.transports')]
 
@@ -199,6 +227,8 @@ class Register(enum.IntEnum):
     COMMAND_VELOCITY_LIMIT = 0x028
     COMMAND_ACCEL_LIMIT = 0x029
     COMMAND_FIXED_VOLTAGE_OVERRIDE = 0x02a
+    COMMAND_JERK_LIMIT = 0x02b
+    COMMAND_ARRIVAL_TIME = 0x02c
 
     POSITION_KP = 0x030
     POSITION_KI = 0x031
@@ -212,6 +242,7 @@ class Register(enum.IntEnum):
     POSITION_ERROR = 0x03b
     VELOCITY_ERROR = 0x03c
     TORQUE_ERROR = 0x03d
+    LOAD_TORQUE = 0x03e
 
     COMMAND_WITHIN_LOWER_BOUND = 0x040
     COMMAND_WITHIN_UPPER_BOUND = 0x041
@@ -248,6 +279,54 @@ class Register(enum.IntEnum):
 
     MILLISECOND_COUNTER = 0x070
     CLOCK_TRIM = 0x071
+    COMMAND_LATENCY = 0x072
+    CONTROL_CYCLE = 0x073
+    SHARED_TIME = 0x074
+
+    AUX_SNAPSHOT_GPIO = 0x078
+    AUX_SNAPSHOT_AUX1_ANALOG_IN1 = 0x079
+    AUX_SNAPSHOT_AUX1_ANALOG_IN2 = 0x07a
+    AUX_SNAPSHOT_AUX1_ANALOG_IN3 = 0x07b
+    AUX_SNAPSHOT_AUX1_ANALOG_IN4 = 0x07c
+    AUX_SNAPSHOT_AUX1_ANALOG_IN5 = 0x07d
+    AUX_SNAPSHOT_AUX2_ANALOG_IN1 = 0x07e
+    AUX_SNAPSHOT_AUX2_ANALOG_IN2 = 0x07f
+    AUX_SNAPSHOT_AUX2_ANALOG_IN3 = 0x080
+    AUX_SNAPSHOT_AUX2_ANALOG_IN4 = 0x081
+    AUX_SNAPSHOT_AUX2_ANALOG_IN5 = 0x082
+
+    AUX_AVERAGE_GPIO = 0x088
+    AUX_AVERAGE_AUX1_ANALOG_IN1 = 0x089
+    AUX_AVERAGE_AUX1_ANALOG_IN2 = 0x08a
+    AUX_AVERAGE_AUX1_ANALOG_IN3 = 0x08b
+    AUX_AVERAGE_AUX1_ANALOG_IN4 = 0x08c
+    AUX_AVERAGE_AUX1_ANALOG_IN5 = 0x08d
+    AUX_AVERAGE_AUX2_ANALOG_IN1 = 0x08e
+    AUX_AVERAGE_AUX2_ANALOG_IN2 = 0x08f
+    AUX_AVERAGE_AUX2_ANALOG_IN3 = 0x090
+    AUX_AVERAGE_AUX2_ANALOG_IN4 = 0x091
+    AUX_AVERAGE_AUX2_ANALOG_IN5 = 0x092
+
+    STATS_Q_CURRENT_MIN = 0x0a0
+    STATS_Q_CURRENT_MAX = 0x0a1
+    STATS_Q_CURRENT_MEAN = 0x0a2
+    STATS_TORQUE_MIN = 0x0a3
+    STATS_TORQUE_MAX = 0x0a4
+    STATS_TORQUE_MEAN = 0x0a5
+    STATS_VELOCITY_MIN = 0x0a6
+    STATS_VELOCITY_MAX = 0x0a7
+    STATS_VELOCITY_MEAN = 0x0a8
+    STATS_COUNT = 0x0a9
+
+    HEARTBEAT = 0x0b0
+    TIMEOUT_CAUSE = 0x0b1
+    COMMAND_TIMEOUT_COUNT = 0x0b2
+    HEARTBEAT_TIMEOUT_COUNT = 0x0b3
+    MISSED_HEARTBEAT_COUNT = 0x0b4
+
+    TIME_TO_DERATE = 0x0c0
+    FET_TEMPERATURE_RISE = 0x0c1
+    MOTOR_TEMPERATURE_RISE = 0x0c2
 
     REGISTER_MAP_VERSION = 0x102
     SERIAL_NUMBER = 0x120
@@ -309,6 +388,12 @@ class QueryResolution:
     aux1_gpio = mp.IGNORE
     aux2_gpio = mp.IGNORE
 
+    # Read the whole aux snapshot block.  mp.INT16 is the most compact
+    # form.  If aux_snapshot_average is set, the analog inputs are
+    # averaged over the interval since they were last read this way.
+    aux_snapshot = mp.IGNORE
+    aux_snapshot_average = False
+
     # Additional registers can be queried by enumerating them as keys
     # in this dictionary, with the resolution as the matching value.
     _extra = {
@@ -328,6 +413,10 @@ class PositionResolution:
     velocity_limit = mp.F32
     accel_limit = mp.F32
     fixed_voltage_override = mp.F32
+    jerk_limit = mp.F32
+    # The shared time base wraps, so this is normally sent as INT32
+    # microseconds.
+    arrival_time = mp.INT32
 
 
 class VFOCResolution:
@@ -351,6 +440,9 @@ class Parser(mp.RegisterParser):
     def read_accel(self, resolution):
         return self.read_mapped(resolution, 0.05, 0.001, 0.00001)
 
+    def read_jerk(self, resolution):
+        return self.read_mapped(resolution, 10.0, 1.0, 0.001)
+
     def read_torque(self, resolution):
         return self.read_mapped(resolution, 0.5, 0.01, 0.001)
 
@@ -370,6 +462,9 @@ class Parser(mp.RegisterParser):
     def read_current(self, resolution):
         return self.read_mapped(resolution, 1.0, 0.1, 0.001)
 
+    def read_duration(self, resolution):
+        return self.read_mapped(resolution, 1.0, 0.1, 0.001)
+
     def ignore(self, resolution):
         self._offset += mp.resolution_size(resolution)
 
@@ -384,6 +479,9 @@ class Writer(mp.WriteFrame):
     def write_accel(self, value, resolution):
         self.write_mapped(value, 0.05, 0.001, 0.00001, resolution)
 
+    def write_jerk(self, value, resolution):
+        self.write_mapped(value, 10.0, 1.0, 0.001, resolution)
+
     def write_torque(self, value, resolution):
         self.write_mapped(value, 0.5, 0.01, 0.001, resolution)
 
@@ -406,6 +504,19 @@ class Writer(mp.WriteFrame):
     def write_current(self, value, resolution):
         self.write_mapped(value, 1.0, 0.1, 0.001, resolution)
 
+    def write_shared_time(self, value, resolution):
+        """Write a time in the shared time base.  As INT32 it is the
+        number of microseconds, wrapped rather than saturated."""
+        if resolution != mp.INT32 or not math.isfinite(value):
+            self.write_time(value, resolution)
+            return
+
+        us = round(value * 1e6) & 0xffffffff
+        if us >= 0x80000000:
+            us -= 0x100000000
+        # The minimum value is reserved to mean "unset".
+        self.write_int32(max(us, -2147483647))
+
 
 def parse_register(parser, register, resolution):
     if register == Register.MODE:
@@ -456,6 +567,8 @@ def parse_register(parser, register, resolution):
         return parser.read_velocity(resolution)
     elif register == Register.TORQUE_ERROR:
         return parser.read_torque(resolution)
+    elif register == Register.LOAD_TORQUE:
+        return parser.read_torque(resolution)
     elif register == Register.ENCODER_0_POSITION:
         return parser.read_position(resolution)
     elif register == Register.ENCODER_0_VELOCITY:
@@ -489,16 +602,77 @@ def parse_register(parser, register, resolution):
           register == Register.AUX2_ANALOG_IN4 or
           register == Register.AUX2_ANALOG_IN5):
         return parser.read_pwm(resolution)
+    elif (register == Register.AUX_SNAPSHOT_GPIO or
+          register == Register.AUX_AVERAGE_GPIO):
+        return parser.read_int(resolution)
+    elif (Register.AUX_SNAPSHOT_AUX1_ANALOG_IN1 <= register <=
+          Register.AUX_SNAPSHOT_AUX2_ANALOG_IN5 or
+          Register.AUX_AVERAGE_AUX1_ANALOG_IN1 <= register <=
+          Register.AUX_AVERAGE_AUX2_ANALOG_IN5):
+        return parser.read_pwm(resolution)
+    elif (register == Register.STATS_Q_CURRENT_MIN or
+          register == Register.STATS_Q_CURRENT_MAX or
+          register == Register.STATS_Q_CURRENT_MEAN):
+        return parser.read_current(resolution)
+    elif (register == Register.STATS_TORQUE_MIN or
+          register == Register.STATS_TORQUE_MAX or
+          register == Register.STATS_TORQUE_MEAN):
+        return parser.read_torque(resolution)
+    elif (register == Register.STATS_VELOCITY_MIN or
+          register == Register.STATS_VELOCITY_MAX or
+          register == Register.STATS_VELOCITY_MEAN):
+        return parser.read_velocity(resolution)
+    elif register == Register.STATS_COUNT:
+        return parser.read_int(resolution)
+    elif Register.HEARTBEAT <= register <= Register.MISSED_HEARTBEAT_COUNT:
+        return parser.read_int(resolution)
+    elif register == Register.TIME_TO_DERATE:
+        return parser.read_duration(resolution)
+    elif (register == Register.FET_TEMPERATURE_RISE or
+          register == Register.MOTOR_TEMPERATURE_RISE):
+        return parser.read_temperature(resolution)
     elif register == Register.MILLISECOND_COUNTER:
         return parser.read_int(resolution)
     elif register == Register.CLOCK_TRIM:
         return parser.read_int(resolution)
+    elif register == Register.COMMAND_LATENCY:
+        return parser.read_int(resolution)
+    elif register == Register.CONTROL_CYCLE:
+        return parser.read_int(resolution)
+    elif register == Register.SHARED_TIME:
+        return parser.read_time(resolution)
     else:
         # We don't know what kind of value this is, so we don't know
         # the units.
         return parser.read(resolution)
 
 
+AUX_SNAPSHOT_SIZE = 11
+_AUX_SNAPSHOT_STRUCT = struct.Struct('<11h')
+
+
+def _parse_aux_snapshot_block(parser, register, result):
+    '''Decode a whole aux snapshot block read as INT16 at once.
+
+    Returns False, consuming nothing, if the block is not complete.'''
+    if parser._remaining < AUX_SNAPSHOT_SIZE - 1:
+        return False
+    if parser._offset + _AUX_SNAPSHOT_STRUCT.size > parser.size:
+        return False
+
+    values = _AUX_SNAPSHOT_STRUCT.unpack_from(parser.data, parser._offset)
+    parser._offset += _AUX_SNAPSHOT_STRUCT.size
+    parser._remaining -= AUX_SNAPSHOT_SIZE - 1
+    parser._current_register += AUX_SNAPSHOT_SIZE - 1
+
+    result[register] = values[0]
+    for i in range(1, AUX_SNAPSHOT_SIZE):
+        value = values[i]
+        result[register + i] = (
+            math.nan if value == -32768 else value / 32767.0)
+    return True
+
+
 def parse_reply(data):
     parser = Parser(data)
     result = {}
@@ -508,10 +682,50 @@ def parse_reply(data):
             break
         resolution = item[2]
         register = item[1]
+        if ((register == Register.AUX_SNAPSHOT_GPIO or
+             register == Register.AUX_AVERAGE_GPIO) and
+            resolution == mp.INT16 and
+            _parse_aux_snapshot_block(parser, register, result)):
+            continue
         result[register] = parse_register(parser, register, resolution)
     return result
 
 
+class AuxSnapshot:
+    '''The aux inputs from either aux snapshot register block.
+
+    Attributes:
+      aux1_gpio, aux2_gpio: GPIO inputs as bitfields
+      aux1_analog, aux2_analog: lists of the 5 analog inputs, from 0 to 1
+    '''
+    aux1_gpio = 0
+    aux2_gpio = 0
+    aux1_analog = []
+    aux2_analog = []
+
+    def __repr__(self):
+        return (f'AuxSnapshot(aux1_gpio={self.aux1_gpio}, ' +
+                f'aux2_gpio={self.aux2_gpio}, ' +
+                f'aux1_analog={self.aux1_analog}, ' +
+                f'aux2_analog={self.aux2_analog})')
+
+
+def parse_aux_snapshot(values, average=False):
+    '''Return an AuxSnapshot from the values of a query result, or None
+    if the requested block was not present.'''
+    base = Register.AUX_AVERAGE_GPIO if average else Register.AUX_SNAPSHOT_GPIO
+    if base not in values:
+        return None
+
+    result = AuxSnapshot()
+    gpio = int(values[base])
+    result.aux1_gpio = gpio & 0xff
+    result.aux2_gpio = (gpio >> 8) & 0xff
+    result.aux1_analog = [values.get(base + 1 + i) for i in range(5)]
+    result.aux2_analog = [values.get(base + 6 + i) for i in range(5)]
+    return result
+
+
 class Result:
     id = None
     arbitration_id = None
@@ -663,6 +877,16 @@ class Controller:
 
         expected_reply_size += c3.reply_size
 
+        if qr.aux_snapshot != mp.IGNORE:
+            c_aux = mp.WriteCombiner(
+                writer, 0x10,
+                int(Register.AUX_AVERAGE_GPIO if qr.aux_snapshot_average
+                    else Register.AUX_SNAPSHOT_GPIO),
+                [qr.aux_snapshot] * AUX_SNAPSHOT_SIZE)
+            for _ in range(c_aux.size()):
+                c_aux.maybe_write()
+            expected_reply_size += c_aux.reply_size
+
         if len(qr._extra):
             min_val = int(min(qr._extra.keys()))
             max_val = int(max(qr._extra.keys()))
@@ -841,6 +1065,48 @@ class Controller:
         return await self.execute(self.make_require_reindex(
             query=query, query_override=query_override))
 
+    def make_heartbeat(self, *, query=False, query_override=None):
+        """Return a moteus.Command which resets the heartbeat watchdog
+        configured with servo.heartbeat_period_s, without changing the
+        current command."""
+        result = self._make_command(
+            query=query, query_override=query_override)
+
+        data_buf = io.BytesIO()
+        writer = Writer(data_buf)
+        writer.write_int8(mp.WRITE_INT8 | 0x01)
+        writer.write_varuint(Register.HEARTBEAT)
+        writer.write_int8(1)
+
+        result.data = data_buf.getvalue()
+        return result
+
+    async def set_heartbeat(self, *args, **kwargs):
+        return await self.execute(self.make_heartbeat(**kwargs))
+
+    def make_set_shared_time(self, *, time, query=False, query_override=None):
+        """Return a moteus.Command which sets the shared time base, in
+        seconds, used by the arrival_time of position commands.
+
+        This is normally sent to the broadcast ID, 0x7f, so that all
+        devices on a bus agree.  See moteus.SharedClock."""
+        result = self._make_command(
+            query=query, query_override=query_override)
+
+        data_buf = io.BytesIO()
+        writer = Writer(data_buf)
+        writer.write_int8(mp.WRITE_INT32 | 0x01)
+        writer.write_varuint(Register.SHARED_TIME)
+        writer.write_shared_time(time, mp.INT32)
+
+        self._format_query(query, query_override, data_buf, result)
+
+        result.data = data_buf.getvalue()
+        return result
+
+    async def set_shared_time(self, *args, **kwargs):
+        return await self.execute(self.make_set_shared_time(**kwargs))
+
     def make_position(self,
                       *,
                       position=None,
@@ -854,10 +1120,16 @@ class Controller:
                       velocity_limit=None,
                       accel_limit=None,
                       fixed_voltage_override=None,
+                      jerk_limit=None,
+                      arrival_time=None,
                       query=False,
                       query_override=None):
         """Return a moteus.Command structure with data necessary to send a
-        position mode command with the given values."""
+        position mode command with the given values.
+
+        If arrival_time is set, the motion to position (when it is
+        finite) is timed to end at that value of the shared time base.
+        See moteus.SharedClock."""
 
         result = self._make_command(
             query=query, query_override=query_override)
@@ -875,6 +1147,8 @@ class Controller:
             pr.velocity_limit if velocity_limit is not None else mp.IGNORE,
             pr.accel_limit if accel_limit is not None else mp.IGNORE,
             pr.fixed_voltage_override if fixed_voltage_override is not None else mp.IGNORE,
+            pr.jerk_limit if jerk_limit is not None else mp.IGNORE,
+            pr.arrival_time if arrival_time is not None else mp.IGNORE,
         ]
 
         data_buf = io.BytesIO()
@@ -909,6 +1183,10 @@ class Controller:
             writer.write_accel(accel_limit, pr.accel_limit)
         if combiner.maybe_write():
             writer.write_voltage(fixed_voltage_override, pr.fixed_voltage_override)
+        if combiner.maybe_write():
+            writer.write_jerk(jerk_limit, pr.jerk_limit)
+        if combiner.maybe_write():
+            writer.write_shared_time(arrival_time, pr.arrival_time)
 
         self._format_query(query, query_override, data_buf, result)
 
@@ -1268,16 +1546,172 @@ class Controller:
         return self._extract(await self._get_transport().cycle([command]))
 
 
+class SharedClock:
+    """The host side of the shared time base.
+
+    Broadcast it periodically so that each device's copy stays within
+    the drift of its clock, then command moves using
+    arrival_time=clock.time() + duration:
+
+      clock = moteus.SharedClock(transport=transport)
+      await clock.broadcast()
+      arrival = clock.time() + 2.0
+      await transport.cycle([
+          c.make_position(position=p, velocity=0.0, arrival_time=arrival)
+          for c, p in zip(controllers, positions)])
+    """
+
+    BROADCAST_ID = 0x7f
+
+    def __init__(self, transport=None, time_source=time.monotonic):
+        self._time_source = time_source
+        self._start = time_source()
+        self._controller = Controller(
+            id=self.BROADCAST_ID, transport=transport)
+
+    def time(self):
+        """The current shared time, in seconds."""
+        return self._time_source() - self._start
+
+    def make_broadcast(self):
+        return self._controller.make_set_shared_time(time=self.time())
+
+    async def broadcast(self):
+        await self._controller.execute(self.make_broadcast())
+
+
+class HomeState(enum.IntEnum):
+    RELATIVE = 0
+    ROTOR = 1
+    OUTPUT = 2
+
+
+async def home_all(controllers,
+                   *,
+                   velocity=0.1,
+                   maximum_torque=None,
+                   home_state=HomeState.ROTOR,
+                   require_reindex=True,
+                   period_s=0.01,
+                   timeout_s=10.0,
+                   transport=None):
+    """Simultaneously home several controllers, for instance by
+    searching for an index pulse.
+
+    Each controller is moved at 'velocity' until it reports a
+    HOME_STATE of at least 'home_state', at which point it is held in
+    place.  Every controller is commanded and queried with a single
+    transport cycle per iteration.
+
+    Returns a list with one boolean per controller, which is True if
+    that controller was homed before 'timeout_s' elapsed.
+    """
+
+    if transport is None:
+        transport = controllers[0]._get_transport()
+
+    if require_reindex:
+        await transport.cycle([c.make_require_reindex() for c in controllers])
+
+    query_resolutions = []
+    for c in controllers:
+        qr = copy.deepcopy(c.query_resolution)
+        qr.home_state = mp.INT8
+        query_resolutions.append(qr)
+
+    homed = [False] * len(controllers)
+
+    def make_commands():
+        return [
+            c.make_position(position=math.nan,
+                            velocity=0.0 if done else velocity,
+                            maximum_torque=maximum_torque,
+                            query_override=qr)
+            for c, qr, done in zip(controllers, query_resolutions, homed)
+        ]
+
+    loop = asyncio.get_event_loop()
+    end_time = loop.time() + timeout_s
+
+    while not all(homed) and loop.time() < end_time:
+        results = await transport.cycle(make_commands())
+
+        for result in results:
+            for index, c in enumerate(controllers):
+                if (result.id == c.id and
+                    result.values.get(Register.HOME_STATE, 0) >= home_state):
+                    homed[index] = True
+
+        if not all(homed):
+            await asyncio.sleep(period_s)
+
+    # Leave every controller holding position, whether or not it was
+    # homed.
+    await transport.cycle([
+        c.make_position(position=math.nan, velocity=0.0,
+                        maximum_torque=maximum_torque)
+        for c in controllers])
+
+    return homed
+
+
 class CommandError(RuntimeError):
     def __init__(self, message):
         super(CommandError, self).__init__("Error response:" + message)
         self.message = message
 
 
+SERVO_STREAM_TYPES = {
+    'i8': 'b',
+    'u8': 'B',
+    'i16': 'h',
+    'u16': 'H',
+    'i32': 'i',
+    'u32': 'I',
+    'f32': 'f',
+}
+
+
+def parse_servo_stream_subscriptions(text):
+    '''Parse the reply to "stream list" into a list of
+    (name, type, period_ms) tuples, in record order.'''
+    result = []
+    for line in text.split(b'\n'):
+        fields = line.strip().split(b' ')
+        if len(fields) != 3:
+            continue
+        result.append((fields[0].decode('latin1'),
+                       fields[1].decode('latin1'),
+                       int(fields[2])))
+    return result
+
+
+def parse_servo_stream(data, subscriptions):
+    '''Decode a single servo_stream record.
+
+    Returns a dictionary with the millisecond timestamp in
+    'timestamp_ms' and a value for each field present.'''
+    timestamp_ms, mask = struct.unpack('<IH', data[0:6])
+    result = {'timestamp_ms': timestamp_ms}
+    offset = 6
+    for index, (name, type_name, _) in enumerate(subscriptions):
+        if (mask & (1 << index)) == 0:
+            continue
+        fmt = '<' + SERVO_STREAM_TYPES[type_name]
+        result[name], = struct.unpack_from(fmt, data, offset)
+        offset += struct.calcsize(fmt)
+    return result
+
+
 class Stream:
     """Presents a python file-like interface to the diagnostic stream of a
     moteus controller."""
 
+    # When pipelining commands with 'command_batch', at most this
+    # many bytes of commands are queued in the controller at once.  It
+    # must be less than the controller's tunnel receive buffer.
+    BATCH_WINDOW = 192
+
     def __init__(self, controller, verbose=False, channel=1):
         self.controller = controller
         self.verbose = verbose
@@ -1288,6 +1722,7 @@ class Stream:
         self._write_data = b''
 
         self._readers = {}
+        self._servo_stream = []
 
     def write(self, data):
         self._write_data += data
@@ -1386,6 +1821,48 @@ class Stream:
             result = await self.read_until_OK()
         return result
 
+    async def command_batch(self, commands, allow_any_response=False):
+        '''Send each of 'commands' without waiting for the previous
+        response before sending the next.
+
+        Returns a list with one result per command.  Commands which
+        fail have a CommandError instance as their result rather than
+        raising.'''
+
+        commands = list(commands)
+        results = []
+        outstanding = collections.deque()
+        outstanding_size = 0
+        next_command = 0
+
+        while len(results) < len(commands):
+            while next_command < len(commands):
+                data = commands[next_command] + b'\n'
+                if (outstanding and
+                    outstanding_size + len(data) > self.BATCH_WINDOW):
+                    break
+
+                if self.verbose:
+                    print(f"> {commands[next_command]}")
+                self.write(data)
+                outstanding.append(len(data))
+                outstanding_size += len(data)
+                next_command += 1
+
+            await self.drain()
+
+            if allow_any_response:
+                results.append(await self.readline())
+            else:
+                try:
+                    results.append(await self.read_until_OK())
+                except CommandError as ce:
+                    results.append(ce)
+
+            outstanding_size -= outstanding.popleft()
+
+        return results
+
     async def write_message(self, data):
         if self.verbose:
             print(f"> {data}")
@@ -1411,7 +1888,8 @@ class Stream:
                     f": '{maybe_schema_announce}'")
 
             schema = await self.read_binary_blob()
-            self._readers[name] = moteus.reader.Type.from_binary(io.BytesIO(schema))
+            self._readers[name] = moteus.reader.Decoder(
+                moteus.reader.Type.from_binary(io.BytesIO(schema)))
 
             # Set this to be emitted as binary
             await self.command(f"tel fmt {name} 0".encode('latin1'))
@@ -1426,4 +1904,122 @@ class Stream:
                 f"'{maybe_data_announce}'")
 
         data = await self.read_binary_blob()
-        return reader.read(moteus.reader.Stream(io.BytesIO(data)))
+        return reader.decode(data)
+
+    # Keep "stream sub" commands well within the controller's line
+    # length limit.
+    SERVO_STREAM_MAX_COMMAND = 120
+
+    async def _servo_stream_command(self, data):
+        # Records may already be flowing, so discard any which arrive
+        # before the reply.
+        await self.write_message(data)
+
+        result = b''
+        while True:
+            line = await self.readline()
+            if line == b'emit servo_stream':
+                await self.read_binary_blob()
+                continue
+            if line.startswith(b'OK'):
+                return result
+            if line.startswith(b'ERR'):
+                raise CommandError(line.decode('latin1'))
+            result += (line + b'\n')
+
+    async def subscribe_servo_stream(self, fields):
+        '''Emit the given servo_stream fields, a dictionary of field
+        name to period in milliseconds.  A period of 0 unsubscribes.
+
+        Returns the resulting subscriptions, as from
+        parse_servo_stream_subscriptions.'''
+        commands = []
+        for name, period_ms in fields.items():
+            item = f' {name} {int(period_ms)}'
+            if (not commands or
+                len(commands[-1]) + len(item) >
+                self.SERVO_STREAM_MAX_COMMAND):
+                commands.append('stream sub')
+            commands[-1] += item
+
+        result = b''
+        for command in commands:
+            result = await self._servo_stream_command(
+                command.encode('latin1'))
+
+        self._servo_stream = parse_servo_stream_subscriptions(result)
+        return self._servo_stream
+
+    async def clear_servo_stream(self):
+        await self._servo_stream_command(b'stream clear')
+        self._servo_stream = []
+
+    async def read_servo_stream(self):
+        '''Return the next servo_stream record, as from
+        parse_servo_stream.'''
+        while True:
+            line = await self.readline()
+            if line == b'emit servo_stream':
+                break
+
+        data = await self.read_binary_blob()
+        return parse_servo_stream(data, self._servo_stream)
+
+    async def _read_config_blob(self, kind, announces, name):
+        await self.write_message(f"conf {kind} {name}".encode('latin1'))
+
+        while True:
+            line = await self.readline()
+            if line.startswith(b'ERR'):
+                raise CommandError(line.decode('latin1'))
+            if line in announces:
+                break
+
+        return await self.read_binary_blob()
+
+    async def read_config_schemas(self):
+        '''Return a list of (name, schema) tuples, one for each
+        persistent configuration group.'''
+        names = [x.strip().decode('latin1')
+                 for x in (await self.command(b'conf list')).split(b'\n')
+                 if x.strip() != b'']
+        result = []
+        for name in names:
+            announce = name.encode('latin1')
+            schema = await self._read_config_blob(
+                'schema', [b'schema ' + announce, b'cschema ' + announce], name)
+            result.append((name, schema))
+        return result
+
+    async def read_config_snapshot(self):
+        '''Return a ConfigSnapshot holding the binary schema and data of
+        every persistent configuration group.
+
+        This raises CommandError if the controller does not support
+        binary configuration access.'''
+        groups = []
+        for name, schema in await self.read_config_schemas():
+            data = await self._read_config_blob(
+                'data', [b'cdata ' + name.encode('latin1')], name)
+            groups.append((name, schema, data))
+        return moteus.config_snapshot.ConfigSnapshot(groups)
+
+    async def write_config_snapshot(self, snapshot):
+        '''Restore every value from a ConfigSnapshot.
+
+        The controller's current schema must match that of the
+        snapshot exactly, otherwise SchemaMismatchError is raised and
+        nothing is changed.  Returns a list of any keys which could not
+        be set.  The configuration is not written to flash.'''
+        current = moteus.config_snapshot.schema_hash(
+            await self.read_config_schemas())
+        if current != snapshot.schema_hash():
+            raise moteus.config_snapshot.SchemaMismatchError(
+                "config snapshot schema does not match controller")
+
+        items = snapshot.items()
+        results = await self.command_batch(
+            [f'conf set {key} {value}'.encode('latin1')
+             for key, value in items])
+        return [key for (key, _), result in zip(items, results)
+                if isinstance(result, CommandError)]
@@ -35,6 +35,7 @@ from . import moteus
 from . import aiostream
 from . import regression
 from . import calibrate_encoder as ce
+from . import config_snapshot
 
 MAX_FLASH_BLOCK_SIZE = 32
 
@@ -560,21 +561,30 @@ class Stream:
         await self.command("conf write")
         await self.command(f"d rezero {value}")
 
-    async def do_restore_config(self, config_file):
-        errors = []
+    async def read_config_text(self):
+        '''Return the complete configuration in the form of "conf
+        enumerate", using a binary snapshot if the controller
+        supports it.'''
+        try:
+            return (await self.stream.read_config_snapshot()).to_text()
+        except moteus.CommandError:
+            return await self.command("conf enumerate")
+
+    async def do_save_config(self, config_file):
+        snapshot = await self.stream.read_config_snapshot()
+        with open(config_file, "wb") as fp:
+            fp.write(snapshot.serialize())
 
-        with open(config_file, "r") as fp:
-            for line in fp.readlines():
-                if '#' in line:
-                    line = line[0:line.index('#')]
-                line = line.rstrip()
-                if len(line) == 0:
-                    continue
+    async def do_restore_config(self, config_file):
+        with open(config_file, "rb") as fp:
+            config_data = fp.read()
 
-                try:
-                    await self.command(f'conf set {line}'.encode('latin1'))
-                except moteus.CommandError as ce:
-                    errors.append(line)
+        if config_snapshot.ConfigSnapshot.is_snapshot(config_data):
+            snapshot = config_snapshot.ConfigSnapshot.deserialize(config_data)
+            errors = await self.stream.write_config_snapshot(snapshot)
+        else:
+            errors = await self._restore_text_config(
+                config_data.decode('latin1'))
 
         await self.command(b'conf write')
 
@@ -584,22 +594,33 @@ class Stream:
                 print(f" {line}")
             print()
 
+    async def _restore_text_config(self, config_text):
+        lines = []
+        for line in config_text.splitlines():
+            if '#' in line:
+                line = line[0:line.index('#')]
+            line = line.rstrip()
+            if len(line) == 0:
+                continue
+            lines.append(line)
+
+        results = await self.stream.command_batch(
+            [f'conf set {line}'.encode('latin1') for line in lines])
+        return [line for line, result in zip(lines, results)
+                if isinstance(result, moteus.CommandError)]
+
     async def do_write_config(self, config_file):
         fp = open(config_file, "rb")
         await self.write_config_stream(fp)
 
     async def write_config_stream(self, fp):
-        errors = []
-
-        for line in fp.readlines():
-            line = line.rstrip()
-            if len(line) == 0:
-                continue
+        lines = [line.rstrip() for line in fp.readlines()
+                 if len(line.rstrip()) != 0]
 
-            try:
-                await self.command(line)
-            except moteus.CommandError as ce:
-                errors.append(line.decode('latin1'))
+        results = await self.stream.command_batch(lines)
+        errors = [line.decode('latin1')
+                  for line, result in zip(lines, results)
+                  if isinstance(result, moteus.CommandError)]
 
         if len(errors):
             print("\nSome config could not be set:")
@@ -633,7 +654,7 @@ class Stream:
 
         if not self.args.bootloader_active and not self.args.no_restore_config:
             # Read our old config.
-            old_config = await self.command("conf enumerate")
+            old_config = await self.read_config_text()
 
             # We will just leave this around in a temporary location.
             # Who knows, maybe it will be useful before the temp
@@ -1541,7 +1562,9 @@ class Runner:
         elif self.args.stop:
             await stream.command("d stop")
         elif self.args.dump_config:
-            print((await stream.command("conf enumerate")).decode('latin1'))
+            print((await stream.read_config_text()).decode('latin1'))
+        elif self.args.save_config:
+            await stream.do_save_config(self.args.save_config)
         elif self.args.info:
             await stream.info()
         elif self.args.zero_offset:
@@ -1587,8 +1610,11 @@ async def async_main():
                        help='create a serial console')
     group.add_argument('--dump-config', action='store_true',
                        help='emit all configuration to the console')
+    group.add_argument('--save-config', metavar='FILE',
+                       help='save a binary snapshot of all configuration')
     group.add_argument('--restore-config', metavar='FILE',
-                       help='restore a config saved with --dump-config')
+                       help='restore a config saved with --dump-config ' +
+                       'or --save-config')
     group.add_argument('--write-config', metavar='FILE',
                        help='write the given configuration')
     group.add_argument('--flash', metavar='FILE',
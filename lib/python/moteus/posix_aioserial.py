@@ -79,6 +79,12 @@ class AioSerial:
             if not block or len(result) == size:
                 return result
 
+    def discard_input(self):
+        '''Drop any data which has been received but not yet read.'''
+        self._read_data = bytearray()
+        self._read_event.clear()
+        self.serial.reset_input_buffer()
+
     def write(self, data: Union[bytearray, bytes, memoryview]) -> int:
         self._write_data += data
 
@@ -472,3 +472,367 @@ class Type:
         except IndexError:
             raise RuntimeError("Unknown type: {}".format(type_index))
         return this_type(schema_stream, **kwargs)
+
+
+def _read_varuint(data, offset):
+    result = 0
+    shift = 0
+
+    while True:
+        if offset >= len(data):
+            raise EOFError()
+        value = data[offset]
+        offset += 1
+        result |= (value & 0x7f) << shift
+        shift += 7
+
+        if value < 0x80:
+            return result, offset
+
+        if result >= 2**64:
+            raise ParseError("invalid varuint")
+
+
+_FIXED_INT_FORMATS = { 1: 'b', 2: 'h', 4: 'i', 8: 'q' }
+_FIXED_UINT_FORMATS = { 1: 'B', 2: 'H', 4: 'I', 8: 'Q' }
+
+_SCALAR_FORMATS = {
+    BooleanType: lambda x: '?',
+    FixedIntType: lambda x: _FIXED_INT_FORMATS[x.field_size],
+    FixedUIntType: lambda x: _FIXED_UINT_FORMATS[x.field_size],
+    Float32Type: lambda x: 'f',
+    Float64Type: lambda x: 'd',
+}
+
+
+def _fixed_layout(type_class):
+    '''Return the fixed binary layout of 'type_class', or None if it
+    has any variable length component.
+
+    A layout is a tuple of (fmt, count, convert).  'fmt' is a
+    struct format string without byte order, 'count' is the number
+    of values it unpacks to, and 'convert(values, index)' turns those
+    values into the final result.  'convert' is None when 'count' is
+    1 and the unpacked value can be used directly.'''
+
+    scalar = _SCALAR_FORMATS.get(type(type_class))
+    if scalar:
+        return (scalar(type_class), 1, None)
+
+    if isinstance(type_class, NullType):
+        return ('', 0, lambda values, index: None)
+
+    if (isinstance(type_class, TimestampType) or
+        isinstance(type_class, DurationType)):
+        return ('q', 1, lambda values, index: values[index] / 1000000.0)
+
+    if isinstance(type_class, EnumType):
+        child = _fixed_layout(type_class.type_class)
+        if child is None or child[2] is not None:
+            return None
+        enum_class = type_class.enum_class
+        return (child[0], 1, lambda values, index: enum_class(values[index]))
+
+    if isinstance(type_class, FixedArrayType):
+        child = _fixed_layout(type_class.type_class)
+        if child is None:
+            return None
+        child_fmt, child_count, child_convert = child
+        size = type_class.size
+        if child_convert is None:
+            def convert(values, index):
+                return list(values[index:index + size])
+        else:
+            def convert(values, index):
+                return [child_convert(values, index + i * child_count)
+                        for i in range(size)]
+        return (child_fmt * size, child_count * size, convert)
+
+    if isinstance(type_class, ObjectType):
+        children = [_fixed_layout(x.type_class) for x in type_class.fields]
+        if any(x is None for x in children):
+            return None
+        fmt = ''.join(x[0] for x in children)
+        count = sum(x[1] for x in children)
+        make = type_class.namedtuple._make
+
+        if all(x[2] is None for x in children):
+            def convert(values, index):
+                return make(values[index:index + count])
+        else:
+            items = []
+            offset = 0
+            for child_fmt, child_count, child_convert in children:
+                items.append((offset, child_convert))
+                offset += child_count
+
+            def convert(values, index):
+                return make([values[index + offset] if child_convert is None
+                             else child_convert(values, index + offset)
+                             for offset, child_convert in items])
+
+        return (fmt, count, convert)
+
+    return None
+
+
+def _compile_fixed(layout):
+    fmt, count, convert = layout
+    packer = struct.Struct('<' + fmt)
+    unpack_from = packer.unpack_from
+    size = packer.size
+
+    if convert is None:
+        def decode(data, offset):
+            return unpack_from(data, offset)[0], offset + size
+    else:
+        def decode(data, offset):
+            return convert(unpack_from(data, offset), 0), offset + size
+
+    return decode
+
+
+def _compile_object(type_class):
+    # Consecutive fixed layout fields are merged into a single
+    # struct, leaving only the variable length fields to be decoded
+    # one at a time.
+    segments = []
+    run = []
+
+    def flush_run():
+        if not run:
+            return
+        segments.append(
+            (_compile_fixed((''.join(x[0] for x in run),
+                             sum(x[1] for x in run),
+                             _make_run_convert(run))),
+             len(run)))
+        run.clear()
+
+    for field in type_class.fields:
+        layout = _fixed_layout(field.type_class)
+        if layout is None:
+            flush_run()
+            segments.append((_compile(field.type_class), None))
+        else:
+            run.append(layout)
+
+    flush_run()
+
+    make = type_class.namedtuple._make
+
+    def decode(data, offset):
+        result = []
+        for segment_decode, nfields in segments:
+            value, offset = segment_decode(data, offset)
+            if nfields is None:
+                result.append(value)
+            else:
+                result.extend(value)
+        return make(result), offset
+
+    return decode
+
+
+def _make_run_convert(run):
+    if all(x[2] is None for x in run):
+        return lambda values, index: values
+
+    items = []
+    offset = 0
+    for _, count, convert in run:
+        items.append((offset, convert))
+        offset += count
+
+    def convert(values, index):
+        return [values[index + offset] if child_convert is None
+                else child_convert(values, index + offset)
+                for offset, child_convert in items]
+
+    return convert
+
+
+def _compile_array(type_class):
+    child_layout = _fixed_layout(type_class.type_class)
+
+    if child_layout is not None and child_layout[2] is None:
+        # Arrays of plain scalars are unpacked all at once.
+        fmt = child_layout[0]
+        item_size = struct.calcsize('<' + fmt)
+
+        def decode(data, offset):
+            nvalues, offset = _read_varuint(data, offset)
+            values = struct.unpack_from(f'<{nvalues}{fmt}', data, offset)
+            return list(values), offset + nvalues * item_size
+
+        return decode
+
+    child_decode = _compile(type_class.type_class)
+
+    def decode(data, offset):
+        nvalues, offset = _read_varuint(data, offset)
+        result = []
+        for _ in range(nvalues):
+            value, offset = child_decode(data, offset)
+            result.append(value)
+        return result, offset
+
+    return decode
+
+
+def _compile_fixed_array(type_class):
+    child_decode = _compile(type_class.type_class)
+    size = type_class.size
+
+    def decode(data, offset):
+        result = []
+        for _ in range(size):
+            value, offset = child_decode(data, offset)
+            result.append(value)
+        return result, offset
+
+    return decode
+
+
+def _compile_map(type_class):
+    child_decode = _compile(type_class.type_class)
+
+    def decode(data, offset):
+        nitems, offset = _read_varuint(data, offset)
+        result = {}
+        for _ in range(nitems):
+            key, offset = _decode_string(data, offset)
+            result[key], offset = child_decode(data, offset)
+        return result, offset
+
+    return decode
+
+
+def _compile_union(type_class):
+    items = [_compile(x) for x in type_class.items]
+
+    def decode(data, offset):
+        index, offset = _read_varuint(data, offset)
+        return items[index](data, offset)
+
+    return decode
+
+
+def _compile_enum(type_class):
+    child_decode = _compile(type_class.type_class)
+    enum_class = type_class.enum_class
+
+    def decode(data, offset):
+        value, offset = child_decode(data, offset)
+        return enum_class(value), offset
+
+    return decode
+
+
+def _decode_bytes(data, offset):
+    size, offset = _read_varuint(data, offset)
+    return bytes(data[offset:offset + size]), offset + size
+
+
+def _decode_string(data, offset):
+    size, offset = _read_varuint(data, offset)
+    return bytes(data[offset:offset + size]).decode('utf8'), offset + size
+
+
+def _decode_final(data, offset):
+    raise ParseError("invalid")
+
+
+def _decode_varint(data, offset):
+    raise RuntimeError("not implemented")
+
+
+_VARIABLE_COMPILERS = {
+    FinalType: lambda x: _decode_final,
+    VarintType: lambda x: _decode_varint,
+    VaruintType: lambda x: _read_varuint,
+    BytesType: lambda x: _decode_bytes,
+    StringType: lambda x: _decode_string,
+    ObjectType: _compile_object,
+    EnumType: _compile_enum,
+    ArrayType: _compile_array,
+    FixedArrayType: _compile_fixed_array,
+    MapType: _compile_map,
+    UnionType: _compile_union,
+}
+
+
+def _compile(type_class):
+    layout = _fixed_layout(type_class)
+    if layout is not None:
+        return _compile_fixed(layout)
+
+    return _VARIABLE_COMPILERS[type(type_class)](type_class)
+
+
+_NUMPY_FORMATS = {
+    '?': '?',
+    'b': '<i1', 'h': '<i2', 'i': '<i4', 'q': '<i8',
+    'B': '<u1', 'H': '<u2', 'I': '<u4', 'Q': '<u8',
+    'f': '<f4', 'd': '<f8',
+}
+
+
+def _numpy_dtype(type_class):
+    if isinstance(type_class, ObjectType):
+        return [(_escape_python3_identifier(x.name),
+                 _numpy_dtype(x.type_class))
+                for x in type_class.fields
+                if not isinstance(x.type_class, NullType)]
+    if isinstance(type_class, FixedArrayType):
+        return (_numpy_dtype(type_class.type_class), (type_class.size,))
+    if isinstance(type_class, EnumType):
+        return _numpy_dtype(type_class.type_class)
+
+    # Timestamps and durations are left as integer microseconds.
+    return _NUMPY_FORMATS[_fixed_layout(type_class)[0]]
+
+
+class Decoder:
+    '''Decode binary data for a schema using a precompiled plan.
+
+    Fixed layout portions of the schema are read with a single
+    struct.Struct, variable length portions with a small loop over
+    the raw bytes.  The results are identical to `type_class.read`.'''
+
+    def __init__(self, type_class):
+        self.type_class = type_class
+        self._decode = _compile(type_class)
+
+        layout = _fixed_layout(type_class)
+
+        # The size in bytes of each record, or None if the schema
+        # is variable length.
+        self.size = (struct.calcsize('<' + layout[0])
+                     if layout is not None else None)
+
+    def decode(self, data, offset=0):
+        '''Return the value stored in 'data' starting at 'offset'.'''
+        return self._decode(data, offset)[0]
+
+    def decode_from(self, data, offset=0):
+        '''Return a tuple of (value, offset after the value).'''
+        return self._decode(data, offset)
+
+    def numpy_dtype(self):
+        '''Return a numpy structured dtype matching the schema.
+
+        Only fixed layout schemas are supported.'''
+        import numpy
+
+        if self.size is None:
+            raise ValueError("schema is not fixed layout")
+
+        return numpy.dtype(_numpy_dtype(self.type_class))
+
+    def decode_records(self, data):
+        '''Return a numpy record array from a contiguous sequence of
+        fixed layout records.'''
+        import numpy
+
+        return numpy.frombuffer(data, dtype=self.numpy_dtype())
@@ -0,0 +1,208 @@
+# Copyright 2023 mjbots Robotic Systems, LLC.  info@mjbots.com
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import asyncio
+import struct
+import time
+
+from . import aioserial
+from .fdcanusb import CanMessage
+
+
+HEADER = b'\x54\xab'
+
+
+def crc(data):
+    '''The CRC-CCITT (0xFFFF) used by the multiplex stream framing.'''
+    result = 0xffff
+    for byte in data:
+        result ^= byte << 8
+        for _ in range(8):
+            if result & 0x8000:
+                result = ((result << 1) ^ 0x1021) & 0xffff
+            else:
+                result = (result << 1) & 0xffff
+    return result
+
+
+def _write_varuint(value):
+    result = b''
+    while True:
+        this_byte = value & 0x7f
+        value >>= 7
+        if value:
+            result += bytes([this_byte | 0x80])
+        else:
+            result += bytes([this_byte])
+            return result
+
+
+def encode_frame(source, destination, data):
+    '''Return the multiplex stream framing of a single frame.
+
+    source should have its 0x80 bit set if a reply is required.'''
+    result = (HEADER + bytes([source, destination]) +
+              _write_varuint(len(data)) + bytes(data))
+    return result + struct.pack('<H', crc(result))
+
+
+def decode_frame(buffer):
+    '''Look for a complete frame at the start of buffer.
+
+    Returns a tuple of (frame, remaining), where frame is
+    (source, destination, data), or None if no complete, valid frame
+    could be found.  Leading garbage is discarded from remaining.'''
+    while True:
+        start = buffer.find(HEADER)
+        if start < 0:
+            # Keep a possible partial header.
+            return None, buffer[-1:]
+        buffer = buffer[start:]
+
+        pos = 4
+        size = 0
+        shift = 0
+        while True:
+            if pos >= len(buffer):
+                return None, buffer
+            this_byte = buffer[pos]
+            pos += 1
+            size |= (this_byte & 0x7f) << shift
+            shift += 7
+            if (this_byte & 0x80) == 0:
+                break
+
+        if size > 64:
+            buffer = buffer[1:]
+            continue
+
+        if len(buffer) < pos + size + 2:
+            return None, buffer
+
+        expected_crc, = struct.unpack('<H', buffer[pos + size:pos + size + 2])
+        if crc(buffer[0:pos + size]) != expected_crc:
+            buffer = buffer[1:]
+            continue
+
+        return ((buffer[2], buffer[3], buffer[pos:pos + size]),
+                buffer[pos + size + 2:])
+
+
+def _addresses(command):
+    '''Return the (source, destination) of the frame for command.'''
+    if command.raw:
+        return ((command.arbitration_id >> 8) & 0xff,
+                command.arbitration_id & 0xff)
+    return ((command.source | (0x80 if command.reply_required else 0)),
+            command.destination)
+
+
+class Rs485:
+    """Connects to moteus controllers on a RS485 bus through a serial
+    port, using the multiplex stream framing."""
+
+    def __init__(self, path, baudrate=3000000, timeout=0.02,
+                 debug_log=None):
+        """Constructor.
+
+        Arguments:
+          path: serial port of the RS485 adapter
+          baudrate: bus baud rate
+          timeout: how long to wait for each reply, in seconds
+        """
+        self._serial = aioserial.AioSerial(port=path, baudrate=baudrate)
+        self._stream_data = b''
+        self._timeout = timeout
+
+        self._cycle_lock = asyncio.Lock()
+
+        self._debug_log = None
+        if debug_log:
+            self._debug_log = open(debug_log, 'wb')
+
+    async def cycle(self, commands):
+        """Request that the given set of commands be sent on the bus, and
+        any responses collated and returned, after being parsed by
+        their command specific parsers.
+
+        Each command instance must model moteus.Command
+        """
+
+        # The bus is half duplex, so only one command can be
+        # outstanding at a time.
+        async with self._cycle_lock:
+            return [await self._do_command(x) for x in commands]
+
+    async def _do_command(self, command):
+        # Anything still buffered, like a reply which arrived after an
+        # earlier request timed out, cannot be for this one.
+        self._stream_data = b''
+        self._serial.discard_input()
+
+        await self.write(command)
+
+        if not command.reply_required:
+            return None
+
+        try:
+            message = await asyncio.wait_for(
+                self._read_reply(command), self._timeout)
+        except asyncio.TimeoutError:
+            return None
+
+        return command.parse(message)
+
+    async def _read_reply(self, command):
+        _, destination = _addresses(command)
+        while True:
+            message = await self.read()
+            # Skip anything which is not from the device we asked.
+            if (message.arbitration_id >> 8) == destination:
+                return message
+
+    async def write(self, command):
+        # This merely sends a command and doesn't wait for any reply.
+        # It can *not* be intermixed with calls to 'cycle'.
+        source, destination = _addresses(command)
+        frame = encode_frame(source, destination, command.data)
+        self._serial.write(frame)
+        if self._debug_log:
+            self._debug_log.write(f'{time.time()} > '.encode('latin1') +
+                                  frame.hex().encode('latin1') + b'\n')
+        await self._serial.drain()
+
+    async def read(self):
+        # Read a single frame from a device and do not parse it.
+        while True:
+            frame, self._stream_data = decode_frame(self._stream_data)
+            if frame is None:
+                self._stream_data += await self._serial.read(
+                    8192, block=False)
+                continue
+
+            source, destination, data = frame
+
+            # Frames requesting a reply are from a host, likely our
+            # own echoed back by the adapter.
+            if source & 0x80:
+                continue
+
+            if self._debug_log:
+                self._debug_log.write(f'{time.time()} < '.encode('latin1') +
+                                      data.hex().encode('latin1') + b'\n')
+
+            message = CanMessage()
+            message.arbitration_id = (source << 8) | destination
+            message.data = data
+            return message
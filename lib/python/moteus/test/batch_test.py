@@ -0,0 +1,171 @@
+#!/usr/bin/python3 -B
+
+# Copyright 2023 mjbots Robotic Systems, LLC.  info@mjbots.com
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import asyncio
+import unittest
+
+from moteus import BatchTransport, Command
+
+
+class Reply:
+    def __init__(self, id, data):
+        self.id = id
+        self.data = data
+
+
+class FakeTransport:
+    '''Replies to each command which requires one, either with one
+    result per command like Fdcanusb, or only with the replies like
+    PythonCan.'''
+
+    def __init__(self, replies_only=False):
+        self.replies_only = replies_only
+        self.cycles = []
+
+    async def cycle(self, commands):
+        self.cycles.append(commands)
+        await asyncio.sleep(0.01)
+        result = [Reply(x.destination, x.data) if x.reply_required else None
+                  for x in commands]
+        if self.replies_only:
+            # Return them grouped out of order, as a Router would.
+            return list(reversed([x for x in result if x is not None]))
+        return result
+
+
+def make_command(destination, data, reply_required=True):
+    result = Command()
+    result.destination = destination
+    result.data = data
+    result.reply_required = reply_required
+    return result
+
+
+class BatchTransportTest(unittest.TestCase):
+    async def run_concurrent(self, replies_only):
+        inner = FakeTransport(replies_only=replies_only)
+        dut = BatchTransport(inner)
+
+        results = await asyncio.gather(
+            dut.cycle([make_command(1, b'a')]),
+            dut.cycle([make_command(2, b'b', reply_required=False)]),
+            dut.cycle([make_command(3, b'c'), make_command(4, b'd')]))
+
+        self.assertEqual(len(inner.cycles), 1)
+        self.assertEqual([x.data for x in inner.cycles[0]],
+                         [b'a', b'b', b'c', b'd'])
+
+        def data(x):
+            return [y.data for y in x if y is not None]
+
+        self.assertEqual(data(results[0]), [b'a'])
+        self.assertEqual(data(results[1]), [])
+        self.assertEqual(data(results[2]), [b'c', b'd'])
+        if not replies_only:
+            self.assertEqual(results[1], [None])
+
+    def test_concurrent(self):
+        asyncio.get_event_loop().run_until_complete(
+            self.run_concurrent(False))
+
+    def test_concurrent_replies_only(self):
+        asyncio.get_event_loop().run_until_complete(
+            self.run_concurrent(True))
+
+    async def run_router_order(self):
+        # Like a Router over two fdcanusbs, this returns one result
+        # per command, but grouped by bus rather than in command
+        # order.
+        class Grouped(FakeTransport):
+            async def cycle(self, commands):
+                result = await super().cycle(commands)
+                return ([x for x in result if x.id in [1, 3]] +
+                        [x for x in result if x.id not in [1, 3]])
+
+        inner = Grouped()
+        dut = BatchTransport(inner)
+
+        results = await asyncio.gather(
+            dut.cycle([make_command(1, b'a')]),
+            dut.cycle([make_command(2, b'b')]),
+            dut.cycle([make_command(3, b'c')]))
+
+        self.assertEqual(len(inner.cycles), 1)
+        self.assertEqual([[y.data for y in x] for x in results],
+                         [[b'a'], [b'b'], [b'c']])
+
+    def test_router_order(self):
+        asyncio.get_event_loop().run_until_complete(self.run_router_order())
+
+    async def run_in_flight(self):
+        inner = FakeTransport()
+        dut = BatchTransport(inner)
+
+        first = asyncio.create_task(dut.cycle([make_command(1, b'a')]))
+        await asyncio.sleep(0.001)
+
+        # These arrive while the first is on the wire, and go
+        # together in the next.
+        results = await asyncio.gather(
+            dut.cycle([make_command(2, b'b')]),
+            dut.cycle([make_command(3, b'c')]))
+        await first
+
+        self.assertEqual([[x.data for x in y] for y in inner.cycles],
+                         [[b'a'], [b'b', b'c']])
+        self.assertEqual([x[0].data for x in results], [b'b', b'c'])
+
+    def test_in_flight(self):
+        asyncio.get_event_loop().run_until_complete(self.run_in_flight())
+
+    async def run_window(self):
+        async def late(dut, data):
+            await asyncio.sleep(0.005)
+            return await dut.cycle([make_command(2, data)])
+
+        inner = FakeTransport()
+        dut = BatchTransport(inner)
+        await asyncio.gather(dut.cycle([make_command(1, b'a')]),
+                             late(dut, b'b'))
+        self.assertEqual(len(inner.cycles), 2)
+
+        inner = FakeTransport()
+        dut = BatchTransport(inner, window_us=50000)
+        await asyncio.gather(dut.cycle([make_command(1, b'a')]),
+                             late(dut, b'b'))
+        self.assertEqual(len(inner.cycles), 1)
+
+    def test_window(self):
+        asyncio.get_event_loop().run_until_complete(self.run_window())
+
+    async def run_error(self):
+        class Failing:
+            async def cycle(self, commands):
+                raise RuntimeError('bus off')
+
+        dut = BatchTransport(Failing())
+        results = await asyncio.gather(
+            dut.cycle([make_command(1, b'a')]),
+            dut.cycle([make_command(2, b'b')]),
+            return_exceptions=True)
+        self.assertTrue(all(isinstance(x, RuntimeError) for x in results))
+
+    def test_error(self):
+        asyncio.get_event_loop().run_until_complete(self.run_error())
+
+
+if __name__ == '__main__':
+    unittest.main()
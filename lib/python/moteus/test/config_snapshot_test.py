@@ -0,0 +1,90 @@
+#!/usr/bin/python3 -B
+
+# Copyright 2023 mjbots Robotic Systems, LLC.  info@mjbots.com
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+
+import struct
+import unittest
+
+from moteus import config_snapshot
+
+
+# An object with:
+#  kp : float32
+#  enabled : bool
+#  offset : int32[2]
+_SCHEMA = bytes([
+    16, 0,
+      0, 2, 107, 112, 0,  7, 0,
+      0, 7, 101, 110, 97, 98, 108, 101, 100, 0,  2, 0,
+      0, 6, 111, 102, 102, 115, 101, 116, 0,  19, 2, 3, 4, 0,
+    0, 0, 0, 0, 0,
+])
+
+
+def _make_data(kp, enabled, offset0, offset1):
+    return struct.pack('<fBii', kp, enabled, offset0, offset1)
+
+
+class ConfigSnapshotTest(unittest.TestCase):
+    def test_items(self):
+        dut = config_snapshot.ConfigSnapshot([
+            ('servo', _SCHEMA, _make_data(0.005, 1, -3, 4)),
+            ('other', _SCHEMA, _make_data(float('nan'), 0, 0, 0)),
+        ])
+
+        self.assertEqual(dut.items(), [
+            ('servo.kp', '0.005'),
+            ('servo.enabled', '1'),
+            ('servo.offset.0', '-3'),
+            ('servo.offset.1', '4'),
+            ('other.kp', 'nan'),
+            ('other.enabled', '0'),
+            ('other.offset.0', '0'),
+            ('other.offset.1', '0'),
+        ])
+        self.assertTrue(dut.to_text().startswith(
+            b'servo.kp 0.005\nservo.enabled 1\n'))
+
+    def test_serialize(self):
+        dut = config_snapshot.ConfigSnapshot([
+            ('servo', _SCHEMA, _make_data(2.5, 0, 1, 2)),
+        ])
+
+        data = dut.serialize()
+        self.assertTrue(config_snapshot.ConfigSnapshot.is_snapshot(data))
+        self.assertFalse(config_snapshot.ConfigSnapshot.is_snapshot(
+            b'servo.kp 1.0\n'))
+
+        actual = config_snapshot.ConfigSnapshot.deserialize(data)
+        self.assertEqual(actual.groups, dut.groups)
+        self.assertEqual(actual.schema_hash(), dut.schema_hash())
+
+        # A snapshot whose schema was altered is rejected.
+        corrupt = bytearray(data)
+        corrupt[data.index(_SCHEMA) + 3] ^= 0x01
+        with self.assertRaises(RuntimeError):
+            config_snapshot.ConfigSnapshot.deserialize(bytes(corrupt))
+
+    def test_schema_hash(self):
+        a = config_snapshot.schema_hash([('servo', _SCHEMA)])
+        b = config_snapshot.schema_hash([('servo2', _SCHEMA)])
+        c = config_snapshot.schema_hash([('servo', _SCHEMA + b'\x00')])
+        self.assertNotEqual(a, b)
+        self.assertNotEqual(a, c)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -15,7 +15,9 @@
 # limitations under the License.
 
 
+import asyncio
 import math
+import struct
 import unittest
 
 import moteus.moteus as mot
@@ -253,6 +255,78 @@ class MoteusTest(unittest.TestCase):
             bytes([0x01, 0xb2, 0x02, 0x01]))
         self.assertEqual(result.expected_reply_size, 0)
 
+    def test_make_heartbeat(self):
+        dut = mot.Controller()
+        result = dut.make_heartbeat()
+        self.assertEqual(
+            result.data,
+            bytes([0x01, 0xb0, 0x01, 0x01]))
+        self.assertEqual(result.expected_reply_size, 0)
+
+    def test_parse_timeout_counts(self):
+        values = mot.parse_reply(bytes([
+            0x20, 0x04, 0xb1, 0x01,
+            0x02,  # cause
+            0x03,  # command timeouts
+            0x04,  # heartbeat timeouts
+            0x7f,  # missed heartbeats
+        ]))
+        self.assertEqual(values[mot.Register.TIMEOUT_CAUSE], 2)
+        self.assertEqual(values[mot.Register.COMMAND_TIMEOUT_COUNT], 3)
+        self.assertEqual(values[mot.Register.HEARTBEAT_TIMEOUT_COUNT], 4)
+        self.assertEqual(values[mot.Register.MISSED_HEARTBEAT_COUNT], 127)
+
+    def test_parse_thermal(self):
+        values = mot.parse_reply(bytes([
+            0x24, 0x03, 0xc0, 0x01,
+            0xff, 0x7f,  # time to derate, saturated
+            0x7b, 0x00,  # FET rise
+            0xf6, 0xff,  # motor rise
+        ]))
+        self.assertAlmostEqual(values[mot.Register.TIME_TO_DERATE], 3276.7)
+        self.assertAlmostEqual(values[mot.Register.FET_TEMPERATURE_RISE], 12.3)
+        self.assertAlmostEqual(
+            values[mot.Register.MOTOR_TEMPERATURE_RISE], -1.0)
+
+    def test_make_set_shared_time(self):
+        dut = mot.Controller(id=0x7f)
+        # The shared time wraps rather than saturating.
+        result = dut.make_set_shared_time(time=4294.967296 + 1.5)
+        self.assertEqual(result.destination, 0x7f)
+        self.assertEqual(
+            result.data,
+            bytes([0x09, 0x74, 0x60, 0xe3, 0x16, 0x00]))
+        self.assertEqual(result.expected_reply_size, 0)
+
+        result = dut.make_set_shared_time(time=-0.000001)
+        self.assertEqual(
+            result.data,
+            bytes([0x09, 0x74, 0xff, 0xff, 0xff, 0xff]))
+
+    def test_make_position_arrival_time(self):
+        dut = mot.Controller()
+        result = dut.make_position(position=1.0, arrival_time=2.0)
+        self.assertEqual(result.data, bytes([
+            0x01, 0x00, 0x0a,
+            0x0d, 0x20,
+            0x00, 0x00, 0x80, 0x3f,
+            0x09, 0x2c,
+            0x80, 0x84, 0x1e, 0x00,
+        ]))
+
+    def test_shared_clock(self):
+        now = [10.0]
+        dut = mot.SharedClock(time_source=lambda: now[0])
+        now[0] = 10.25
+        self.assertAlmostEqual(dut.time(), 0.25)
+
+        result = dut.make_broadcast()
+        self.assertEqual(result.destination, 0x7f)
+        self.assertEqual(result.reply_required, False)
+        self.assertEqual(
+            result.data,
+            bytes([0x09, 0x74, 0x90, 0xd0, 0x03, 0x00]))
+
     def test_make_write_gpio(self):
         dut = mot.Controller()
         result = dut.make_write_gpio(aux1=3, aux2=5)
@@ -292,6 +366,209 @@ class MoteusTest(unittest.TestCase):
                 0x1c, 0x04, 0x33, ]))
         self.assertEqual(result.expected_reply_size, 51)
 
+    def test_query_aux_snapshot(self):
+        qr = mot.QueryResolution()
+        qr.aux_snapshot = mot.mp.INT16
+        qr.aux_snapshot_average = True
+
+        dut = mot.Controller(query_resolution=qr)
+        result = dut.make_query()
+        self.assertEqual(
+            result.data,
+            bytes([0x11, 0x00,
+                   0x1f, 0x01,
+                   0x13, 0x0d,
+                   0x14, 0x0b, 0x88, 0x01]))
+        self.assertEqual(result.expected_reply_size, 48)
+
+        values = mot.parse_reply(bytes([
+            0x24, 0x0b, 0x88, 0x01,
+            0x05, 0x02,
+            0xff, 0x7f, 0, 0, 0, 0, 0, 0, 0, 0,
+            0, 0, 0x00, 0x80, 0, 0, 0, 0, 0xff, 0x3f,
+            0x20, 0x01, 0x00, 0x0a]))
+        self.assertEqual(values[0x000], 10)
+        snapshot = mot.parse_aux_snapshot(values, average=True)
+        self.assertEqual(snapshot.aux1_gpio, 5)
+        self.assertEqual(snapshot.aux2_gpio, 2)
+        self.assertEqual(snapshot.aux1_analog, [1.0, 0.0, 0.0, 0.0, 0.0])
+        self.assertEqual(snapshot.aux2_analog[0], 0.0)
+        self.assertTrue(math.isnan(snapshot.aux2_analog[1]))
+        self.assertAlmostEqual(snapshot.aux2_analog[4], 0.5, places=4)
+        self.assertIsNone(mot.parse_aux_snapshot(values))
+
+        # Other resolutions are decoded one register at a time.
+        values = mot.parse_reply(bytes([0x2d, 0x7b, 0x00, 0x00, 0x00, 0x3f]))
+        self.assertEqual(values, {0x07b: 0.5})
+
+    def test_parse_statistics(self):
+        values = mot.parse_reply(bytes([
+            0x28, 0x0a, 0xa0, 0x01,
+            0x9c, 0xff, 0xff, 0xff,  # q current min
+            0xc8, 0x00, 0x00, 0x00,  # q current max
+            0x32, 0x00, 0x00, 0x00,  # q current mean
+            0x0a, 0x00, 0x00, 0x00,  # torque min
+            0x14, 0x00, 0x00, 0x00,  # torque max
+            0x0f, 0x00, 0x00, 0x00,  # torque mean
+            0x00, 0x00, 0x00, 0x80,  # velocity min
+            0x00, 0x00, 0x00, 0x80,  # velocity max
+            0x00, 0x00, 0x00, 0x80,  # velocity mean
+            0x50, 0x00, 0x00, 0x00,  # count
+        ]))
+        self.assertAlmostEqual(values[mot.Register.STATS_Q_CURRENT_MIN], -0.1)
+        self.assertAlmostEqual(values[mot.Register.STATS_Q_CURRENT_MAX], 0.2)
+        self.assertAlmostEqual(values[mot.Register.STATS_Q_CURRENT_MEAN], 0.05)
+        self.assertAlmostEqual(values[mot.Register.STATS_TORQUE_MEAN], 0.015)
+        self.assertTrue(math.isnan(values[mot.Register.STATS_VELOCITY_MAX]))
+        self.assertEqual(values[mot.Register.STATS_COUNT], 80)
+
+
+class _DiagnosticData:
+    def __init__(self, data):
+        self.data = data
+
+
+class _FakeDiagnosticController:
+    '''Emulates the diagnostic channel of a controller, replying to
+    'conf' commands and recording how much was queued at once.'''
+
+    def __init__(self):
+        self.to_server = b''
+        self.to_client = b''
+        self.max_pending = 0
+
+    async def send_diagnostic_write(self, data, channel):
+        self.to_server += data
+        self.max_pending = max(self.max_pending, len(self.to_server))
+
+        while b'\n' in self.to_server:
+            line, self.to_server = self.to_server.split(b'\n', 1)
+            if line.startswith(b'conf get'):
+                self.to_client += b'4.0\r\n'
+            elif line.startswith(b'stream sub'):
+                # A record from an earlier subscription arrives first.
+                self.to_client += (
+                    b'emit servo_stream\r\n' +
+                    struct.pack('<IIHB', 7, 100, 1, 2))
+                self.to_client += (
+                    b'mode u8 10\r\nposition f32 1\r\n' +
+                    b'bus_V f32 50\r\nOK\r\n')
+                self.to_client += (
+                    b'emit servo_stream\r\n' +
+                    struct.pack('<IIHf', 10, 1000, 2, 1.5))
+            elif line.startswith(b'conf set bad'):
+                self.to_client += b'ERR error setting\r\n'
+            else:
+                self.to_client += b'OK\r\n'
+
+    async def diagnostic_read(self, max_length, channel):
+        result, self.to_client = (
+            self.to_client[0:max_length], self.to_client[max_length:])
+        return [_DiagnosticData(result)]
+
+
+class StreamTest(unittest.TestCase):
+    def test_command_batch(self):
+        controller = _FakeDiagnosticController()
+        dut = mot.Stream(controller)
+
+        commands = [f'conf set servo.pid_position.kp {i}'.encode('latin1')
+                    for i in range(20)]
+        commands[3] = b'conf set bad.value 1'
+
+        results = asyncio.get_event_loop().run_until_complete(
+            dut.command_batch(commands))
+        self.assertEqual(len(results), 20)
+        self.assertEqual(results[0], b'')
+        self.assertTrue(isinstance(results[3], mot.CommandError))
+        self.assertEqual(results[19], b'')
+
+        self.assertGreater(controller.max_pending, len(commands[0]) + 1)
+        self.assertLessEqual(controller.max_pending, mot.Stream.BATCH_WINDOW)
+
+        results = asyncio.get_event_loop().run_until_complete(
+            dut.command_batch([b'conf get servo.pid_position.kp'] * 3,
+                              allow_any_response=True))
+        self.assertEqual(results, [b'4.0'] * 3)
+
+
+    def test_servo_stream(self):
+        controller = _FakeDiagnosticController()
+        dut = mot.Stream(controller)
+
+        loop = asyncio.get_event_loop()
+        subscriptions = loop.run_until_complete(
+            dut.subscribe_servo_stream({'position': 1, 'bus_V': 50}))
+        self.assertEqual(subscriptions, [
+            ('mode', 'u8', 10),
+            ('position', 'f32', 1),
+            ('bus_V', 'f32', 50),
+        ])
+
+        # Only the fields which are due are present.
+        self.assertEqual(
+            mot.parse_servo_stream(struct.pack('<IHBf', 20, 3, 1, 2.5),
+                                   subscriptions),
+            {'timestamp_ms': 20, 'mode': 1, 'position': 2.5})
+
+        record = loop.run_until_complete(dut.read_servo_stream())
+        self.assertEqual(record, {'timestamp_ms': 1000, 'position': 1.5})
+
+
+class _HomingTransport:
+    '''Reports each controller as homed after it has been commanded a
+    controller specific number of times.'''
+
+    def __init__(self, cycles_to_home):
+        self.cycles_to_home = cycles_to_home
+        self.counts = {key: 0 for key in cycles_to_home.keys()}
+        self.cycle_sizes = []
+        self.velocities = []
+
+    async def cycle(self, commands):
+        self.cycle_sizes.append(len(commands))
+        results = []
+        for command in commands:
+            if not command.reply_required:
+                continue
+
+            self.counts[command.destination] += 1
+
+            result = mot.Result()
+            result.id = command.destination
+            result.values = {
+                mot.Register.HOME_STATE:
+                (1 if self.counts[command.destination] >=
+                 self.cycles_to_home[command.destination] else 0),
+            }
+            results.append(result)
+        return results
+
+
+class HomeAllTest(unittest.TestCase):
+    def test_home_all(self):
+        transport = _HomingTransport({1: 3, 2: 6, 3: 1})
+        controllers = [mot.Controller(id=x, transport=transport)
+                       for x in [1, 2, 3]]
+
+        result = asyncio.get_event_loop().run_until_complete(
+            mot.home_all(controllers, period_s=0.0))
+        self.assertEqual(result, [True, True, True])
+
+        # One cycle for the reindex, one per iteration until the
+        # slowest is homed, and one final hold.
+        self.assertEqual(transport.cycle_sizes, [3] * 8)
+
+    def test_home_all_timeout(self):
+        transport = _HomingTransport({1: 2, 2: 1000000})
+        controllers = [mot.Controller(id=x, transport=transport)
+                       for x in [1, 2]]
+
+        result = asyncio.get_event_loop().run_until_complete(
+            mot.home_all(controllers, period_s=0.001, timeout_s=0.05,
+                         require_reindex=False))
+        self.assertEqual(result, [True, False])
+
 
 if __name__ == '__main__':
     unittest.main()
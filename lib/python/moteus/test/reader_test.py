@@ -16,6 +16,7 @@
 
 
 import io
+import struct
 import unittest
 
 from moteus import reader
@@ -96,6 +97,15 @@ class ReaderTest(unittest.TestCase):
             else:
                 self.assertEqual(actual_value, data_value)
 
+            decoder = reader.Decoder(actual_type)
+            decoded_value, offset = decoder.decode_from(data_data)
+            self.assertEqual(offset, len(data_data))
+
+            if isinstance(data_value, _TestType):
+                self.assertTrue(data_value(actual_type, decoded_value))
+            else:
+                self.assertEqual(decoded_value, data_value)
+
     def test_enum(self):
         enum_schema_data = bytes([17, 4, 1, 0])
 
@@ -105,6 +115,63 @@ class ReaderTest(unittest.TestCase):
         actual_value = actual_type.read(reader.Stream(io.BytesIO(bytes([10]))))
         self.assertEqual(actual_value, 10)
 
+    def test_decoder(self):
+        schema_data = bytes([
+            16, 0,
+              0, 1, 97, 0,  7, 0,                # a : float32
+              0, 1, 98, 0,  3, 2, 0,             # b : int16
+              0, 1, 99, 0,  17, 4, 1, 1,         # c : enum
+                                1, 2, 101, 49, 0,
+              0, 1, 100, 0,  10, 0,              # d : string
+              0, 1, 101, 0,  19, 2, 4, 2, 0,     # e : uint16[2]
+              0, 1, 102, 0,  18, 7, 0,           # f : float32[]
+              0, 1, 103, 0,  22, 0,              # g : timestamp
+            0, 0, 0, 0, 0,
+        ])
+        data = (struct.pack('<fhB', 1.5, -3, 1) +
+                bytes([2, 104, 105]) +
+                struct.pack('<HH', 7, 8) +
+                bytes([2]) + struct.pack('<ff', 2.0, 3.0) +
+                struct.pack('<q', 2500000))
+
+        actual_type = reader.Type.from_binary(io.BytesIO(schema_data))
+        expected = actual_type.read(reader.Stream(io.BytesIO(data)))
+
+        decoder = reader.Decoder(actual_type)
+        self.assertIsNone(decoder.size)
+        actual = decoder.decode(data)
+        self.assertEqual(actual, expected)
+        self.assertEqual(actual.a, 1.5)
+        self.assertEqual(actual.c, actual_type.fields[2].type_class.enum_class.e1)
+        self.assertEqual(actual.d, 'hi')
+        self.assertEqual(actual.e, [7, 8])
+        self.assertEqual(actual.f, [2.0, 3.0])
+        self.assertEqual(actual.g, 2.5)
+
+    def test_decoder_records(self):
+        schema_data = bytes([
+            16, 0,
+              0, 1, 97, 0,  7, 0,
+              0, 1, 98, 0,  4, 4, 0,
+            0, 0, 0, 0, 0,
+        ])
+        actual_type = reader.Type.from_binary(io.BytesIO(schema_data))
+        decoder = reader.Decoder(actual_type)
+        self.assertEqual(decoder.size, 8)
+
+        data = struct.pack('<fIfI', 1.0, 2, 3.0, 4)
+        self.assertEqual(decoder.decode(data, 8), (3.0, 4))
+
+        try:
+            import numpy
+        except ImportError:
+            return
+
+        records = decoder.decode_records(data)
+        self.assertEqual(len(records), 2)
+        self.assertEqual(list(records['a']), [1.0, 3.0])
+        self.assertEqual(list(records['b']), [2, 4])
+
 
 if __name__ == '__main__':
     unittest.main()
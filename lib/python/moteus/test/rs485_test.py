@@ -0,0 +1,147 @@
+#!/usr/bin/python3 -B
+
+# Copyright 2023 mjbots Robotic Systems, LLC.  info@mjbots.com
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import asyncio
+import os
+import tty
+import unittest
+
+from moteus import Command
+import moteus.rs485 as rs485
+
+
+class Rs485FramingTest(unittest.TestCase):
+    def test_crc(self):
+        self.assertEqual(rs485.crc(b'123456789'), 0x29b1)
+
+    def test_roundtrip(self):
+        frame = rs485.encode_frame(0x82, 0x05, b'\x20\x21\x22')
+        self.assertEqual(frame[0:7], b'\x54\xab\x82\x05\x03\x20\x21')
+
+        result, remaining = rs485.decode_frame(b'\x00\x54' + frame + b'\x54')
+        self.assertEqual(result, (0x82, 0x05, b'\x20\x21\x22'))
+        self.assertEqual(remaining, b'\x54')
+
+        # Partial frames wait for more data.
+        result, remaining = rs485.decode_frame(frame[0:-1])
+        self.assertIsNone(result)
+        self.assertEqual(remaining, frame[0:-1])
+
+        # Corrupt frames are skipped.
+        corrupt = frame[0:-1] + bytes([frame[-1] ^ 1])
+        result, remaining = rs485.decode_frame(corrupt + frame)
+        self.assertEqual(result, (0x82, 0x05, b'\x20\x21\x22'))
+        self.assertEqual(remaining, b'')
+
+
+class Rs485Test(unittest.TestCase):
+    def setUp(self):
+        self.host, self.device = os.openpty()
+        tty.setraw(self.host)
+
+    def tearDown(self):
+        os.close(self.host)
+        os.close(self.device)
+
+    def make_dut(self):
+        # The serial port must be opened from within the event loop.
+        return rs485.Rs485(os.ttyname(self.device), baudrate=115200,
+                           timeout=0.2)
+
+    async def run_cycle(self):
+        dut = self.make_dut()
+
+        command = Command()
+        command.destination = 5
+        command.reply_required = True
+        command.data = b'\x11\x00'
+
+        no_reply = Command()
+        no_reply.destination = 6
+        no_reply.data = b'\x01\x00\x0a'
+
+        task = asyncio.create_task(dut.cycle([command, no_reply]))
+        await asyncio.sleep(0.05)
+
+        sent = os.read(self.host, 256)
+        self.assertEqual(sent, rs485.encode_frame(0x80, 5, b'\x11\x00'))
+
+        # An echo of our own request is ignored.
+        os.write(self.host, sent + rs485.encode_frame(0x05, 0, b'\x21\x00'))
+
+        result = await task
+        self.assertEqual(len(result), 2)
+        self.assertEqual(result[0].arbitration_id, 0x0500)
+        self.assertEqual(result[0].data, b'\x21\x00')
+        self.assertIsNone(result[1])
+
+        self.assertEqual(os.read(self.host, 256),
+                         rs485.encode_frame(0x00, 6, b'\x01\x00\x0a'))
+
+    def test_cycle(self):
+        asyncio.run(self.run_cycle())
+
+    async def run_timeout(self):
+        dut = self.make_dut()
+
+        command = Command()
+        command.destination = 5
+        command.reply_required = True
+        command.data = b'\x11\x00'
+
+        result = await dut.cycle([command])
+        self.assertEqual(result, [None])
+
+    def test_timeout(self):
+        asyncio.run(self.run_timeout())
+
+    async def run_late_reply(self):
+        dut = self.make_dut()
+
+        command = Command()
+        command.destination = 5
+        command.reply_required = True
+        command.data = b'\x11\x00'
+
+        result = await dut.cycle([command])
+        self.assertEqual(result, [None])
+        os.read(self.host, 256)
+
+        # The reply to the request which timed out arrives before the
+        # next one is sent.
+        os.write(self.host, rs485.encode_frame(0x05, 0, b'\x21\x01'))
+        await asyncio.sleep(0.05)
+
+        task = asyncio.create_task(dut.cycle([command]))
+        await asyncio.sleep(0.05)
+        self.assertEqual(os.read(self.host, 256),
+                         rs485.encode_frame(0x80, 5, b'\x11\x00'))
+
+        # A frame from some other device is skipped.
+        os.write(self.host,
+                 rs485.encode_frame(0x07, 0, b'\x21\x02') +
+                 rs485.encode_frame(0x05, 0, b'\x21\x03'))
+
+        result = await task
+        self.assertEqual(result[0].arbitration_id, 0x0500)
+        self.assertEqual(result[0].data, b'\x21\x03')
+
+    def test_late_reply(self):
+        asyncio.run(self.run_late_reply())
+
+
+if __name__ == '__main__':
+    unittest.main()
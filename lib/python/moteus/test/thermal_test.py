@@ -0,0 +1,117 @@
+#!/usr/bin/python3 -B
+
+# Copyright 2023 mjbots Robotic Systems, LLC.  info@mjbots.com
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import asyncio
+import math
+import unittest
+
+from moteus import Register
+from moteus import thermal
+
+
+CONFIG = {
+    'servo.thermal_model.fet_resistance_ohm': 0.005,
+    'servo.thermal_model.fet_thermal_resistance': 2.0,
+    'servo.thermal_model.fet_time_constant_s': 20.0,
+    'servo.thermal_model.motor_thermal_resistance': 1.0,
+    'servo.thermal_model.motor_time_constant_s': 60.0,
+    'servo.derate_temperature': 80.0,
+    'servo.enable_motor_temperature': 1.0,
+    'servo.motor_derate_temperature': 80.0,
+    'servo.motor_fault_temperature': 100.0,
+    'motor.resistance_ohm': 0.02,
+}
+
+
+def make_model():
+    result = thermal.ThermalModel.from_config(CONFIG)
+    result.set_state({
+        Register.TEMPERATURE: 30.0,
+        Register.FET_TEMPERATURE_RISE: 5.0,
+        Register.MOTOR_TEMPERATURE: 35.0,
+        Register.MOTOR_TEMPERATURE_RISE: 10.0,
+    })
+    return result
+
+
+class ThermalTest(unittest.TestCase):
+    def test_state(self):
+        dut = make_model()
+        self.assertAlmostEqual(dut.fet.ambient_C, 25.0)
+        self.assertAlmostEqual(dut.motor.ambient_C, 25.0)
+
+        # At 30A, the FETs settle at 25 + 13.5C and the motor at 25 +
+        # 27C.
+        self.assertEqual(dut.time_to_derate(30.0), math.inf)
+        fet_C, motor_C = dut.simulate([(10000.0, 30.0)])[0]
+        self.assertAlmostEqual(fet_C, 38.5)
+        self.assertAlmostEqual(motor_C, 52.0)
+
+    def test_time_to_derate(self):
+        dut = make_model()
+        predicted_s = dut.time_to_derate(90.0)
+        self.assertTrue(math.isfinite(predicted_s))
+
+        # The FETs reach the derating temperature first.
+        fet_C, motor_C = dut.simulate([(predicted_s, 90.0)])[0]
+        self.assertAlmostEqual(fet_C, 80.0)
+        self.assertLess(motor_C, 80.0)
+
+        self.assertFalse(dut.profile_derates([(predicted_s * 0.99, 90.0)]))
+        self.assertTrue(dut.profile_derates([(predicted_s * 1.01, 90.0)]))
+        self.assertTrue(dut.profile_derates(
+            [(predicted_s * 0.6, 90.0), (predicted_s * 0.6, 90.0)]))
+        self.assertFalse(dut.profile_derates(
+            [(predicted_s * 0.6, 90.0), (predicted_s, 0.0)]))
+
+    def test_max_current(self):
+        dut = make_model()
+        for duration_s in [0.5, 5.0, 50.0]:
+            current_A = dut.max_current(duration_s)
+            self.assertAlmostEqual(
+                dut.time_to_derate(current_A), duration_s, places=4)
+
+    def test_no_motor_sensor(self):
+        config = dict(CONFIG)
+        config['servo.enable_motor_temperature'] = 0.0
+        config['servo.thermal_model.fet_thermal_resistance'] = 0.0
+        dut = thermal.ThermalModel.from_config(config)
+        dut.set_state({
+            Register.TEMPERATURE: 30.0,
+            Register.FET_TEMPERATURE_RISE: 0.0,
+            Register.MOTOR_TEMPERATURE: 0.0,
+            Register.MOTOR_TEMPERATURE_RISE: 0.0,
+        })
+        self.assertEqual(dut.time_to_derate(1000.0), math.inf)
+        self.assertEqual(dut.max_current(1.0), math.inf)
+
+    async def run_from_stream(self):
+        class Stream:
+            async def command(self, data, allow_any_response=False):
+                name = data.decode('latin1').split(' ')[2]
+                return f'{CONFIG[name]}'.encode('latin1')
+
+        dut = await thermal.ThermalModel.from_stream(Stream())
+        self.assertEqual(dut.fet.resistance_ohm, 0.005)
+        self.assertEqual(dut.motor.resistance_ohm, 0.02)
+        self.assertEqual(dut.motor.derate_C, 80.0)
+
+    def test_from_stream(self):
+        asyncio.run(self.run_from_stream())
+
+
+if __name__ == '__main__':
+    unittest.main()
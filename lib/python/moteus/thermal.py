@@ -0,0 +1,218 @@
+# Copyright 2023 mjbots Robotic Systems, LLC.  info@mjbots.com
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+'''A host side copy of the firmware thermal model, configured with
+servo.thermal_model.  It can be used to plan motion which stays clear
+of the temperature derating.
+
+  model = await moteus.thermal.ThermalModel.from_stream(stream)
+
+  qr = moteus.QueryResolution()
+  qr._extra = moteus.thermal.QUERY_REGISTERS
+  ...
+  model.set_state(result.values)
+  if model.time_to_derate(current_A=40.0) > 2.0:
+      ...
+'''
+
+import math
+
+from moteus.moteus import Register
+from moteus import multiplex as mp
+
+
+# Registers needed by ThermalModel.set_state beyond the default query.
+QUERY_REGISTERS = {
+    Register.MOTOR_TEMPERATURE: mp.F32,
+    Register.TEMPERATURE: mp.F32,
+    Register.FET_TEMPERATURE_RISE: mp.F32,
+    Register.MOTOR_TEMPERATURE_RISE: mp.F32,
+}
+
+
+class Node:
+    '''A single thermal mass, whose rise above ambient approaches
+    thermal_resistance * 1.5 * resistance_ohm * I^2 with the given
+    time constant.'''
+
+    def __init__(self, *,
+                 resistance_ohm,
+                 thermal_resistance,
+                 time_constant_s,
+                 derate_C=math.inf):
+        self.resistance_ohm = resistance_ohm
+        self.thermal_resistance = thermal_resistance
+        self.time_constant_s = time_constant_s
+        self.derate_C = derate_C
+
+        self.temperature_C = math.nan
+        self.ambient_C = math.nan
+
+    def enabled(self):
+        return (self.thermal_resistance > 0 and
+                math.isfinite(self.temperature_C))
+
+    def set_state(self, temperature_C, rise_C):
+        self.temperature_C = temperature_C
+        self.ambient_C = temperature_C - rise_C
+
+    def steady_C(self, current_A):
+        return (self.ambient_C +
+                1.5 * self.resistance_ohm * current_A ** 2 *
+                self.thermal_resistance)
+
+    def temperature_after(self, duration_s, current_A, start_C=None):
+        if start_C is None:
+            start_C = self.temperature_C
+        steady_C = self.steady_C(current_A)
+        if self.time_constant_s <= 0:
+            return steady_C
+        return (steady_C + (start_C - steady_C) *
+                math.exp(-duration_s / self.time_constant_s))
+
+    def time_to_derate(self, current_A):
+        if not self.temperature_C < self.derate_C:
+            return 0.0
+        steady_C = self.steady_C(current_A)
+        if not steady_C > self.derate_C:
+            return math.inf
+        return self.time_constant_s * math.log(
+            (steady_C - self.temperature_C) / (steady_C - self.derate_C))
+
+    def max_current(self, duration_s):
+        if not self.temperature_C < self.derate_C:
+            return 0.0
+        if not math.isfinite(self.derate_C):
+            return math.inf
+
+        fraction = (1.0 if self.time_constant_s <= 0 else
+                    -math.expm1(-duration_s / self.time_constant_s))
+        if fraction <= 0:
+            return math.inf
+        steady_C = (self.temperature_C +
+                    (self.derate_C - self.temperature_C) / fraction)
+        return math.sqrt(
+            (steady_C - self.ambient_C) /
+            (1.5 * self.resistance_ohm * self.thermal_resistance))
+
+
+class ThermalModel:
+    '''The FET and motor thermal models.  Each method considers only
+    the nodes which are configured and whose temperature is known.'''
+
+    CONFIG_NAMES = [
+        'servo.thermal_model.fet_resistance_ohm',
+        'servo.thermal_model.fet_thermal_resistance',
+        'servo.thermal_model.fet_time_constant_s',
+        'servo.thermal_model.motor_thermal_resistance',
+        'servo.thermal_model.motor_time_constant_s',
+        'servo.derate_temperature',
+        'servo.enable_motor_temperature',
+        'servo.motor_derate_temperature',
+        'servo.motor_fault_temperature',
+        'motor.resistance_ohm',
+    ]
+
+    def __init__(self, *, fet, motor):
+        self.fet = fet
+        self.motor = motor
+
+    @staticmethod
+    def from_config(config):
+        '''Construct from a dictionary mapping each of CONFIG_NAMES to
+        its value.'''
+        motor_derate_C = (
+            config['servo.motor_derate_temperature']
+            if (config['servo.enable_motor_temperature'] and
+                math.isfinite(config['servo.motor_fault_temperature']))
+            else math.inf)
+
+        return ThermalModel(
+            fet=Node(
+                resistance_ohm=config[
+                    'servo.thermal_model.fet_resistance_ohm'],
+                thermal_resistance=config[
+                    'servo.thermal_model.fet_thermal_resistance'],
+                time_constant_s=config[
+                    'servo.thermal_model.fet_time_constant_s'],
+                derate_C=config['servo.derate_temperature']),
+            motor=Node(
+                resistance_ohm=config['motor.resistance_ohm'],
+                thermal_resistance=config[
+                    'servo.thermal_model.motor_thermal_resistance'],
+                time_constant_s=config[
+                    'servo.thermal_model.motor_time_constant_s'],
+                derate_C=motor_derate_C))
+
+    @staticmethod
+    async def from_stream(stream):
+        '''Construct from the configuration of a device, read through a
+        moteus.Stream.'''
+        config = {}
+        for name in ThermalModel.CONFIG_NAMES:
+            result = await stream.command(
+                f'conf get {name}'.encode('latin1'),
+                allow_any_response=True)
+            config[name] = float(result)
+        return ThermalModel.from_config(config)
+
+    def _nodes(self):
+        return [x for x in [self.fet, self.motor] if x.enabled()]
+
+    def set_state(self, values):
+        '''Update from the values of a query result including
+        QUERY_REGISTERS.'''
+        self.fet.set_state(values[Register.TEMPERATURE],
+                           values[Register.FET_TEMPERATURE_RISE])
+        self.motor.set_state(
+            (values[Register.MOTOR_TEMPERATURE]
+             if math.isfinite(self.motor.derate_C) else math.nan),
+            values[Register.MOTOR_TEMPERATURE_RISE])
+
+    def time_to_derate(self, current_A):
+        '''The time until derating begins at a constant current, or
+        math.inf if it never would.'''
+        return min([x.time_to_derate(current_A) for x in self._nodes()],
+                   default=math.inf)
+
+    def max_current(self, duration_s):
+        '''The largest constant current which can be applied for
+        duration_s without derating.'''
+        return min([x.max_current(duration_s) for x in self._nodes()],
+                   default=math.inf)
+
+    def simulate(self, profile):
+        '''Return the (fet_C, motor_C) temperatures at the end of each
+        (duration_s, current_A) segment of profile, without changing
+        the state of this model.'''
+        fet_C = self.fet.temperature_C
+        motor_C = self.motor.temperature_C
+        result = []
+        for duration_s, current_A in profile:
+            fet_C = self.fet.temperature_after(duration_s, current_A, fet_C)
+            motor_C = self.motor.temperature_after(
+                duration_s, current_A, motor_C)
+            result.append((fet_C, motor_C))
+        return result
+
+    def profile_derates(self, profile):
+        '''True if derating would begin at any point in profile.'''
+        # Temperatures are monotonic within a segment, so the limit
+        # can only first be exceeded at the end of one.
+        for fet_C, motor_C in self.simulate(profile):
+            if self.fet.enabled() and fet_C >= self.fet.derate_C:
+                return True
+            if self.motor.enabled() and motor_C >= self.motor.derate_C:
+                return True
+        return False
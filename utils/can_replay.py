@@ -0,0 +1,232 @@
+#!/usr/bin/python3 -B
+
+# Copyright 2023 mjbots Robotic Systems, LLC.  info@mjbots.com
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+'''Replay recorded CAN-FD traffic against a controller and compare
+the replies with those in the recording.
+
+The input is a debug log as written by the fdcanusb transport with
+--fdcanusb-debug, which contains lines of the form:
+
+  1690000000.123 > can send 8001 0110...
+  1690000000.124 < rcv 100 2404...
+
+Every frame sent by the host is replayed with its original
+arbitration ID.  Frames which requested a reply have that reply
+decoded and compared against the recorded reply for a subset of
+registers, by default those relevant to position mode.
+'''
+
+import argparse
+import asyncio
+import math
+import sys
+import time
+
+import moteus
+
+
+DEFAULT_REGISTERS = [
+    'MODE',
+    'POSITION',
+    'VELOCITY',
+    'TORQUE',
+    'FAULT',
+]
+
+
+class Frame:
+    def __init__(self, timestamp, arbitration_id, data):
+        self.timestamp = timestamp
+        self.arbitration_id = arbitration_id
+        self.data = data
+        self.reply = None
+
+    @property
+    def reply_required(self):
+        return (self.arbitration_id & 0x8000) != 0
+
+    @property
+    def destination(self):
+        return self.arbitration_id & 0x7f
+
+
+def read_log(fp):
+    '''Return a list of host to device Frames, with the recorded reply
+    attached to any which requested one.'''
+    result = []
+    pending = {}
+
+    for line in fp:
+        fields = line.split()
+        if len(fields) < 4:
+            continue
+
+        timestamp = float(fields[0])
+        if fields[1] == '>' and fields[2:4] == ['can', 'send']:
+            frame = Frame(timestamp, int(fields[4], 16),
+                          bytes.fromhex(fields[5]))
+            result.append(frame)
+            if frame.reply_required:
+                pending.setdefault(frame.destination, []).append(frame)
+        elif fields[1] == '<' and fields[2] == 'rcv':
+            source = (int(fields[3], 16) >> 8) & 0x7f
+            waiting = pending.get(source)
+            if waiting:
+                waiting.pop(0).reply = bytes.fromhex(fields[4])
+
+    return result
+
+
+def _make_command(frame):
+    result = moteus.Command()
+    result.raw = True
+    result.arbitration_id = frame.arbitration_id
+    result.reply_required = frame.reply_required
+    result.data = frame.data
+    result.parse = lambda message: message
+    return result
+
+
+def _compare(expected, actual, registers, tolerance):
+    '''Return a list of (register, expected, actual) that differ.'''
+    expected_values = moteus.moteus.parse_reply(expected)
+    actual_values = moteus.moteus.parse_reply(actual)
+
+    result = []
+    for register in registers:
+        if register not in expected_values:
+            continue
+        a = expected_values[register]
+        b = actual_values.get(register)
+        if b is None:
+            result.append((register, a, b))
+            continue
+        if isinstance(a, float) or isinstance(b, float):
+            if math.isnan(a) and math.isnan(b):
+                continue
+            if abs(a - b) <= tolerance.get(register, 0.0):
+                continue
+        elif a == b:
+            continue
+        result.append((register, a, b))
+    return result
+
+
+def _percentile(sorted_values, fraction):
+    if not sorted_values:
+        return math.nan
+    index = min(len(sorted_values) - 1, int(fraction * len(sorted_values)))
+    return sorted_values[index]
+
+
+async def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__,
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+
+    parser.add_argument('log', type=str, help='fdcanusb debug log')
+    parser.add_argument('--speed', type=float, default=1.0,
+                        help='replay rate relative to the recording, '
+                        '0 for as fast as possible')
+    parser.add_argument('--registers', type=str,
+                        default=','.join(DEFAULT_REGISTERS),
+                        help='comma separated list of registers to compare')
+    parser.add_argument('--tolerance', type=str, action='append', default=[],
+                        metavar='REG=VALUE',
+                        help='allowed absolute difference for a register')
+    parser.add_argument('--max-errors', type=int, default=20,
+                        help='number of mismatches to print')
+
+    moteus.make_transport_args(parser)
+
+    args = parser.parse_args()
+
+    registers = [moteus.Register[x.strip().upper()]
+                 for x in args.registers.split(',') if x.strip()]
+    tolerance = {
+        moteus.Register.POSITION: 0.01,
+        moteus.Register.VELOCITY: 0.1,
+        moteus.Register.TORQUE: 0.1,
+    }
+    for item in args.tolerance:
+        name, value = item.split('=')
+        tolerance[moteus.Register[name.strip().upper()]] = float(value)
+
+    with open(args.log) as fp:
+        frames = read_log(fp)
+
+    if not frames:
+        print('no frames found in log', file=sys.stderr)
+        return 1
+
+    transport = moteus.get_singleton_transport(args)
+
+    log_start = frames[0].timestamp
+    replay_start = time.monotonic()
+
+    latencies = []
+    compared = 0
+    missing = 0
+    mismatches = 0
+
+    for frame in frames:
+        if args.speed > 0:
+            target = (frame.timestamp - log_start) / args.speed
+            delay = target - (time.monotonic() - replay_start)
+            if delay > 0:
+                await asyncio.sleep(delay)
+
+        send_time = time.monotonic()
+        replies = await transport.cycle([_make_command(frame)])
+        latencies.append(time.monotonic() - send_time)
+
+        if frame.reply is None:
+            continue
+
+        reply = replies[0] if replies else None
+        if reply is None:
+            missing += 1
+            continue
+
+        compared += 1
+        errors = _compare(frame.reply, reply.data, registers, tolerance)
+        if errors:
+            mismatches += 1
+            if mismatches <= args.max_errors:
+                error_str = ', '.join(
+                    f'{moteus.Register(r).name}: {a} != {b}'
+                    for r, a, b in errors)
+                print(f'{frame.timestamp:.6f} {frame.arbitration_id:04x} '
+                      f'{error_str}')
+
+    elapsed = time.monotonic() - replay_start
+    recorded = frames[-1].timestamp - log_start
+    latencies.sort()
+
+    print()
+    print(f'frames:     {len(frames)} in {elapsed:.3f}s '
+          f'({len(frames) / elapsed:.1f}/s, recorded {recorded:.3f}s)')
+    print(f'compared:   {compared} replies, {mismatches} mismatched, '
+          f'{missing} missing')
+    print(f'latency:    p50 {_percentile(latencies, 0.5) * 1e6:.0f}us '
+          f'p99 {_percentile(latencies, 0.99) * 1e6:.0f}us '
+          f'max {latencies[-1] * 1e6:.0f}us')
+
+    return 1 if (mismatches or missing) else 0
+
+
+if __name__ == '__main__':
+    sys.exit(asyncio.run(main()))
@@ -393,6 +393,7 @@ class TviewConsoleWidget(HistoryConsoleWidget):
 class Record:
     def __init__(self, archive):
         self.archive = archive
+        self.decoder = reader.Decoder(archive)
         self.tree_item = None
         self.signals = {}
         self.history = []
@@ -760,7 +761,7 @@ class Device:
 
         record = self._telemetry_records[name]
         if record:
-            struct = record.archive.read(reader.Stream(io.BytesIO(data)))
+            struct = record.decoder.decode(data)
             record.update(struct)
             _set_tree_widget_data(record.tree_item, struct, record.archive)
 
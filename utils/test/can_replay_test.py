@@ -0,0 +1,98 @@
+#!/usr/bin/python3 -B
+
+# Copyright 2023 mjbots Robotic Systems, LLC.  info@mjbots.com
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import io
+import math
+import struct
+import unittest
+
+from moteus import Register
+import utils.can_replay as can_replay
+
+
+def make_reply(mode, position, velocity):
+    '''A reply with the int8 mode and float position and velocity.'''
+    return (bytes([0x21, Register.MODE, mode]) +
+            bytes([0x2e, Register.POSITION]) +
+            struct.pack('<ff', position, velocity))
+
+
+LOG = '\n'.join([
+    '1690000000.000 > can send 8001 11000a',
+    '1690000000.001 < rcv 100 ' + make_reply(10, 1.0, 0.5).hex(),
+    # The host may log other lines, which are skipped.
+    '1690000000.001 < OK',
+    '1690000000.002 > can send 0002 01000a',
+    '1690000000.003 > can send 8002 11000a',
+    '1690000000.004 > can send 8001 11000a',
+    '1690000000.005 < rcv 100 ' + make_reply(10, 2.0, 0.5).hex(),
+    '1690000000.006 < rcv 200 ' + make_reply(0, 0.0, 0.0).hex(),
+    # A reply that was never asked for is ignored.
+    '1690000000.007 < rcv 300 ' + make_reply(0, 0.0, 0.0).hex(),
+    '',
+])
+
+
+class CanReplayTest(unittest.TestCase):
+    def test_read_log(self):
+        frames = can_replay.read_log(io.StringIO(LOG))
+        self.assertEqual([x.arbitration_id for x in frames],
+                         [0x8001, 0x0002, 0x8002, 0x8001])
+        self.assertEqual(frames[0].timestamp, 1690000000.000)
+        self.assertEqual(frames[0].data, b'\x11\x00\x0a')
+
+        # Replies are paired with the oldest outstanding request to
+        # the same device, even when they arrive out of order.
+        self.assertEqual(frames[0].reply, make_reply(10, 1.0, 0.5))
+        self.assertIsNone(frames[1].reply)
+        self.assertEqual(frames[2].reply, make_reply(0, 0.0, 0.0))
+        self.assertEqual(frames[3].reply, make_reply(10, 2.0, 0.5))
+
+    def test_compare(self):
+        registers = [Register.MODE, Register.POSITION, Register.VELOCITY,
+                     Register.FAULT]
+        tolerance = {Register.POSITION: 0.01}
+        expected = make_reply(10, 1.0, 0.5)
+
+        self.assertEqual(
+            can_replay._compare(expected, make_reply(10, 1.005, 0.5),
+                                registers, tolerance), [])
+
+        # Registers without a tolerance must match exactly, and
+        # registers missing from the recording are not compared.
+        errors = can_replay._compare(
+            expected, make_reply(11, 1.02, 0.5001), registers, tolerance)
+        self.assertEqual([x[0] for x in errors],
+                         [Register.MODE, Register.POSITION,
+                          Register.VELOCITY])
+        self.assertEqual(errors[0][1:], (10, 11))
+
+        # A register missing from the reply is an error.
+        errors = can_replay._compare(
+            expected, bytes([0x21, Register.MODE, 10]), registers, tolerance)
+        self.assertEqual([(x[0], x[2]) for x in errors],
+                         [(Register.POSITION, None),
+                          (Register.VELOCITY, None)])
+
+        # NaN matches NaN.
+        self.assertEqual(
+            can_replay._compare(make_reply(10, math.nan, 0.5),
+                                make_reply(10, math.nan, 0.5),
+                                registers, tolerance), [])
+
+
+if __name__ == '__main__':
+    unittest.main()